@@ -0,0 +1,338 @@
+#include "cutil.h"
+#include "hash.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ull
+#endif
+
+// Throughput and quality of every cutil_hash_* function. The keyed hashes run with a fixed seed.
+//
+// Usage: cutil_bench_hash [--quick] [function]
+//
+// Build with -DCMAKE_BUILD_TYPE=Release, the numbers of a debug build mean nothing. Cycles are TSC ticks, which
+// run at the nominal clock rather than the current one.
+
+#define BENCH_MAX_KEY 4096
+
+static const struct cutil_hash_seed_t bench_seed = { 0x0123456789abcdefull, 0xfedcba9876543210ull };
+
+static size_t bench_siphash(void* data, size_t length)
+{
+  return cutil_hash_siphash(data, length, &bench_seed);
+}
+
+static size_t bench_siphash13(void* data, size_t length)
+{
+  return cutil_hash_siphash13(data, length, &bench_seed);
+}
+
+typedef struct bench_hash
+{
+  const char* name;
+  cutil_hash_func_t fn;
+} bench_hash;
+
+static const bench_hash bench_hashes[] = {
+  { "arb_add_chained", cutil_hash_arb_add_chained },
+  { "arb_xor_chained", cutil_hash_arb_xor_chained },
+  { "wy", cutil_hash_wy },
+  { "stripe", cutil_hash_stripe },
+  { "default", cutil_hash_default },
+  { "siphash", bench_siphash },
+  { "siphash13", bench_siphash13 },
+};
+
+#define BENCH_HASHES (sizeof(bench_hashes) / sizeof(bench_hashes[0]))
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ull;
+
+// xorshift64*, reproducible from run to run
+static uint64_t bench_rand(void)
+{
+  bench_rng ^= bench_rng >> 12;
+  bench_rng ^= bench_rng << 25;
+  bench_rng ^= bench_rng >> 27;
+  return bench_rng * 0x2545F4914F6CDD1Dull;
+}
+
+static void bench_fill(unsigned char* p, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    p[i] = (unsigned char) bench_rand();
+}
+
+static double bench_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// keeps the compiler from dropping the hashes
+static volatile size_t bench_sink;
+
+static void bench_throughput(const bench_hash* h, double min_seconds)
+{
+  static const size_t lengths[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 4096 };
+  static unsigned char buf[BENCH_MAX_KEY + 64];
+  bench_fill(buf, sizeof(buf));
+
+  printf("%-16s", h->name);
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+  {
+    size_t len = lengths[l];
+    size_t calls = 0, sink = 0;
+    uint64_t c0 = BENCH_CYCLES();
+    double t0 = bench_now(), t;
+
+    // the offset walks over the buffer, so the keys aren't all aligned the same
+    do
+    {
+      for (size_t i = 0; i < 1024; i++)
+        sink ^= h->fn(buf + (i & 63), len);
+      calls += 1024;
+      t = bench_now() - t0;
+    } while (t < min_seconds);
+
+    uint64_t cycles = BENCH_CYCLES() - c0;
+    bench_sink = sink;
+    printf(" %5zuB %7.2fGB/s %7.1fc", len, (double) (calls * len) / t * 1e-9, (double) cycles / (double) calls);
+    if (l % 4 == 3 && l + 1 < sizeof(lengths) / sizeof(lengths[0]))
+      printf("\n%-16s", "");
+  }
+  printf("\n");
+}
+
+// Worst bias over every (input bit, output bit) pair: 0 when every input bit flips every output bit half the time,
+// 1 when some output bit never or always flips
+static double bench_avalanche(const bench_hash* h, size_t len, size_t samples)
+{
+  unsigned char key[64];
+  size_t bits = len * 8;
+  size_t* flips = calloc(bits * 64, sizeof(size_t));
+  if (!flips)
+    return -1;
+
+  for (size_t s = 0; s < samples; s++)
+  {
+    bench_fill(key, len);
+    uint64_t base = (uint64_t) h->fn(key, len);
+    for (size_t i = 0; i < bits; i++)
+    {
+      key[i / 8] ^= (unsigned char) (1u << (i % 8));
+      uint64_t diff = base ^ (uint64_t) h->fn(key, len);
+      key[i / 8] ^= (unsigned char) (1u << (i % 8));
+      for (size_t o = 0; o < 64; o++)
+        flips[i * 64 + o] += (diff >> o) & 1;
+    }
+  }
+
+  double worst = 0;
+  for (size_t i = 0; i < bits * 64; i++)
+  {
+    double bias = fabs(2.0 * (double) flips[i] / (double) samples - 1.0);
+    if (bias > worst)
+      worst = bias;
+  }
+
+  free(flips);
+  return worst;
+}
+
+typedef struct bench_keyset
+{
+  const char* name;
+  unsigned char* keys;
+  size_t count;
+  size_t len;
+} bench_keyset;
+
+// Reduces the hashes of a key set with `% buckets`, like a hash table would without a finalizer. Reports the
+// chi-squared statistic over its degrees of freedom, about 1 for a uniform hash, and the fullest bucket relative to
+// the mean load
+static void bench_distribution(const bench_hash* h, const bench_keyset* set, size_t buckets)
+{
+  size_t* count = calloc(buckets, sizeof(size_t));
+  if (!count)
+    return;
+
+  for (size_t i = 0; i < set->count; i++)
+    count[h->fn(set->keys + i * set->len, set->len) % buckets]++;
+
+  double expected = (double) set->count / (double) buckets, chi = 0;
+  size_t max = 0;
+  for (size_t b = 0; b < buckets; b++)
+  {
+    chi += ((double) count[b] - expected) * ((double) count[b] - expected) / expected;
+    if (count[b] > max)
+      max = count[b];
+  }
+
+  printf(" %8.2f %6.1f", chi / (double) (buckets - 1), (double) max / expected);
+  free(count);
+}
+
+static int bench_compare_u64(const void* a, const void* b)
+{
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+  return (x > y) - (x < y);
+}
+
+// Number of pairs of keys whose full 64 bit hashes collide. Any is too many for sets this small
+static size_t bench_collisions(const bench_hash* h, const bench_keyset* set)
+{
+  uint64_t* hashes = malloc(set->count * sizeof(uint64_t));
+  if (!hashes)
+    return 0;
+
+  for (size_t i = 0; i < set->count; i++)
+    hashes[i] = (uint64_t) h->fn(set->keys + i * set->len, set->len);
+  qsort(hashes, set->count, sizeof(uint64_t), bench_compare_u64);
+
+  size_t collisions = 0;
+  for (size_t i = 1; i < set->count; i++)
+    collisions += hashes[i] == hashes[i - 1];
+
+  free(hashes);
+  return collisions;
+}
+
+// Sequential 64 bit integers
+static void bench_keys_sequential(bench_keyset* set, size_t count)
+{
+  set->name = "sequential";
+  set->len = sizeof(uint64_t);
+  set->count = count;
+  set->keys = malloc(count * set->len);
+  for (uint64_t i = 0; set->keys && i < count; i++)
+    memcpy(set->keys + i * set->len, &i, sizeof(i));
+}
+
+// 32 byte keys, zero but for up to 3 set bits. Every such key is enumerated until the set is full
+static void bench_keys_sparse(bench_keyset* set, size_t count)
+{
+  set->name = "sparse";
+  set->len = 32;
+  set->count = 0;
+  set->keys = calloc(count, set->len);
+  for (size_t a = 0; set->keys && a < 256 && set->count < count; a++)
+  {
+    for (size_t b = a + 1; b < 256 && set->count < count; b++)
+    {
+      for (size_t c = b + 1; c <= 256 && set->count < count; c++)
+      {
+        unsigned char* k = set->keys + set->count++ * set->len;
+        k[a / 8] |= (unsigned char) (1u << (a % 8));
+        k[b / 8] |= (unsigned char) (1u << (b % 8));
+        if (c < 256)
+          k[c / 8] |= (unsigned char) (1u << (c % 8));
+      }
+    }
+  }
+}
+
+// Text keys differing only in a decimal suffix, like "user:000123" in a 16 byte buffer
+static void bench_keys_text(bench_keyset* set, size_t count)
+{
+  set->name = "text";
+  set->len = 16;
+  set->count = count;
+  set->keys = calloc(count, set->len);
+  for (size_t i = 0; set->keys && i < count; i++)
+    snprintf((char*) set->keys + i * set->len, set->len, "user:%010zu", i);
+}
+
+// Random 24 byte keys
+static void bench_keys_random(bench_keyset* set, size_t count)
+{
+  set->name = "random";
+  set->len = 24;
+  set->count = count;
+  set->keys = malloc(count * set->len);
+  if (set->keys)
+    bench_fill(set->keys, count * set->len);
+}
+
+int main(int argc, char** argv)
+{
+  int quick = 0;
+  const char* only = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+      quick = 1;
+    else
+      only = argv[i];
+  }
+
+  double min_seconds = (quick) ? 0.005 : 0.05;
+  size_t samples = (quick) ? 200 : 2000;
+  size_t keys = (quick) ? (1 << 16) : (1 << 20);
+
+  printf("throughput: key length, GB/s, cycles per hash\n");
+  for (size_t i = 0; i < BENCH_HASHES; i++)
+  {
+    if (!only || strcmp(only, bench_hashes[i].name) == 0)
+      bench_throughput(&bench_hashes[i], min_seconds);
+  }
+
+  static const size_t avalanche_lengths[] = { 4, 8, 16, 64 };
+  // the bias of a perfect hash measured over n samples is about 1 / sqrt(n), and the worst of thousands of pairs
+  // lands around 4 / sqrt(n)
+  printf("\navalanche: worst bias over all input / output bit pairs, %.3f is the noise floor of %zu samples\n%-16s",
+    4.0 / sqrt((double) samples), samples, "");
+  for (size_t l = 0; l < sizeof(avalanche_lengths) / sizeof(avalanche_lengths[0]); l++)
+    printf(" %7zuB", avalanche_lengths[l]);
+  printf("\n");
+  for (size_t i = 0; i < BENCH_HASHES; i++)
+  {
+    if (only && strcmp(only, bench_hashes[i].name) != 0)
+      continue;
+    printf("%-16s", bench_hashes[i].name);
+    for (size_t l = 0; l < sizeof(avalanche_lengths) / sizeof(avalanche_lengths[0]); l++)
+      printf(" %8.3f", bench_avalanche(&bench_hashes[i], avalanche_lengths[l], samples));
+    printf("\n");
+  }
+
+  bench_keyset sets[4];
+  bench_keys_sequential(&sets[0], keys);
+  bench_keys_sparse(&sets[1], keys);
+  bench_keys_text(&sets[2], keys);
+  bench_keys_random(&sets[3], keys);
+
+  static const size_t buckets[] = { 1024, 1021, 65536 };
+  printf("\ndistribution: chi-squared / degrees of freedom (1 is ideal) and fullest bucket / mean, per bucket count"
+    "\n64 bit collisions\n");
+  for (size_t s = 0; s < 4; s++)
+  {
+    if (!sets[s].keys)
+      continue;
+    printf("%s keys (%zu x %zuB)\n%-16s", sets[s].name, sets[s].count, sets[s].len, "");
+    for (size_t b = 0; b < sizeof(buckets) / sizeof(buckets[0]); b++)
+      printf(" %15zu", buckets[b]);
+    printf(" %10s\n", "collisions");
+
+    for (size_t i = 0; i < BENCH_HASHES; i++)
+    {
+      if (only && strcmp(only, bench_hashes[i].name) != 0)
+        continue;
+      printf("%-16s", bench_hashes[i].name);
+      for (size_t b = 0; b < sizeof(buckets) / sizeof(buckets[0]); b++)
+        bench_distribution(&bench_hashes[i], &sets[s], buckets[b]);
+      printf(" %10zu\n", bench_collisions(&bench_hashes[i], &sets[s]));
+    }
+    free(sets[s].keys);
+  }
+
+  return 0;
+}
@@ -0,0 +1,409 @@
+#include <benchmark/benchmark.h>
+
+#include "hmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// cutil_hmap_t against std::unordered_map, both mapping 64 bit keys to 64 bit values.
+//
+// Usage: cutil_bench [--max_size=N] [Google Benchmark flags]
+//
+// Sizes go from 1e3 up to --max_size, 1e6 by default and at most 1e8. Every benchmark reports:
+//   items_per_second  operations per second
+//   ns_per_op         mean latency
+//   p99_ns            99th percentile latency of a sample of the operations, including about 20ns of clock reads
+//   map_rss_mb        resident memory the process grew by while the map was built. Reads low when the map reuses
+//                     memory an earlier benchmark freed
+//   peak_rss_mb       peak resident memory of the process so far
+//
+// --benchmark_format=json or --benchmark_out=<file> give machine readable results for tracking over time. Build
+// with -DCMAKE_BUILD_TYPE=Release.
+
+namespace
+{
+
+// one operation in this many gets its latency measured
+const size_t bench_sample_every = 64;
+
+// the percentiles are taken over the latest this many samples
+const size_t bench_sample_window = 1 << 16;
+
+// lookup and workload sequences repeat after this many operations
+const size_t bench_sequence = 1 << 20;
+
+class cutil_map
+{
+public:
+  cutil_map()
+  {
+    cutil_hmap_init(&map);
+    cutil_hmap_set_owned_keys(&map, 1);
+  }
+  ~cutil_map() { cutil_hmap_destroy(&map); }
+
+  static const char* name() { return "cutil_hmap"; }
+  int insert(uint64_t k, uint64_t v) { return cutil_hmap_insert(&map, cutil_hmap_tuple(&k, (uintptr_t) v)); }
+  int erase(uint64_t k) { return cutil_hmap_del(&map, cutil_hmap_key(&k)); }
+  uint64_t find(uint64_t k)
+  {
+    void** v = cutil_hmap_get(&map, cutil_hmap_key(&k));
+    return (v) ? (uint64_t) (uintptr_t) *v : 0;
+  }
+
+private:
+  struct cutil_hmap_t map;
+};
+
+class std_map
+{
+public:
+  static const char* name() { return "std_unordered_map"; }
+  int insert(uint64_t k, uint64_t v) { return map.emplace(k, v).second; }
+  int erase(uint64_t k) { return (int) map.erase(k); }
+  uint64_t find(uint64_t k)
+  {
+    auto it = map.find(k);
+    return (it != map.end()) ? it->second : 0;
+  }
+
+private:
+  std::unordered_map<uint64_t, uint64_t> map;
+};
+
+// splitmix64 is a bijection, so the keys of distinct indices are distinct
+uint64_t bench_key(uint64_t i)
+{
+  uint64_t z = i + 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// Uniform random indices below n
+std::vector<uint64_t> bench_uniform(size_t n, uint64_t seed)
+{
+  std::vector<uint64_t> seq(bench_sequence);
+  for (size_t i = 0; i < seq.size(); i++)
+    seq[i] = bench_key(seed * bench_sequence + i) % n;
+  return seq;
+}
+
+// Zipfian indices below n with skew theta, following Gray et al. "Quickly generating billion-record synthetic
+// databases", the generator YCSB uses. Index 0 is the hottest
+std::vector<uint64_t> bench_zipf(size_t n, double theta, uint64_t seed)
+{
+  double zetan = 0;
+  for (size_t i = 1; i <= n; i++)
+    zetan += 1.0 / std::pow((double) i, theta);
+  double zeta2 = 1.0 + 1.0 / std::pow(2.0, theta);
+  double alpha = 1.0 / (1.0 - theta);
+  double eta = (1.0 - std::pow(2.0 / (double) n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+
+  std::vector<uint64_t> seq(bench_sequence);
+  for (size_t i = 0; i < seq.size(); i++)
+  {
+    double u = (double) (bench_key(seed * bench_sequence + i) >> 11) * 0x1.0p-53;
+    double uz = u * zetan;
+    uint64_t rank;
+    if (uz < 1.0)
+      rank = 0;
+    else if (uz < zeta2)
+      rank = 1;
+    else
+      rank = (uint64_t) ((double) n * std::pow(eta * u - eta + 1.0, alpha));
+    seq[i] = std::min<uint64_t>(rank, n - 1);
+  }
+  return seq;
+}
+
+size_t bench_rss_bytes()
+{
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  unsigned long size = 0, resident = 0;
+  int ok = fscanf(f, "%lu %lu", &size, &resident) == 2;
+  fclose(f);
+  return (ok) ? (size_t) resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+}
+
+double bench_peak_rss_mb()
+{
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return 0;
+  return (double) ru.ru_maxrss / 1024.0;  // kilobytes on Linux
+}
+
+// Times the measured loops, and one operation in every bench_sample_every for the latency percentiles. Samples go
+// to a ring allocated up front, so that recording one never allocates inside the timed loops
+class latency_sampler
+{
+public:
+  latency_sampler() : samples(bench_sample_window) {}
+
+  void begin() { start = std::chrono::steady_clock::now(); }
+  void end() { elapsed += std::chrono::steady_clock::now() - start; }
+  double ns() { return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(); }
+
+  template <typename Op> void run(size_t i, Op op)
+  {
+    if (i % bench_sample_every)
+    {
+      op();
+      return;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    op();
+    auto t1 = std::chrono::steady_clock::now();
+    samples[taken++ % samples.size()] = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+  }
+
+  double p99()
+  {
+    size_t n = std::min(taken, samples.size());
+    if (!n)
+      return 0;
+    size_t k = (n * 99) / 100;
+    std::nth_element(samples.begin(), samples.begin() + k, samples.begin() + n);
+    return samples[k];
+  }
+
+private:
+  std::vector<double> samples;
+  size_t taken = 0;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::duration::zero();
+};
+
+void bench_report(benchmark::State& state, latency_sampler& lat, size_t ops, size_t map_rss)
+{
+  state.SetItemsProcessed((int64_t) ops);
+  state.counters["ns_per_op"] = (ops) ? lat.ns() / (double) ops : 0;
+  state.counters["p99_ns"] = lat.p99();
+  state.counters["map_rss_mb"] = (double) map_rss / (1024.0 * 1024.0);
+  state.counters["peak_rss_mb"] = bench_peak_rss_mb();
+}
+
+// Builds a map holding the keys of indices [0, n), and reports how much resident memory that took
+template <typename Map> size_t bench_fill(Map& map, size_t n)
+{
+  size_t before = bench_rss_bytes();
+  for (size_t i = 0; i < n; i++)
+    map.insert(bench_key(i), i);
+  size_t after = bench_rss_bytes();
+  return (after > before) ? after - before : 0;
+}
+
+// Inserts n keys into an empty map, without reserving
+template <typename Map> void bench_insert(benchmark::State& state)
+{
+  size_t n = (size_t) state.range(0), ops = 0;
+
+  // the memory comes from a map built up front: by the end of the timed loop, every map reuses the memory of the
+  // one deleted before it
+  size_t map_rss;
+  {
+    Map map;
+    map_rss = bench_fill(map, n);
+  }
+
+  latency_sampler lat;
+  for (auto _ : state)
+  {
+    Map* map = new Map();
+    lat.begin();
+    for (size_t i = 0; i < n; i++, ops++)
+      lat.run(ops, [&] { map->insert(bench_key(i), i); });
+    lat.end();
+
+    state.PauseTiming();
+    delete map;
+    state.ResumeTiming();
+  }
+  bench_report(state, lat, ops, map_rss);
+}
+
+// Looks up keys which are all in the map, uniformly
+template <typename Map> void bench_lookup_hit(benchmark::State& state)
+{
+  size_t n = (size_t) state.range(0), ops = 0;
+  Map map;
+  size_t map_rss = bench_fill(map, n);
+  std::vector<uint64_t> seq = bench_uniform(n, 1);
+  for (size_t i = 0; i < seq.size(); i++)
+    seq[i] = bench_key(seq[i]);
+
+  latency_sampler lat;
+  lat.begin();
+  for (auto _ : state)
+  {
+    uint64_t k = seq[ops % bench_sequence];
+    lat.run(ops, [&] { benchmark::DoNotOptimize(map.find(k)); });
+    ops++;
+  }
+  lat.end();
+  bench_report(state, lat, ops, map_rss);
+}
+
+// Looks up keys which are never in the map
+template <typename Map> void bench_lookup_miss(benchmark::State& state)
+{
+  size_t n = (size_t) state.range(0), ops = 0;
+  Map map;
+  size_t map_rss = bench_fill(map, n);
+
+  latency_sampler lat;
+  lat.begin();
+  for (auto _ : state)
+  {
+    uint64_t k = bench_key(n + ops % bench_sequence);
+    lat.run(ops, [&] { benchmark::DoNotOptimize(map.find(k)); });
+    ops++;
+  }
+  lat.end();
+  bench_report(state, lat, ops, map_rss);
+}
+
+// Deletes the oldest key and inserts a new one, so the map keeps its size while its keys change. Every iteration is
+// one delete and one insert
+template <typename Map> void bench_churn(benchmark::State& state)
+{
+  size_t n = (size_t) state.range(0), ops = 0;
+  Map map;
+  size_t map_rss = bench_fill(map, n);
+
+  latency_sampler lat;
+  lat.begin();
+  for (auto _ : state)
+  {
+    size_t oldest = ops / 2;
+    lat.run(ops, [&] { map.erase(bench_key(oldest)); });
+    lat.run(ops + 1, [&] { map.insert(bench_key(oldest + n), oldest + n); });
+    ops += 2;
+  }
+  lat.end();
+  bench_report(state, lat, ops, map_rss);
+}
+
+// 80% lookups, 10% inserts and 10% deletes, over a key space twice the size of the map
+template <typename Map> void bench_mixed(benchmark::State& state)
+{
+  size_t n = (size_t) state.range(0), ops = 0;
+  Map map;
+  size_t map_rss = bench_fill(map, n);
+  std::vector<uint64_t> keys = bench_uniform(2 * n, 2);
+  std::vector<uint64_t> kinds = bench_uniform(10, 3);
+
+  latency_sampler lat;
+  lat.begin();
+  for (auto _ : state)
+  {
+    uint64_t i = keys[ops % bench_sequence], k = bench_key(i);
+    switch (kinds[ops % bench_sequence])
+    {
+    case 0:
+      lat.run(ops, [&] { map.insert(k, i); });
+      break;
+    case 1:
+      lat.run(ops, [&] { map.erase(k); });
+      break;
+    default:
+      lat.run(ops, [&] { benchmark::DoNotOptimize(map.find(k)); });
+      break;
+    }
+    ops++;
+  }
+  lat.end();
+  bench_report(state, lat, ops, map_rss);
+}
+
+// Lookups following a Zipfian distribution (theta 0.99, like YCSB), so a few keys take most of the hits
+template <typename Map> void bench_zipf_lookup(benchmark::State& state)
+{
+  size_t n = (size_t) state.range(0), ops = 0;
+  Map map;
+  size_t map_rss = bench_fill(map, n);
+  std::vector<uint64_t> seq = bench_zipf(n, 0.99, 4);
+  for (size_t i = 0; i < seq.size(); i++)
+    seq[i] = bench_key(seq[i]);
+
+  latency_sampler lat;
+  lat.begin();
+  for (auto _ : state)
+  {
+    uint64_t k = seq[ops % bench_sequence];
+    lat.run(ops, [&] { benchmark::DoNotOptimize(map.find(k)); });
+    ops++;
+  }
+  lat.end();
+  bench_report(state, lat, ops, map_rss);
+}
+
+template <typename Map> void bench_register(size_t max_size)
+{
+  struct workload
+  {
+    const char* name;
+    void (*fn)(benchmark::State&);
+  };
+  const workload workloads[] = {
+    { "insert", bench_insert<Map> },
+    { "lookup_hit", bench_lookup_hit<Map> },
+    { "lookup_miss", bench_lookup_miss<Map> },
+    { "churn", bench_churn<Map> },
+    { "mixed", bench_mixed<Map> },
+    { "zipf_lookup", bench_zipf_lookup<Map> },
+  };
+
+  for (const workload& w : workloads)
+  {
+    std::string name = std::string(Map::name()) + "/" + w.name;
+    benchmark::internal::Benchmark* b = benchmark::RegisterBenchmark(name.c_str(), w.fn);
+    for (size_t n = 1000; n <= max_size; n *= 10)
+      b->Arg((int64_t) n);
+
+    // an insert iteration builds a whole map, every other iteration is a single operation
+    b->Unit((w.fn == bench_insert<Map>) ? benchmark::kMillisecond : benchmark::kNanosecond);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  size_t max_size = 1000000;
+
+  // take our own flag out before Google Benchmark sees the arguments
+  int out = 1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strncmp(argv[i], "--max_size=", 11) == 0)
+      max_size = std::min<size_t>(strtoull(argv[i] + 11, NULL, 10), 100000000);
+    else
+      argv[out++] = argv[i];
+  }
+  argc = out;
+
+  bench_register<cutil_map>(max_size);
+  bench_register<std_map>(max_size);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
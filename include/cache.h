@@ -0,0 +1,155 @@
+#ifndef _CUTIL_CACHE_H
+#define _CUTIL_CACHE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cutil.h"
+#include "hash.h"
+#include "hmap.h"
+#include "pool.h"
+#include <stddef.h>
+
+/**
+ * @brief Evict the least recently used entry
+ */
+#define CUTIL_CACHE_LRU 0
+
+/**
+ * @brief Evict with the CLOCK (second chance) approximation of LRU
+ */
+#define CUTIL_CACHE_CLOCK 1
+
+/**
+ * @brief Callback receiving every entry which leaves the cache
+ *
+ * @param ctx context pointer given to cutil_cache_set_evict()
+ * @param entry key and value of the entry
+ */
+typedef void (*cutil_cache_evict_func_t)(void* ctx, struct cutil_hmap_tuple_t* entry);
+
+/**
+ * @brief CUtil Bounded Cache
+ *
+ * Key value cache holding at most `capacity` worth of entries. Every entry has a cost, 1 to bound the number of
+ * entries, or its size in bytes to bound the memory. Lookups, promotions and evictions are O(1): a cutil_hmap_t
+ * indexes entries which are linked in a circular list, and entries come out of a pool rather than the heap.
+ *
+ * With CUTIL_CACHE_LRU, every hit moves its entry to the front of the list and the entry at the back is evicted.
+ * With CUTIL_CACHE_CLOCK, a hit only sets the referenced bit of its entry, and a hand sweeping the list gives
+ * referenced entries a second chance while evicting the first one which isn't. Hits then never write to the list,
+ * only to the referenced bit and, with CUTIL_HMAP_STATS, to the index counters, both of which are atomic. So
+ * concurrent cutil_cache_get() calls can share a reader lock, while puts and deletes need the writer lock.
+ *
+ * Keys and values are borrowed, like cutil_hmap_t.
+ *
+ * Initialize using the cutil_cache_init() function
+ * Destroy using the cutil_cache_destroy() function
+ */
+typedef struct cutil_cache_t
+{
+  struct cutil_hmap_t index;          /// Maps keys to their entry
+  struct cutil_pool_t entryPool;      /// Slab allocator the entries are allocated from
+  void* hand;                         /// LRU: most recently used entry. CLOCK: next entry the hand looks at
+  size_t capacity;                    /// Maximum total cost of the entries
+  size_t cost;                        /// Total cost of the entries
+  int policy;                         /// CUTIL_CACHE_LRU or CUTIL_CACHE_CLOCK
+  cutil_cache_evict_func_t evictFn;   /// Called for every entry leaving the cache, or NULL
+  void* evictCtx;                     /// Context passed to evictFn
+} cutil_cache_t;
+
+/**
+ * @brief Constructor for the cache object
+ *
+ * @param cache pointer to a cache
+ * @param policy CUTIL_CACHE_LRU or CUTIL_CACHE_CLOCK
+ * @param capacity maximum total cost of the entries
+ */
+void cutil_cache_init(struct cutil_cache_t* cache, int policy, size_t capacity);
+
+/**
+ * @brief Destructor for the cache object
+ *
+ * Every entry still cached is handed to the evict callback.
+ *
+ * @param cache pointer to a cache
+ */
+void cutil_cache_destroy(struct cutil_cache_t* cache);
+
+/**
+ * @brief Sets the callback receiving every entry which leaves the cache, whether evicted, deleted, replaced by a
+ * put of the same key, or destroyed with the cache
+ *
+ * @param cache pointer to the cache
+ * @param evict_fn callback, or NULL
+ * @param ctx context passed to the callback
+ */
+void cutil_cache_set_evict(struct cutil_cache_t* cache, cutil_cache_evict_func_t evict_fn, void* ctx);
+
+/**
+ * @brief Sets the hash function to hash the keys with. Only takes effect while the cache is empty
+ *
+ * @param cache pointer to the cache
+ * @param hash_fn hash function
+ */
+void cutil_cache_set_hashfn(struct cutil_cache_t* cache, cutil_hash_func_t hash_fn);
+
+/**
+ * @brief Get the number of entries in the cache
+ *
+ * @param cache pointer to the cache
+ * @return size_t number of entries
+ */
+size_t cutil_cache_size(struct cutil_cache_t* cache);
+
+/**
+ * @brief Get the total cost of the entries in the cache
+ *
+ * @param cache pointer to the cache
+ * @return size_t total cost, at most the capacity
+ */
+size_t cutil_cache_cost(struct cutil_cache_t* cache);
+
+/**
+ * @brief Check to see if the key is cached, without counting as a use
+ *
+ * @param cache pointer to the cache
+ * @param key key to test
+ * @return int boolean
+ */
+int cutil_cache_probe_key(struct cutil_cache_t* cache, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Look up the value of a key and mark the entry as used
+ *
+ * @param cache pointer to the cache
+ * @param key key to search
+ * @return void** pointer to the value, or NULL on a miss. Valid until the entry leaves the cache
+ */
+void** cutil_cache_get(struct cutil_cache_t* cache, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Insert a tuple, evicting entries until it fits
+ *
+ * An entry with the same key is replaced, and handed to the evict callback.
+ *
+ * @param cache pointer to the cache
+ * @param t tuple to insert
+ * @param cost cost of the entry
+ * @return int 1 if inserted, 0 if the cost exceeds the capacity or on allocation failure
+ */
+int cutil_cache_put(struct cutil_cache_t* cache, struct cutil_hmap_tuple_t t, size_t cost);
+
+/**
+ * @brief Remove an entry from the cache. The evict callback receives it
+ *
+ * @param cache pointer to the cache
+ * @param key key to delete
+ * @return int number of entries deleted
+ */
+int cutil_cache_del(struct cutil_cache_t* cache, struct cutil_hmap_key_t key);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,126 @@
+#ifndef _CUTIL_CONCURRENT_HASH_MAP_H
+#define _CUTIL_CONCURRENT_HASH_MAP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cutil.h"
+#include "hash.h"
+#include "hmap.h"
+#include <stddef.h>
+
+/**
+ * @brief CUtil Concurrent Hash Map
+ *
+ * Thread safe hash map which splits the key space across independently locked cutil_hmap_t shards. The shard is
+ * picked from the upper bits of the mixed key hash, while each shard indexes its buckets with the low bits. Every
+ * shard has its own reader-writer lock and resizes on its own, so operations on different shards never contend and
+ * readers of the same shard run in parallel.
+ *
+ * Initialize using the cutil_chmap_init() function
+ * Destroy using the cutil_chmap_destroy() function
+ */
+typedef struct cutil_chmap_t
+{
+  void* shards;                     /// Array of lock and hmap pairs, one cache line aligned entry per shard
+  size_t shardCount;                /// Number of shards, a power of two
+  unsigned shardShift;              /// Right shift taking the shard index out of the upper hash bits
+  cutil_hash_func_t hashFn;         /// Hash function to hash the keys with
+} cutil_chmap_t;
+
+/**
+ * @brief Constructor for the chmap object
+ *
+ * The shard count is rounded up to a power of two. A few shards per core is usually enough.
+ * On failure, shardCount is left at 0 and every operation fails.
+ *
+ * @param map pointer to a chmap
+ * @param shards number of shards
+ */
+void cutil_chmap_init(struct cutil_chmap_t* map, size_t shards);
+
+/**
+ * @brief Destructor for the chmap object
+ *
+ * Must not race with any other operation on the map.
+ *
+ * @param map pointer to a chmap
+ */
+void cutil_chmap_destroy(struct cutil_chmap_t* map);
+
+/**
+ * @brief Sets the destructor for each entry. See cutil_hmap_set_destructor()
+ *
+ * Must not race with any other operation on the map.
+ *
+ * @param map pointer to the chmap
+ * @param destructor destructor function to use
+ */
+void cutil_chmap_set_destructor(struct cutil_chmap_t* map, cutil_destructor_func_t destructor);
+
+/**
+ * @brief Sets the hash function to hash the keys with. Only takes effect while the map is empty
+ *
+ * Must not race with any other operation on the map.
+ *
+ * @param map pointer to the chmap
+ * @param hash_fn hash function
+ */
+void cutil_chmap_set_hashfn(struct cutil_chmap_t* map, cutil_hash_func_t hash_fn);
+
+/**
+ * @brief Get the number of elements in the map
+ *
+ * Shards are counted one after the other, so the result is only exact while no writer is active.
+ *
+ * @param map pointer to the chmap
+ * @return size_t number of tuples
+ */
+size_t cutil_chmap_size(struct cutil_chmap_t* map);
+
+/**
+ * @brief Check to see if the key exists in the map
+ *
+ * @param map pointer to the chmap
+ * @param key key to test
+ * @return int boolean
+ */
+int cutil_chmap_probe_key(struct cutil_chmap_t* map, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Insert into the map
+ *
+ * @param map pointer to the chmap
+ * @param insert tuple to insert
+ * @return int number of elements added (1 or 0)
+ */
+int cutil_chmap_insert(struct cutil_chmap_t* map, struct cutil_hmap_tuple_t insert);
+
+/**
+ * @brief Get value from map corresponding to the key
+ *
+ * Unlike cutil_hmap_get(), the value is copied out while the shard is locked, since a pointer into the shard
+ * would not survive a concurrent resize.
+ *
+ * @param map pointer to the chmap
+ * @param key key to search
+ * @param value receives the value if the key is found. May be NULL
+ * @return int 1 if found, 0 otherwise
+ */
+int cutil_chmap_get(struct cutil_chmap_t* map, struct cutil_hmap_key_t key, void** value);
+
+/**
+ * @brief Remove tuple from the map
+ *
+ * The destructor runs while the shard is locked.
+ *
+ * @param map pointer to the chmap
+ * @param key key to delete
+ * @return int number of tuples deleted
+ */
+int cutil_chmap_del(struct cutil_chmap_t* map, struct cutil_hmap_key_t key);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
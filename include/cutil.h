@@ -12,4 +12,13 @@ extern const int CUTIL_GT;
 
 typedef void (*cutil_destructor_func_t)(void* data);
 
+/**
+ * @brief Recovers a pointer to the structure from a pointer to one of its members
+ *
+ * @param ptr pointer to the member
+ * @param type type of the structure
+ * @param member name of the member in the structure
+ */
+#define cutil_container_of(ptr, type, member) ((type*) ((char*) (ptr) - offsetof(type, member)))
+
 #endif
@@ -0,0 +1,93 @@
+#ifndef _CUTIL_EPOCH_H
+#define _CUTIL_EPOCH_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/**
+ * @brief Callback releasing memory retired to an epoch domain
+ *
+ * @param ctx context pointer given to cutil_epoch_retire()
+ * @param ptr the retired pointer
+ */
+typedef void (*cutil_epoch_free_func_t)(void* ctx, void* ptr);
+
+/**
+ * @brief CUtil Epoch Based Reclamation domain
+ *
+ * Lets lock-free readers traverse shared structures while writers unlink and retire parts of them. Readers wrap
+ * every traversal in cutil_epoch_enter() / cutil_epoch_exit(). Retired memory is only released once every reader
+ * which could still hold a reference to it has left its critical section.
+ *
+ * Threads register themselves on their first cutil_epoch_enter(). Entering and leaving never block.
+ *
+ * Initialize using the cutil_epoch_init() function
+ * Destroy using the cutil_epoch_destroy() function
+ */
+typedef struct cutil_epoch_t
+{
+  void* state;  /// Global epoch, reader records and retire lists
+} cutil_epoch_t;
+
+/**
+ * @brief Constructor for the epoch domain
+ *
+ * @param epoch pointer to an epoch domain
+ * @return int 1 on success, 0 on allocation failure
+ */
+int cutil_epoch_init(struct cutil_epoch_t* epoch);
+
+/**
+ * @brief Destructor for the epoch domain
+ *
+ * Releases everything still retired. No reader may be inside a critical section.
+ *
+ * @param epoch pointer to an epoch domain
+ */
+void cutil_epoch_destroy(struct cutil_epoch_t* epoch);
+
+/**
+ * @brief Enter a read side critical section on the calling thread
+ *
+ * Critical sections may nest.
+ *
+ * @param epoch pointer to an epoch domain
+ */
+void cutil_epoch_enter(struct cutil_epoch_t* epoch);
+
+/**
+ * @brief Leave the read side critical section entered by cutil_epoch_enter()
+ *
+ * @param epoch pointer to an epoch domain
+ */
+void cutil_epoch_exit(struct cutil_epoch_t* epoch);
+
+/**
+ * @brief Schedule memory that was unlinked from the shared structure to be released
+ *
+ * `fn(ctx, ptr)` runs once no reader can observe `ptr` any more, from a later call to cutil_epoch_retire(),
+ * cutil_epoch_reclaim() or cutil_epoch_destroy(). `fn` must not call back into the domain. Must not be called
+ * from inside a critical section.
+ *
+ * @param epoch pointer to an epoch domain
+ * @param ptr memory to release
+ * @param fn function releasing the memory
+ * @param ctx context passed to fn
+ * @return int 1 on success, 0 if the retire record could not be allocated. ptr has then been released right away
+ *             after waiting for the readers
+ */
+int cutil_epoch_retire(struct cutil_epoch_t* epoch, void* ptr, cutil_epoch_free_func_t fn, void* ctx);
+
+/**
+ * @brief Try to advance the epoch and release whatever is safe to release
+ *
+ * @param epoch pointer to an epoch domain
+ */
+void cutil_epoch_reclaim(struct cutil_epoch_t* epoch);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
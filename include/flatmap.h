@@ -0,0 +1,158 @@
+#ifndef _CUTIL_FLAT_MAP_H
+#define _CUTIL_FLAT_MAP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cutil.h"
+#include "flatprobe.h"
+#include "hash.h"
+#include "hmap.h"
+#include <stddef.h>
+
+/**
+ * @brief CUtil Flat Hash Map
+ *
+ * Open addressing sibling of cutil_hmap_t. Entries live in a flat slot array, and a parallel array of
+ * control bytes holds a 7 bit hash fragment per slot. Slots are probed in groups of
+ * CUTIL_FLATMAP_GROUP_WIDTH, and a single SSE2 compare filters a whole group of candidates
+ * before any key is compared.
+ *
+ * Keys and values are borrowed, exactly like cutil_hmap_t.
+ *
+ * Initialize using the cutil_flatmap_init() function
+ * Destroy using the cutil_flatmap_destroy() function
+ */
+typedef struct cutil_flatmap_t
+{
+  void* slots;                      /// Flat array of key/value slots
+  unsigned char* ctrl;              /// Control byte for each slot (empty, deleted or hash fragment)
+  size_t capacity;                  /// Number of slots. Always a power of two and a multiple of the group width
+  size_t size;                      /// Number of items in the map
+  size_t tombstones;                /// Number of slots marked as deleted
+  float loadFactorMax;              /// Maximum fraction of used (full or deleted) slots before growing
+  cutil_hash_func_t hashFn;         /// Hash function to hash the keys with
+  cutil_compare_func_t compareFn;   /// Comparison function telling identical keys apart, used when equalFn is NULL
+  cutil_equal_func_t equalFn;       /// Equality function to compare to see if two keys are identical
+  cutil_destructor_func_t destuctor;/// Method to dellocate data and cleanup an entry
+} cutil_flatmap_t;
+
+/**
+ * @brief Constructor for the flatmap object
+ *
+ * @param map pointer to a flatmap
+ */
+void cutil_flatmap_init(struct cutil_flatmap_t* map);
+
+/**
+ * @brief Destructor for the flatmap object
+ *
+ * @param map pointer to a flatmap
+ */
+void cutil_flatmap_destroy(struct cutil_flatmap_t* map);
+
+/**
+ * @brief Sets the destructor for each entry
+ *
+ * The destructor receives a `struct cutil_hmap_tuple_t*`, same as with cutil_hmap_t.
+ *
+ * @param map pointer to the flatmap
+ * @param destructor destructor function to use
+ */
+void cutil_flatmap_set_destructor(struct cutil_flatmap_t* map, cutil_destructor_func_t destructor);
+
+/**
+ * @brief Sets the hash function to hash the keys with.
+ *
+ * Default is `cutil_hash_default`. Must be called while the map is empty.
+ *
+ * @param map pointer to the flatmap
+ * @param hash_fn hash function
+ */
+void cutil_flatmap_set_hashfn(struct cutil_flatmap_t* map, cutil_hash_func_t hash_fn);
+
+/**
+ * @brief Sets the function telling whether two keys are identical
+ *
+ * Default is `cutil_equal_bytes`. Only takes effect while the map is empty.
+ *
+ * @param map pointer to the flatmap
+ * @param equal_fn equality function
+ */
+void cutil_flatmap_set_equalfn(struct cutil_flatmap_t* map, cutil_equal_func_t equal_fn);
+
+/**
+ * @brief Compares keys with a three way comparison function instead of an equality function
+ *
+ * Keys are identical when it returns CUTIL_EQ. Only takes effect while the map is empty.
+ *
+ * @param map pointer to the flatmap
+ * @param compare_fn comparison function, like `cutil_compare_lex`
+ */
+void cutil_flatmap_set_comparefn(struct cutil_flatmap_t* map, cutil_compare_func_t compare_fn);
+
+/**
+ * @brief Get the number of elements in the flatmap
+ *
+ * @param map pointer to the flatmap
+ * @return size_t number of tuples
+ */
+size_t cutil_flatmap_size(struct cutil_flatmap_t* map);
+
+/**
+ * @brief Check to see if the key exists in the flatmap
+ *
+ * @param map pointer to the flatmap
+ * @param key key to test
+ * @return int boolean
+ */
+int cutil_flatmap_probe_key(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Checks if any slot on the probe sequence of the key carries the same hash fragment.
+ *
+ * Like cutil_hmap_probe_hashfn(), this may return true even if the key does not exist in the map.
+ *
+ * @param map pointer to the flatmap
+ * @param key key
+ * @return int boolean
+ */
+int cutil_flatmap_probe_hashfn(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Insert into the flatmap
+ *
+ * Existing keys are not overwritten.
+ *
+ * @param map pointer to the flatmap
+ * @param insert tuple to insert
+ * @return int number of elements added (1 or 0)
+ */
+int cutil_flatmap_insert(struct cutil_flatmap_t* map, struct cutil_hmap_tuple_t insert);
+
+/**
+ * @brief Get value from map corresponding to the key
+ *
+ * The returned pointer is invalidated by the next insert.
+ *
+ * @param map pointer to the flatmap
+ * @param key key to search
+ * @return void** pointer to the value
+ */
+void** cutil_flatmap_get(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Remove tuple from the flatmap
+ *
+ * GC will take place using the destructor function provided via cutil_flatmap_set_destructor()
+ *
+ * @param map pointer to the flatmap
+ * @param key key to delete
+ * @return int number of tuples deleted
+ */
+int cutil_flatmap_del(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,248 @@
+#ifndef _CUTIL_FLAT_PROBE_H
+#define _CUTIL_FLAT_PROBE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Control bytes, group matching and probing of the open addressing tables. Internal to cutil_flatmap_t and the
+ * maps generated by CUTIL_HMAP_DECLARE(), which only differ in the layout of their slots and how they compare keys.
+ * Include flatmap.h or tmap.h instead.
+ */
+
+/**
+ * @brief Number of slots filtered by a single control byte comparison
+ */
+#define CUTIL_FLATMAP_GROUP_WIDTH 16
+
+/**
+ * @brief Control byte of a slot which was never used. Full slots hold the low 7 bits of the hash, so the high bit
+ * marks a free slot
+ */
+#define CUTIL_FLATMAP_CTRL_EMPTY ((unsigned char) 0x80)
+
+/**
+ * @brief Control byte of a slot whose entry was deleted
+ */
+#define CUTIL_FLATMAP_CTRL_DELETED ((unsigned char) 0xFE)
+
+/**
+ * @brief Tells whether the key at a slot is the one looked for
+ *
+ * @param ctx context passed to cutil_flatmap_find()
+ * @param idx slot whose hash fragment matched
+ * @return int non zero if the slot holds the key
+ */
+typedef int (*cutil_flatmap_match_func_t)(const void* ctx, size_t idx);
+
+/**
+ * @brief Matches the control bytes of a group against a hash fragment
+ *
+ * @param grp CUTIL_FLATMAP_GROUP_WIDTH control bytes
+ * @param h2 byte to look for
+ * @return unsigned int bitmask with one bit per matching slot
+ */
+static inline unsigned int cutil_flatmap_group_match(const unsigned char* grp, unsigned char h2)
+{
+#if defined(__SSE2__)
+  __m128i ctrl = _mm_loadu_si128((const __m128i*) grp);
+  return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) h2)));
+#else
+  unsigned int m = 0;
+  for (unsigned i = 0; i < CUTIL_FLATMAP_GROUP_WIDTH; i++)
+    if (grp[i] == h2)
+      m |= 1u << i;
+  return m;
+#endif
+}
+
+/**
+ * @brief Bitmask of the empty slots of a group
+ */
+static inline unsigned int cutil_flatmap_group_match_empty(const unsigned char* grp)
+{
+  return cutil_flatmap_group_match(grp, CUTIL_FLATMAP_CTRL_EMPTY);
+}
+
+/**
+ * @brief Bitmask of the empty or deleted slots of a group
+ */
+static inline unsigned int cutil_flatmap_group_match_free(const unsigned char* grp)
+{
+#if defined(__SSE2__)
+  // empty and deleted both have the high bit set
+  return (unsigned int) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) grp));
+#else
+  unsigned int m = 0;
+  for (unsigned i = 0; i < CUTIL_FLATMAP_GROUP_WIDTH; i++)
+    if (grp[i] & 0x80)
+      m |= 1u << i;
+  return m;
+#endif
+}
+
+/**
+ * @brief Index of the lowest set bit of a non zero group bitmask
+ */
+static inline unsigned cutil_flatmap_group_first(unsigned int m)
+{
+#if defined(__GNUC__)
+  return (unsigned) __builtin_ctz(m);
+#else
+  unsigned i = 0;
+  while (!(m & 1u))
+  {
+    m >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+/**
+ * @brief Whether a control byte marks a slot holding an entry
+ */
+static inline int cutil_flatmap_ctrl_full(unsigned char ctrl)
+{
+  return !(ctrl & 0x80);
+}
+
+/**
+ * @brief Marks every slot of a new table empty
+ */
+static inline void cutil_flatmap_ctrl_clear(unsigned char* ctrl, size_t capacity)
+{
+  memset(ctrl, CUTIL_FLATMAP_CTRL_EMPTY, capacity);
+}
+
+/**
+ * @brief Finds the slot of a key
+ *
+ * Groups are visited in triangular order, which reaches every group exactly once, and only the slots carrying
+ * the hash fragment are handed to `match`. With `match` a static inline function, the compiler inlines it along
+ * with the probe.
+ *
+ * @param ctrl control bytes of the table
+ * @param capacity number of slots, a power of two and a multiple of the group width
+ * @param hash mixed hash of the key
+ * @param match tells whether a candidate slot holds the key
+ * @param ctx passed on to match
+ * @return size_t slot index, or capacity if the key is not in the table
+ */
+static inline size_t cutil_flatmap_find(const unsigned char* ctrl, size_t capacity, size_t hash,
+  cutil_flatmap_match_func_t match, const void* ctx)
+{
+  size_t groups_mask = capacity / CUTIL_FLATMAP_GROUP_WIDTH - 1;
+  size_t g = (hash >> 7) & groups_mask;
+  unsigned char h2 = (unsigned char) (hash & 0x7F);
+
+  for (size_t step = 0; step <= groups_mask; step++)
+  {
+    const unsigned char* grp = ctrl + g * CUTIL_FLATMAP_GROUP_WIDTH;
+    unsigned int m = cutil_flatmap_group_match(grp, h2);
+    while (m)
+    {
+      size_t idx = g * CUTIL_FLATMAP_GROUP_WIDTH + cutil_flatmap_group_first(m);
+      if (match(ctx, idx))
+        return idx;
+      m &= m - 1;
+    }
+
+    // a probe sequence never continues past a group which still has an empty slot
+    if (cutil_flatmap_group_match_empty(grp))
+      break;
+    g = (g + step + 1) & groups_mask;
+  }
+
+  return capacity;
+}
+
+/**
+ * @brief Finds the first empty or deleted slot on the probe sequence of a hash
+ *
+ * @return size_t slot index, or capacity if the table is full
+ */
+static inline size_t cutil_flatmap_find_free(const unsigned char* ctrl, size_t capacity, size_t hash)
+{
+  size_t groups_mask = capacity / CUTIL_FLATMAP_GROUP_WIDTH - 1;
+  size_t g = (hash >> 7) & groups_mask;
+
+  for (size_t step = 0; step <= groups_mask; step++)
+  {
+    unsigned int m = cutil_flatmap_group_match_free(ctrl + g * CUTIL_FLATMAP_GROUP_WIDTH);
+    if (m)
+      return g * CUTIL_FLATMAP_GROUP_WIDTH + cutil_flatmap_group_first(m);
+    g = (g + step + 1) & groups_mask;
+  }
+
+  return capacity;
+}
+
+/**
+ * @brief Claims a free slot for a hash. The caller fills the slot
+ *
+ * @param tombstones decremented if the slot held a deleted entry. May be NULL for a table without any
+ * @return size_t slot index, or capacity if the table is full
+ */
+static inline size_t cutil_flatmap_claim(unsigned char* ctrl, size_t capacity, size_t hash, size_t* tombstones)
+{
+  size_t idx = cutil_flatmap_find_free(ctrl, capacity, hash);
+  if (idx == capacity)
+    return capacity;
+
+  if (ctrl[idx] == CUTIL_FLATMAP_CTRL_DELETED && tombstones)
+    (*tombstones)--;
+  ctrl[idx] = (unsigned char) (hash & 0x7F);
+  return idx;
+}
+
+/**
+ * @brief Frees the slot of a removed entry
+ *
+ * If the group of the slot was never full, no probe sequence passed through it, and the slot can become empty
+ * again. Otherwise it is marked deleted, and the tombstone counted.
+ */
+static inline void cutil_flatmap_erase(unsigned char* ctrl, size_t idx, size_t* tombstones)
+{
+  const unsigned char* grp = ctrl + (idx / CUTIL_FLATMAP_GROUP_WIDTH) * CUTIL_FLATMAP_GROUP_WIDTH;
+  if (cutil_flatmap_group_match_empty(grp))
+  {
+    ctrl[idx] = CUTIL_FLATMAP_CTRL_EMPTY;
+  }
+  else
+  {
+    ctrl[idx] = CUTIL_FLATMAP_CTRL_DELETED;
+    (*tombstones)++;
+  }
+}
+
+/**
+ * @brief Capacity to rebuild the table with before adding an entry
+ *
+ * Grows when the live entries crossed half the max load factor, and otherwise only purges the tombstones.
+ *
+ * @param capacity current number of slots
+ * @param size number of entries
+ * @param tombstones number of deleted slots
+ * @param lf max fraction of used (full or deleted) slots
+ * @return size_t new capacity, or 0 if the entry fits as is
+ */
+static inline size_t cutil_flatmap_grow_for_insert(size_t capacity, size_t size, size_t tombstones, float lf)
+{
+  if ((float) (size + tombstones + 1) <= (float) capacity * lf)
+    return 0;
+
+  return ((float) (size + 1) > (float) capacity * lf / 2.f) ? capacity * 2 : capacity;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -6,15 +6,135 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef size_t (*cutil_hash_func_t)(void* data, size_t length);
 
+/**
+ * @brief 128 bit secret key of a keyed hash function
+ */
+typedef struct cutil_hash_seed_t
+{
+  uint64_t k0;  /// Low half of the key
+  uint64_t k1;  /// High half of the key
+} cutil_hash_seed_t;
+
+/**
+ * @brief Hash function keyed with a secret seed
+ *
+ * Without the seed, the hashes can't be predicted, so nobody controlling the keys can pick keys which collide.
+ */
+typedef size_t (*cutil_keyed_hash_func_t)(void* data, size_t length, const struct cutil_hash_seed_t* seed);
+
+/**
+ * @brief Bit mixing finalizer (murmur3 fmix64)
+ *
+ * Spreads every input bit over the whole word, so containers can take any bits of a weak hash as an index.
+ */
+static inline size_t cutil_hash_mix(size_t hash)
+{
+  uint64_t x = (uint64_t) hash;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return (size_t) x;
+}
+
+/**
+ * @brief Key length from which cutil_hash_default() switches from cutil_hash_wy() to cutil_hash_stripe()
+ */
+#define CUTIL_HASH_LONG_KEY 256
+
 size_t cutil_hash_arb_add_chained(void* data, size_t length);
 size_t cutil_hash_arb_xor_chained(void* data, size_t length);
 
+/**
+ * @brief wyhash of the key
+ *
+ * Fast and well distributed for short and medium keys: a handful of 64 x 64 -> 128 bit multiplies per 48 bytes,
+ * and no loop at all for keys up to 16 bytes.
+ */
+size_t cutil_hash_wy(void* data, size_t length);
+
+/**
+ * @brief Striped hash of the key, for long keys
+ *
+ * Runs 8 independent lanes over 64 byte stripes, vectorized with SSE2, or AVX2 when the CPU supports it. The result
+ * doesn't depend on the instruction set it was computed with.
+ */
+size_t cutil_hash_stripe(void* data, size_t length);
+
+/**
+ * @brief Implementations of cutil_hash_stripe(), see cutil_hash_stripe_isa()
+ */
+#define CUTIL_HASH_ISA_SCALAR 0           /// Portable C, only built where SSE2 isn't available
+#define CUTIL_HASH_ISA_SSE2 1
+#define CUTIL_HASH_ISA_AVX2 2
+
+/**
+ * @brief cutil_hash_stripe() computed with the given instruction set instead of the one picked for the CPU
+ *
+ * Meant for checking that the implementations agree, and for comparing their speed.
+ *
+ * @param data key
+ * @param length length of the key
+ * @param isa CUTIL_HASH_ISA_SCALAR, CUTIL_HASH_ISA_SSE2 or CUTIL_HASH_ISA_AVX2
+ * @param out receives the hash
+ * @return int 1 on success, 0 if the implementation isn't built in or the CPU doesn't support it
+ */
+int cutil_hash_stripe_isa(void* data, size_t length, int isa, size_t* out);
+
+/**
+ * @brief Default hash of the containers: cutil_hash_wy() below CUTIL_HASH_LONG_KEY bytes, cutil_hash_stripe() from
+ * there on
+ */
+size_t cutil_hash_default(void* data, size_t length);
+
+/**
+ * @brief SipHash-2-4 of the key, keyed with the seed
+ *
+ * A cryptographic PRF for short inputs: the reference choice for hash tables facing untrusted keys.
+ */
+size_t cutil_hash_siphash(void* data, size_t length, const struct cutil_hash_seed_t* seed);
+
+/**
+ * @brief SipHash-1-3 of the key, keyed with the seed
+ *
+ * Fewer rounds than cutil_hash_siphash(), and about twice as fast. Still no known way to find collisions without
+ * the seed, which is why hash tables commonly use it.
+ */
+size_t cutil_hash_siphash13(void* data, size_t length, const struct cutil_hash_seed_t* seed);
+
+/**
+ * @brief Fills a seed from the random number generator of the operating system
+ *
+ * @param seed seed to fill
+ * @return int 1 on success, 0 if no randomness is available
+ */
+int cutil_hash_seed_random(struct cutil_hash_seed_t* seed);
+
 typedef int (*cutil_compare_func_t)(void* d0, void* d1, size_t l1, size_t l2);
 int cutil_compare_lex(void* data, void* data2, size_t len1, size_t len2);
 
+/**
+ * @brief Equality function: returns non zero if the two keys are identical
+ *
+ * Hash lookups only need equality, which is cheaper to answer than an ordering.
+ */
+typedef int (*cutil_equal_func_t)(void* d0, void* d1, size_t l1, size_t l2);
+
+/**
+ * @brief Byte equality of two keys
+ *
+ * Rejects keys of different lengths before reading them, and compares 4, 8 or 16 bytes at a time. Default equality
+ * function of the hash maps.
+ *
+ * @return int 1 if the lengths and the bytes are equal, 0 otherwise
+ */
+int cutil_equal_bytes(void* data, void* data2, size_t len1, size_t len2);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,8 +6,48 @@ extern "C" {
 
 #include "cutil.h"
 #include "hash.h"
+#include "pool.h"
 #include <stddef.h>
 
+/**
+ * @brief Number of chain lengths tracked by the histogram of cutil_hmap_stats_t
+ */
+#define CUTIL_HMAP_STATS_CHAINS 16
+
+/**
+ * @brief Operation counters of a hash map
+ * 
+ * Only maintained when the library is built with CUTIL_HMAP_STATS (the CMake option of the same name). Otherwise
+ * they stay zero and the map pays nothing for them.
+ *
+ * With stats, lookups write the counters too. They are bumped with relaxed atomics, so lookups sharing a reader lock
+ * don't race on them.
+ */
+typedef struct cutil_hmap_counters_t
+{
+  size_t hits;                      /// Lookups which found the key, including the ones done by insert and del
+  size_t misses;                    /// Lookups which didn't find the key
+  size_t compares;                  /// Calls to the compare function
+  size_t collisions;                /// Inserts into a bucket which already held a chain
+  size_t resizes;                   /// Bucket reallocations
+  unsigned long long resizeNanos;   /// Time spent allocating buckets and migrating entries, in nanoseconds
+} cutil_hmap_counters_t;
+
+/**
+ * @brief Snapshot of the shape and the counters of a hash map. See cutil_hmap_stats()
+ */
+typedef struct cutil_hmap_stats_t
+{
+  size_t size;                                /// Number of items
+  size_t buckets;                             /// Number of current buckets
+  size_t oldBuckets;                          /// Number of buckets still being migrated
+  size_t chains[CUTIL_HMAP_STATS_CHAINS];     /// Number of buckets per chain length. The last slot counts all longer chains
+  size_t maxChain;                            /// Longest chain
+  size_t bucketBytes;                         /// Heap bytes of the bucket arrays
+  size_t nodeBytes;                           /// Heap bytes of the entries, including unused pooled entries
+  struct cutil_hmap_counters_t counters;      /// Operation counters since init or the last reset
+} cutil_hmap_stats_t;
+
 /**
  * @brief CUtil Hash Map
  * 
@@ -19,16 +59,35 @@ extern "C" {
 typedef struct cutil_hmap_t
 {
   void* mapData;                    /// Holds the hash map buckets
-  size_t buckets;                   /// Number of buckets in the hashmap
+  size_t buckets;                   /// Number of buckets in the hashmap, always a power of two
   size_t size;                      /// Number of items in the hashmap
   float loadFactorMax;              /// Maximum load factor before expanding buckets
   float loadFactorMin;              /// Minimum load factor before contracting buckets
   size_t minBuckets;                /// Minimum number of buckets to keep
   cutil_hash_func_t hashFn;         /// Hash function to hash the keys with
-  cutil_compare_func_t compareFn;   /// Equality comparison function to compare to see if two keys are identical
+  cutil_keyed_hash_func_t keyedHashFn; /// Keyed hash function used instead of hashFn, or NULL
+  struct cutil_hash_seed_t seed;    /// Secret seed of keyedHashFn
+  cutil_compare_func_t compareFn;   /// Comparison function telling identical keys apart, used when equalFn is NULL
+  cutil_equal_func_t equalFn;       /// Equality function to compare to see if two keys are identical
   cutil_destructor_func_t destuctor;/// Method to dellocate data and cleanup an entry
+  void* oldData;                    /// Buckets still being drained by an incremental resize, or NULL
+  size_t oldBuckets;                /// Number of buckets in oldData
+  size_t rehashIdx;                 /// Next bucket of oldData to migrate
+  size_t rehashStep;                /// Buckets migrated per operation. 0 resizes in one go
+  struct cutil_pool_t nodePool;     /// Slab allocator the entries are allocated from
+  int ownedKeys;                    /// Whether the map stores its own copy of every key
+#ifdef CUTIL_HMAP_STATS
+  struct cutil_hmap_counters_t counters; /// Operation counters, see cutil_hmap_stats()
+#endif
 } cutil_hmap_t;
 
+/**
+ * @brief Longest key stored inside the entry itself when the map owns its keys
+ * 
+ * An entry with an inline key fills exactly one 64 byte cache line on 64 bit targets.
+ */
+#define CUTIL_HMAP_INLINE_KEY 24
+
 /**
  * @brief Holds the hash map key and its length
  * 
@@ -58,6 +117,37 @@ typedef struct cutil_hmap_tuple_t
  */
 struct cutil_hmap_key_t cutil_hmap_make_key(void* key, size_t len);
 
+/**
+ * @brief Get the hash the maps use for a key
+ * 
+ * The hash function is mixed with cutil_hash_mix(), and never results in 0.
+ * cutil_hmap_t, cutil_flatmap_t, cutil_chmap_t, cutil_rhmap_t and cutil_hmapfile_t all hash keys this way, so a
+ * hash computed once is valid for every one of them using the same hash function.
+ * 
+ * @param key key to hash
+ * @param hash_fn hash function of the map
+ * @return size_t the hash
+ */
+static inline size_t cutil_hmap_key_hash(struct cutil_hmap_key_t key, cutil_hash_func_t hash_fn)
+{
+  size_t hash = cutil_hash_mix(hash_fn(key.key, key.len));
+  return (hash) ? hash : 1;
+}
+
+/**
+ * @brief Get the hash the map uses for a key: the keyed hash function if the map has one, otherwise
+ * cutil_hmap_key_hash() with its hash function
+ * 
+ * Looking a key up in several maps, or running several operations with it, only hashes the bytes once when the
+ * hash from here goes to the `_hashed` variants of the operations. The hash is valid for every map with the same
+ * hash function, and with a keyed hash function, the same seed.
+ * 
+ * @param map pointer to the hmap
+ * @param key key to hash
+ * @return size_t the hash, never 0
+ */
+size_t cutil_hmap_hash(struct cutil_hmap_t* map, struct cutil_hmap_key_t key);
+
 /**
  * @brief Creates a cutil tuple with a key and its value
  * 
@@ -110,7 +200,7 @@ void cutil_hmap_set_destructor(struct cutil_hmap_t* map, cutil_destructor_func_t
 /**
  * @brief Sets the hash function to hash the keys with.
  * 
- * Default is `cutil_hash_arb_xor_chained`.
+ * Default is `cutil_hash_default`. Only takes effect while the map is empty.
  * 
  * Function signature is `size_t hash(void* data, size_t len)`
  * 
@@ -119,17 +209,59 @@ void cutil_hmap_set_destructor(struct cutil_hmap_t* map, cutil_destructor_func_t
  */
 void cutil_hmap_set_hashfn(struct cutil_hmap_t* map, cutil_hash_func_t hash_fn);
 
+/**
+ * @brief Hashes the keys with a keyed hash function and a secret seed, instead of the plain hash function
+ * 
+ * The unkeyed hash functions are easy to invert, so whoever controls the keys can send keys which all land in the
+ * same bucket, and turn every operation into a scan of one long chain. With a random seed per map, the hashes
+ * can't be predicted, which keeps the chains short whatever the keys. `cutil_hash_siphash13` is a good choice.
+ * 
+ * Hashes passed to the `_hashed` operations must come from cutil_hmap_hash() on this very map. Only takes effect
+ * while the map is empty. cutil_hmap_set_hashfn() switches back to the plain hash function.
+ * 
+ * @param map pointer to the hmap
+ * @param hash_fn keyed hash function, or NULL to go back to the plain hash function
+ * @param seed secret seed, or NULL for a random one from cutil_hash_seed_random()
+ * @return int 1 on success, 0 if the map isn't empty or no random seed is available
+ */
+int cutil_hmap_set_keyed_hashfn(struct cutil_hmap_t* map, cutil_keyed_hash_func_t hash_fn, const struct cutil_hash_seed_t* seed);
+
+/**
+ * @brief Sets the function telling whether two keys are identical
+ * 
+ * Default is `cutil_equal_bytes`. Only takes effect while the map is empty.
+ * 
+ * Function signature is `int equal(void* d0, void* d1, size_t l0, size_t l1)`, returning non zero for equal keys
+ * 
+ * @param map pointer to the hmap
+ * @param equal_fn equality function
+ */
+void cutil_hmap_set_equalfn(struct cutil_hmap_t* map, cutil_equal_func_t equal_fn);
+
+/**
+ * @brief Compares keys with a three way comparison function instead of an equality function
+ * 
+ * Keys are identical when it returns CUTIL_EQ. Only takes effect while the map is empty.
+ * 
+ * @param map pointer to the hmap
+ * @param compare_fn comparison function, like `cutil_compare_lex`
+ */
+void cutil_hmap_set_comparefn(struct cutil_hmap_t* map, cutil_compare_func_t compare_fn);
+
 /**
  * @brief Sets the min and max load factor of the hash map.
  * 
  * Default: min = 0.25, max = 0.75
  * 
- * * If the load factor increases past 0.75, the hmap will be grown to contain more buckets.
- * * If the load factor decreases past 0.25, the hmap _may_ be shrunk to free space
+ * * If the load factor increases past 0.75, the number of buckets is (at least) doubled.
+ * * If the load factor decreases past 0.25 on a delete, the hmap is shrunk to free space, down to where the load
+ *   factor is halfway between min and max. Keep min well below half of max to avoid resizing back and forth.
  * 
  * Lower load factor means there are generally more empty buckets. This means that hashing is more effective
  * Higher load factor means a higher possibility of a hash collision, so chaining will be used. Chaining is slow.
  * 
+ * Ignored unless min < max and max > 0.
+ * 
  * @param map pointer to the hmap
  * @param min min load factor
  * @param max max load factor
@@ -139,13 +271,108 @@ void cutil_hmap_set_loadfactor(struct cutil_hmap_t* map, float min, float max);
 /**
  * @brief Set the minimum number of buckets to keep allocated
  * 
- * Default: 16
+ * Default: 16. Rounded up to a power of two.
  * 
  * @param map pointer to the hmap
  * @param min minimum buckets to keep
  */
 void cutil_hmap_set_min_buckets(struct cutil_hmap_t* map, size_t min);
 
+/**
+ * @brief Grows the buckets so that n entries fit without crossing the max load factor
+ * 
+ * Bulk loads of a known size then need a single bucket allocation. The buckets are never shrunk by this call,
+ * and the resize always completes right away, even in incremental mode.
+ * 
+ * @param map pointer to the hmap
+ * @param n number of entries to make room for
+ * @return int 1 on success, 0 on allocation failure or if n entries need more than the largest power of two of
+ *             buckets
+ */
+int cutil_hmap_reserve(struct cutil_hmap_t* map, size_t n);
+
+/**
+ * @brief Shrinks the buckets to the smallest power of two holding the current entries below the max load factor
+ * 
+ * The resize always completes right away, even in incremental mode.
+ * 
+ * @param map pointer to the hmap
+ * @return int 1 on success, 0 on allocation failure
+ */
+int cutil_hmap_shrink_to_fit(struct cutil_hmap_t* map);
+
+/**
+ * @brief Enables incremental resizing
+ * 
+ * Default: 0 (disabled)
+ * 
+ * When enabled, a resize only allocates the new bucket array. The old and the new buckets coexist, lookups consult
+ * both, and every cutil_hmap_insert(), cutil_hmap_get() and cutil_hmap_del() migrates `step` buckets from the old
+ * array. This spreads the cost of a resize across operations instead of stalling the insert that triggered it.
+ * 
+ * Setting the step to 0 completes any resize in progress and goes back to resizing in one go.
+ * 
+ * @param map pointer to the hmap
+ * @param step number of buckets to migrate per operation
+ */
+void cutil_hmap_set_incremental(struct cutil_hmap_t* map, size_t step);
+
+/**
+ * @brief Hands a preallocated region to the entry allocator
+ * 
+ * Entries are allocated from the region before the map falls back to heap chunks. To never touch the heap for
+ * entries, also call cutil_hmap_set_pool_fixed(); inserts then fail once the region is full.
+ * 
+ * The region must stay valid until cutil_hmap_destroy().
+ * 
+ * @param map pointer to the hmap
+ * @param region memory to allocate entries from
+ * @param bytes size of the region. Use cutil_hmap_node_size() to size it
+ * @return size_t number of entries the region can hold
+ */
+size_t cutil_hmap_set_node_region(struct cutil_hmap_t* map, void* region, size_t bytes);
+
+/**
+ * @brief Stops the entry allocator from allocating more heap chunks
+ * 
+ * Default: 0 (the allocator grows as needed)
+ * 
+ * With fixed set, entries only come from the regions of cutil_hmap_set_node_region() and from the chunks already
+ * allocated, and inserts fail once those are used up. Owned keys longer than CUTIL_HMAP_INLINE_KEY still get their
+ * own heap allocation.
+ * 
+ * @param map pointer to the hmap
+ * @param fixed whether the entry allocator keeps its current size
+ */
+void cutil_hmap_set_pool_fixed(struct cutil_hmap_t* map, int fixed);
+
+/**
+ * @brief Get the number of bytes each entry takes in the entry allocator
+ * 
+ * @param map pointer to the hmap
+ * @return size_t bytes per entry
+ */
+size_t cutil_hmap_node_size(struct cutil_hmap_t* map);
+
+/**
+ * @brief Makes the map store its own copy of every key
+ * 
+ * Default: 0 (keys are borrowed)
+ * 
+ * Keys up to CUTIL_HMAP_INLINE_KEY bytes are copied into the entry itself, longer ones into the same allocation
+ * as their entry. Callers don't have to keep the keys alive, and comparing a key doesn't touch a second cache line.
+ * 
+ * The keys handed to the destructor then point into the map and must not be freed.
+ * 
+ * Only possible while the map is empty. Call it before cutil_hmap_set_node_region(), since it resets the entry
+ * allocator.
+ * 
+ * @param map pointer to the hmap
+ * @param owned whether the map owns its keys
+ * @return int 1 on success, 0 if the map is not empty
+ */
+int cutil_hmap_set_owned_keys(struct cutil_hmap_t* map, int owned);
+
 /**
  * @brief Get the number of elements in the hash map
  * 
@@ -163,6 +390,11 @@ size_t cutil_hmap_size(struct cutil_hmap_t* map);
  */
 int cutil_hmap_probe_key(struct cutil_hmap_t* map, struct cutil_hmap_key_t key);
 
+/**
+ * @brief cutil_hmap_probe_key() with the hash of the key from cutil_hmap_hash()
+ */
+int cutil_hmap_probe_key_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash);
+
 /**
  * @brief Computes the hash of the key and checks if the hash exists in the hash map without checking equality.
  * 
@@ -188,6 +420,11 @@ int cutil_hmap_probe_hashfn(struct cutil_hmap_t* map, struct cutil_hmap_key_t ke
  */
 int cutil_hmap_insert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t insert);
 
+/**
+ * @brief cutil_hmap_insert() with the hash of the key from cutil_hmap_hash()
+ */
+int cutil_hmap_insert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t insert, size_t hash);
+
 /**
  * @brief Get value from map corresponding to the key
  * 
@@ -197,6 +434,11 @@ int cutil_hmap_insert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t insert
  */
 void** cutil_hmap_get(struct cutil_hmap_t* map, struct cutil_hmap_key_t key);
 
+/**
+ * @brief cutil_hmap_get() with the hash of the key from cutil_hmap_hash()
+ */
+void** cutil_hmap_get_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash);
+
 /**
  * @brief Remove tuple from the hashmap
  * 
@@ -208,15 +450,207 @@ void** cutil_hmap_get(struct cutil_hmap_t* map, struct cutil_hmap_key_t key);
  */
 int cutil_hmap_del(struct cutil_hmap_t* map, struct cutil_hmap_key_t key);
 
+/**
+ * @brief cutil_hmap_del() with the hash of the key from cutil_hmap_hash()
+ */
+int cutil_hmap_del_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash);
+
+/**
+ * @brief Get the value slot of a key, inserting the tuple first if the key is missing
+ * 
+ * Hashes the key and walks its chain once, where a get followed by an insert does it twice.
+ * 
+ * @param map pointer to hmap
+ * @param t tuple to insert if the key is missing
+ * @param inserted receives 1 if the tuple was inserted, 0 if the key existed. May be NULL
+ * @return void** pointer to the value of the key, or NULL on allocation failure. Stays valid until the entry is
+ *                deleted
+ */
+void** cutil_hmap_get_or_insert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, int* inserted);
+
+/**
+ * @brief cutil_hmap_get_or_insert() with the hash of the key from cutil_hmap_hash()
+ */
+void** cutil_hmap_get_or_insert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash, int* inserted);
+
+/**
+ * @brief Insert the tuple, or overwrite the value if the key exists
+ * 
+ * An existing entry keeps its key. The destructor is not called on the replaced value, which is handed back
+ * through `previous` instead.
+ * 
+ * @param map pointer to hmap
+ * @param t tuple to insert
+ * @param previous receives the replaced value, or NULL if the key was missing. May be NULL
+ * @return void** pointer to the value of the key, or NULL on allocation failure
+ */
+void** cutil_hmap_upsert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, void** previous);
+
+/**
+ * @brief cutil_hmap_upsert() with the hash of the key from cutil_hmap_hash()
+ */
+void** cutil_hmap_upsert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash, void** previous);
+
+/**
+ * @brief Remove a tuple from the hashmap and hand it to the caller, without calling the destructor
+ * 
+ * When the map owns its keys, its copy is released and the key of `out` is the one passed in.
+ * 
+ * @param map pointer to hmap
+ * @param key key to remove
+ * @param out receives the removed tuple
+ * @return int number of tuples removed
+ */
+int cutil_hmap_take(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, struct cutil_hmap_tuple_t* out);
+
+/**
+ * @brief cutil_hmap_take() with the hash of the key from cutil_hmap_hash()
+ */
+int cutil_hmap_take_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash, struct cutil_hmap_tuple_t* out);
+
+/**
+ * @brief Get the values of a batch of keys
+ * 
+ * Keys are hashed a group at a time and their buckets are prefetched before any chain is walked, so the cache
+ * misses of independent keys overlap instead of stalling one after the other.
+ * 
+ * @param map pointer to hmap
+ * @param keys array of keys to search
+ * @param n number of keys
+ * @param values array of n pointers receiving the pointer to each value, or NULL for missing keys
+ * @return size_t number of keys found
+ */
+size_t cutil_hmap_get_many(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, size_t n, void*** values);
+
+/**
+ * @brief cutil_hmap_get_many() with hashes[i] the hash of keys[i] from cutil_hmap_hash()
+ */
+size_t cutil_hmap_get_many_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, const size_t* hashes, size_t n, void*** values);
+
+/**
+ * @brief Insert a batch of tuples into the hmap
+ * 
+ * Same semantics as calling cutil_hmap_insert() on each tuple in order, with the prefetching of
+ * cutil_hmap_get_many().
+ * 
+ * @param map pointer to hmap
+ * @param tuples array of tuples to insert
+ * @param n number of tuples
+ * @return size_t number of tuples added
+ */
+size_t cutil_hmap_insert_many(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t* tuples, size_t n);
+
+/**
+ * @brief cutil_hmap_insert_many() with hashes[i] the hash of the key of tuples[i] from cutil_hmap_hash()
+ */
+size_t cutil_hmap_insert_many_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t* tuples, const size_t* hashes, size_t n);
+
+/**
+ * @brief Remove a batch of keys from the hashmap
+ * 
+ * Same semantics as calling cutil_hmap_del() on each key in order, with the prefetching of
+ * cutil_hmap_get_many().
+ * 
+ * @param map pointer to hmap
+ * @param keys array of keys to delete
+ * @param n number of keys
+ * @return size_t number of tuples deleted
+ */
+size_t cutil_hmap_del_many(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, size_t n);
+
+/**
+ * @brief cutil_hmap_del_many() with hashes[i] the hash of keys[i] from cutil_hmap_hash()
+ */
+size_t cutil_hmap_del_many_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, const size_t* hashes, size_t n);
+
+/**
+ * @brief Takes a snapshot of the statistics of the map
+ * 
+ * Walks every bucket to build the chain length histogram, so this is O(buckets + size) and meant for diagnostics.
+ * A long tail in the histogram points at a weak hash function, a high average at a load factor that's set too
+ * high. Entries served from a caller supplied node region aren't counted in nodeBytes.
+ * 
+ * @param map pointer to the hmap
+ * @param stats receives the statistics
+ * @return int 1 on success, 0 on invalid arguments
+ */
+int cutil_hmap_stats(struct cutil_hmap_t* map, struct cutil_hmap_stats_t* stats);
+
+/**
+ * @brief Resets the operation counters of the map to zero
+ * 
+ * Not atomic as a whole: call it while no other thread uses the map.
+ * 
+ * @param map pointer to the hmap
+ */
+void cutil_hmap_stats_reset(struct cutil_hmap_t* map);
+
+/**
+ * @brief Cursor over the tuples of a range of buckets
+ * 
+ * Any insert or delete on the map invalidates its iterators.
+ */
 typedef struct cutil_hmap_iterator_t
 {
-  struct cutil_hmap_t* hmap;
-  size_t cur_bkt;
-  void* cur_nd;
+  struct cutil_hmap_t* hmap;  /// Map being iterated
+  size_t cur_bkt;             /// Bucket of the current node
+  size_t end_bkt;             /// One past the last bucket of the range
+  void* cur_nd;               /// Current node, NULL once the range is exhausted
 } cutil_hmap_iterator_t;
 
+/**
+ * @brief Creates an iterator positioned on the first tuple of the map
+ * 
+ * Completes any incremental resize in progress.
+ * 
+ * Usage: `for (t = cutil_hmap_iterator_peek(&it); t; t = cutil_hmap_iterator_next(&it))`
+ * 
+ * @param hmap pointer to the hmap
+ * @return struct cutil_hmap_iterator_t iterator
+ */
 struct cutil_hmap_iterator_t cutil_hmap_iterator_create(struct cutil_hmap_t* hmap);
+
+/**
+ * @brief Creates an iterator over the tuples of buckets [begin, end) only
+ * 
+ * Completes any incremental resize in progress.
+ * 
+ * @param hmap pointer to the hmap
+ * @param begin first bucket
+ * @param end one past the last bucket. Clamped to the bucket count
+ * @return struct cutil_hmap_iterator_t iterator
+ */
+struct cutil_hmap_iterator_t cutil_hmap_iterator_range(struct cutil_hmap_t* hmap, size_t begin, size_t end);
+
+/**
+ * @brief Splits the map into k iterators over disjoint bucket ranges
+ * 
+ * Together the iterators visit every tuple exactly once, so k threads can scan the map in parallel as long as
+ * nobody modifies it meanwhile. Completes any incremental resize in progress.
+ * 
+ * @param hmap pointer to the hmap
+ * @param iterators array receiving k iterators
+ * @param k number of partitions
+ * @return size_t number of iterators written
+ */
+size_t cutil_hmap_iterator_partition(struct cutil_hmap_t* hmap, struct cutil_hmap_iterator_t* iterators, size_t k);
+
+/**
+ * @brief Get the tuple the iterator is positioned on
+ * 
+ * The value may be modified through the returned tuple, the key must not be.
+ * 
+ * @param iterator pointer to the iterator
+ * @return struct cutil_hmap_tuple_t* current tuple, or NULL at the end
+ */
 struct cutil_hmap_tuple_t* cutil_hmap_iterator_peek(struct cutil_hmap_iterator_t* iterator);
+
+/**
+ * @brief Advance the iterator
+ * 
+ * @param iterator pointer to the iterator
+ * @return struct cutil_hmap_tuple_t* the new current tuple, or NULL at the end
+ */
 struct cutil_hmap_tuple_t* cutil_hmap_iterator_next(struct cutil_hmap_iterator_t* iterator);
 
 #ifdef __cplusplus
@@ -0,0 +1,135 @@
+#ifndef _CUTIL_HASH_MAP_FILE_H
+#define _CUTIL_HASH_MAP_FILE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cutil.h"
+#include "hash.h"
+#include "hmap.h"
+#include <stddef.h>
+
+/**
+ * @brief CUtil Hash Map File
+ *
+ * Read-only hash map image which is memory mapped and queried in place. Writing a cutil_hmap_t out with
+ * cutil_hmapfile_write() lays its keys and fixed size values out with offsets instead of pointers, so the image is
+ * relocatable and opening it costs a single mmap. Pages are only faulted in as lookups touch them.
+ *
+ * Entries are grouped by bucket into a single array, each bucket being a range of it, and carry the mixed hash of
+ * their key. A lookup hashes the key once, and only calls the compare function when the full hashes agree.
+ *
+ * The image uses the native byte order and is only meant to be read on the machine type that wrote it. It is
+ * trusted: beyond its header, the contents aren't validated.
+ *
+ * Initialize using the cutil_hmapfile_open() function
+ * Destroy using the cutil_hmapfile_close() function
+ */
+typedef struct cutil_hmapfile_t
+{
+  void* base;                       /// Start of the mapped image
+  size_t bytes;                     /// Size of the mapped image
+  size_t size;                      /// Number of items in the image
+  size_t buckets;                   /// Number of buckets, a power of two
+  size_t valueSize;                 /// Size of every value in bytes
+  const void* bucketIdx;            /// buckets + 1 entry indices. Bucket i holds entries [idx[i], idx[i + 1])
+  const void* entries;              /// Hash, key and value location of every entry
+  cutil_hash_func_t hashFn;         /// Hash function the image was written with
+  cutil_compare_func_t compareFn;   /// Comparison function telling identical keys apart, used when equalFn is NULL
+  cutil_equal_func_t equalFn;       /// Equality function to compare to see if two keys are identical
+} cutil_hmapfile_t;
+
+/**
+ * @brief Writes the tuples of a map to an image file
+ *
+ * Every value must point at `value_size` bytes, which are copied into the image. A NULL value is written as zeros.
+ * With a `value_size` of 0 only the keys are written. The image is written to a uniquely named temporary file next
+ * to `path`, synced to disk and renamed over it, and the directory is synced after the rename. Readers and
+ * concurrent writers never see a partial image, and after a crash `path` holds either the old image or the new
+ * one. The file is created with mode 0644.
+ *
+ * Completes any incremental resize in progress. A map with a keyed hash function (see
+ * cutil_hmap_set_keyed_hashfn()) is written with its plain hash function, since the seed stays private to the map.
+ *
+ * @param map pointer to the hmap
+ * @param path file to write
+ * @param value_size size of each value in bytes
+ * @return int 1 on success, 0 on failure
+ */
+int cutil_hmapfile_write(struct cutil_hmap_t* map, const char* path, size_t value_size);
+
+/**
+ * @brief Maps an image written by cutil_hmapfile_write() read-only
+ *
+ * The hash function defaults to the one cutil_hmap_init() picks. Use cutil_hmapfile_set_hashfn() if the map was
+ * written with another one.
+ *
+ * @param img pointer to an hmapfile
+ * @param path file to map
+ * @return int 1 on success, 0 if the file can't be mapped or isn't an image
+ */
+int cutil_hmapfile_open(struct cutil_hmapfile_t* img, const char* path);
+
+/**
+ * @brief Unmaps the image. Pointers handed out by cutil_hmapfile_get() become invalid
+ *
+ * @param img pointer to an hmapfile
+ */
+void cutil_hmapfile_close(struct cutil_hmapfile_t* img);
+
+/**
+ * @brief Sets the hash function. Must be the one the map was using when the image was written
+ *
+ * @param img pointer to the hmapfile
+ * @param hash_fn hash function
+ */
+void cutil_hmapfile_set_hashfn(struct cutil_hmapfile_t* img, cutil_hash_func_t hash_fn);
+
+/**
+ * @brief Compares keys with a three way comparison function, identical when it returns CUTIL_EQ
+ *
+ * @param img pointer to the hmapfile
+ * @param compare_fn compare function
+ */
+void cutil_hmapfile_set_comparefn(struct cutil_hmapfile_t* img, cutil_compare_func_t compare_fn);
+
+/**
+ * @brief Sets the function telling whether two keys are identical. Default is `cutil_equal_bytes`
+ *
+ * @param img pointer to the hmapfile
+ * @param equal_fn equality function
+ */
+void cutil_hmapfile_set_equalfn(struct cutil_hmapfile_t* img, cutil_equal_func_t equal_fn);
+
+/**
+ * @brief Get the number of elements in the image
+ *
+ * @param img pointer to the hmapfile
+ * @return size_t number of tuples
+ */
+size_t cutil_hmapfile_size(struct cutil_hmapfile_t* img);
+
+/**
+ * @brief Check to see if the key exists in the image
+ *
+ * @param img pointer to the hmapfile
+ * @param key key to test
+ * @return int boolean
+ */
+int cutil_hmapfile_probe_key(struct cutil_hmapfile_t* img, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Get the value corresponding to the key
+ *
+ * @param img pointer to the hmapfile
+ * @param key key to search
+ * @return const void* the valueSize bytes of the value inside the image, or NULL if the key isn't found. Values
+ *                     are aligned to 16 bytes. With a valueSize of 0, found keys return a non NULL pointer which
+ *                     must not be dereferenced
+ */
+const void* cutil_hmapfile_get(struct cutil_hmapfile_t* img, struct cutil_hmap_key_t key);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
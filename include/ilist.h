@@ -0,0 +1,231 @@
+#ifndef _CUTIL_ILIST_H
+#define _CUTIL_ILIST_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cutil.h"
+#include <stddef.h>
+
+/**
+ * @brief Link of an intrusive list, embedded in the objects to be listed
+ *
+ * An object can sit in as many lists as it has links. A link which isn't in a list points at itself.
+ */
+typedef struct cutil_ilist_link_t
+{
+  struct cutil_ilist_link_t* next;
+  struct cutil_ilist_link_t* prev;
+} cutil_ilist_link_t;
+
+/**
+ * @brief CUtil Intrusive List
+ *
+ * Doubly linked list of links embedded in the listed objects, which get their object back with
+ * cutil_ilist_entry(). The list never allocates: every operation is O(1) pointer updates, except the walks, and
+ * the list doesn't own its objects.
+ *
+ * The list is circular around the head link, so no operation branches on the ends. The head must not move while
+ * the list is in use.
+ *
+ * Initialize using the cutil_ilist_init() function
+ */
+typedef struct cutil_ilist_t
+{
+  struct cutil_ilist_link_t head;   /// Sentinel, head.next is the front and head.prev the back
+  size_t length;                    /// Number of linked objects
+} cutil_ilist_t;
+
+/**
+ * @brief Get the object a link is embedded in
+ *
+ * @param link pointer to the link
+ * @param type type of the object
+ * @param member name of the link in the object
+ */
+#define cutil_ilist_entry(link, type, member) cutil_container_of(link, type, member)
+
+/**
+ * @brief Walks the links of a list front to back. The current link must not be removed
+ *
+ * @param list pointer to the ilist
+ * @param link name of the `struct cutil_ilist_link_t*` variable to declare
+ */
+#define cutil_ilist_foreach(list, link) \
+  for (struct cutil_ilist_link_t* link = (list)->head.next; link != &(list)->head; link = link->next)
+
+/**
+ * @brief Initializes a link as not being in any list
+ */
+static inline void cutil_ilist_link_init(struct cutil_ilist_link_t* link)
+{
+  link->next = link;
+  link->prev = link;
+}
+
+/**
+ * @brief Check whether a link is in a list. Only valid for links set up with cutil_ilist_link_init()
+ */
+static inline int cutil_ilist_link_linked(struct cutil_ilist_link_t* link)
+{
+  return link->next != link;
+}
+
+/**
+ * @brief Constructor for the ilist object
+ *
+ * @param list pointer to an ilist
+ */
+static inline void cutil_ilist_init(struct cutil_ilist_t* list)
+{
+  cutil_ilist_link_init(&list->head);
+  list->length = 0;
+}
+
+static inline size_t cutil_ilist_size(struct cutil_ilist_t* list)
+{
+  return list->length;
+}
+
+static inline int cutil_ilist_empty(struct cutil_ilist_t* list)
+{
+  return list->head.next == &list->head;
+}
+
+/**
+ * @brief Get the first link, or NULL if the list is empty
+ */
+static inline struct cutil_ilist_link_t* cutil_ilist_front(struct cutil_ilist_t* list)
+{
+  return (cutil_ilist_empty(list)) ? NULL : list->head.next;
+}
+
+/**
+ * @brief Get the last link, or NULL if the list is empty
+ */
+static inline struct cutil_ilist_link_t* cutil_ilist_back(struct cutil_ilist_t* list)
+{
+  return (cutil_ilist_empty(list)) ? NULL : list->head.prev;
+}
+
+/**
+ * @brief Get the link after `link`, or NULL at the back
+ */
+static inline struct cutil_ilist_link_t* cutil_ilist_next(struct cutil_ilist_t* list, struct cutil_ilist_link_t* link)
+{
+  return (link->next == &list->head) ? NULL : link->next;
+}
+
+/**
+ * @brief Get the link before `link`, or NULL at the front
+ */
+static inline struct cutil_ilist_link_t* cutil_ilist_prev(struct cutil_ilist_t* list, struct cutil_ilist_link_t* link)
+{
+  return (link->prev == &list->head) ? NULL : link->prev;
+}
+
+/**
+ * @brief Links `link` right before `at`, which is in the list or is its head
+ *
+ * @param list pointer to the ilist
+ * @param at link to insert before. `&list->head` appends
+ * @param link link to insert, not in any list
+ */
+static inline void cutil_ilist_insert_before(struct cutil_ilist_t* list, struct cutil_ilist_link_t* at, struct cutil_ilist_link_t* link)
+{
+  link->next = at;
+  link->prev = at->prev;
+  at->prev->next = link;
+  at->prev = link;
+  list->length++;
+}
+
+/**
+ * @brief Links `link` right after `at`, which is in the list or is its head
+ *
+ * @param list pointer to the ilist
+ * @param at link to insert after. `&list->head` prepends
+ * @param link link to insert, not in any list
+ */
+static inline void cutil_ilist_insert_after(struct cutil_ilist_t* list, struct cutil_ilist_link_t* at, struct cutil_ilist_link_t* link)
+{
+  cutil_ilist_insert_before(list, at->next, link);
+}
+
+static inline void cutil_ilist_insert_front(struct cutil_ilist_t* list, struct cutil_ilist_link_t* link)
+{
+  cutil_ilist_insert_before(list, list->head.next, link);
+}
+
+static inline void cutil_ilist_insert_back(struct cutil_ilist_t* list, struct cutil_ilist_link_t* link)
+{
+  cutil_ilist_insert_before(list, &list->head, link);
+}
+
+/**
+ * @brief Unlinks a link from the list it is in. The link is left pointing at itself
+ *
+ * @param list pointer to the ilist holding the link
+ * @param link link to remove
+ */
+static inline void cutil_ilist_remove(struct cutil_ilist_t* list, struct cutil_ilist_link_t* link)
+{
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  cutil_ilist_link_init(link);
+  list->length--;
+}
+
+/**
+ * @brief Unlinks the first link
+ *
+ * @return struct cutil_ilist_link_t* the removed link, or NULL if the list is empty
+ */
+static inline struct cutil_ilist_link_t* cutil_ilist_remove_front(struct cutil_ilist_t* list)
+{
+  struct cutil_ilist_link_t* link = cutil_ilist_front(list);
+  if (link)
+    cutil_ilist_remove(list, link);
+  return link;
+}
+
+/**
+ * @brief Unlinks the last link
+ *
+ * @return struct cutil_ilist_link_t* the removed link, or NULL if the list is empty
+ */
+static inline struct cutil_ilist_link_t* cutil_ilist_remove_back(struct cutil_ilist_t* list)
+{
+  struct cutil_ilist_link_t* link = cutil_ilist_back(list);
+  if (link)
+    cutil_ilist_remove(list, link);
+  return link;
+}
+
+/**
+ * @brief Moves every link of `src` right before `at` in `list`, leaving `src` empty
+ *
+ * @param list pointer to the destination ilist
+ * @param at link of `list` to insert before. `&list->head` appends
+ * @param src list to take the links from, other than `list`
+ */
+static inline void cutil_ilist_splice(struct cutil_ilist_t* list, struct cutil_ilist_link_t* at, struct cutil_ilist_t* src)
+{
+  if (cutil_ilist_empty(src))
+    return;
+
+  struct cutil_ilist_link_t* first = src->head.next;
+  struct cutil_ilist_link_t* last = src->head.prev;
+  first->prev = at->prev;
+  last->next = at;
+  at->prev->next = first;
+  at->prev = last;
+
+  list->length += src->length;
+  cutil_ilist_init(src);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
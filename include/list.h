@@ -16,11 +16,14 @@ typedef struct cutil_list_node_t
 
 typedef void (*cutil_list_node_destructor_t)(void*);
 
+struct cutil_list_blocks_t;
+
 typedef struct cutil_list_t
 {
   struct cutil_list_node_t* root;
   struct cutil_list_node_t* end;
   size_t length;
+  struct cutil_list_blocks_t* blocks;     /// Node blocks of cutil_list_insert_array() the list holds nodes of, or NULL
 } cutil_list_t;
 
 typedef struct cutil_list_iterator_t
@@ -31,24 +34,117 @@ typedef struct cutil_list_iterator_t
 
 void cutil_list_node_init(struct cutil_list_node_t* node);
 void cutil_list_node_destroy(struct cutil_list_node_t* node);
+
+/**
+ * @brief Get the slot of the element of a node
+ *
+ * @param node pointer to the node
+ * @return void** pointer to the data field of the node, which can be read or written through, or NULL
+ */
 void** cutil_list_node_data(struct cutil_list_node_t* node);
 
 void cutil_list_init(struct cutil_list_t* list);
 void cutil_list_destroy(struct cutil_list_t* list, cutil_list_node_destructor_t element_destructor_fn);
 size_t cutil_list_size(struct cutil_list_t* list);
 
+/**
+ * @brief Get the node at a position
+ *
+ * @param list pointer to the list
+ * @param pos position, negative counting from the back. pos and pos - size name the same node
+ * @return struct cutil_list_node_t* the node, or NULL if out of range
+ */
 struct cutil_list_node_t* cutil_list_get(struct cutil_list_t* list, ptrdiff_t pos);
+
+/**
+ * @brief Insert an element so that it ends up at the position
+ *
+ * An empty list accepts positions 0, -1, CUTIL_BEG and CUTIL_END.
+ *
+ * @param list pointer to the list
+ * @param data element to insert
+ * @param pos position, from 0 to the size. Negative counts from the back, -1 appending
+ * @return int 1 if inserted, 0 if the position is out of range or on allocation failure
+ */
 int cutil_list_insert(struct cutil_list_t* list, void* data, ptrdiff_t pos);
+
+/**
+ * @brief Remove the element at a position
+ *
+ * @param list pointer to the list
+ * @param pos position, negative counting from the back
+ * @return void* the removed element, or NULL if out of range
+ */
 void* cutil_list_remove(struct cutil_list_t* list, ptrdiff_t pos);
 
 struct cutil_list_node_t* cutil_list_back(struct cutil_list_t* list);
 int cutil_list_insert_back(struct cutil_list_t* list, void* data);
 void* cutil_list_remove_back(struct cutil_list_t* list);
 
+/**
+ * @brief Get the first node
+ *
+ * @param list pointer to the list
+ * @return struct cutil_list_node_t* the first node, or NULL if the list is empty
+ */
 struct cutil_list_node_t* cutil_list_front(struct cutil_list_t* list);
 int cutil_list_insert_front(struct cutil_list_t* list, void* data);
 void* cutil_list_remove_front(struct cutil_list_t* list);
 
+/**
+ * @brief Insert an array of elements so that the first ends up at the position
+ *
+ * All the nodes of the batch come from a single allocation, released along with the last of them, so the memory of
+ * a batch only comes back once all its nodes are removed. While a list holds batches, freeing a node costs a binary
+ * search over them.
+ *
+ * @param list pointer to the list
+ * @param data elements to insert, in order
+ * @param count number of elements
+ * @param pos position, from 0 to the size. Negative counts from the back, -1 appending
+ * @return int 1 if inserted, 0 if the position is out of range or on allocation failure
+ */
+int cutil_list_insert_array(struct cutil_list_t* list, void* const* data, size_t count, ptrdiff_t pos);
+
+/**
+ * @brief Move the nodes from first to last out of other and in front of at, without copying them
+ *
+ * O(1) when count is given, otherwise the range is walked once to count it. When other holds batches of
+ * cutil_list_insert_array(), the range is also walked to share the batches of the moved nodes with list, which
+ * costs O(count log batches). The lists may be the same, as long as at is not within the range.
+ *
+ * @param list list receiving the nodes
+ * @param at node of list to insert in front of, or NULL to append
+ * @param other list holding the nodes
+ * @param first first node to move
+ * @param last last node to move, first or after it in other
+ * @param count number of nodes from first to last, or 0 if not known
+ * @return int 1 if moved, 0 on invalid arguments or allocation failure, leaving both lists as they were
+ */
+int cutil_list_splice(struct cutil_list_t* list, struct cutil_list_node_t* at, struct cutil_list_t* other,
+  struct cutil_list_node_t* first, struct cutil_list_node_t* last, size_t count);
+
+/**
+ * @brief Move the elements from a position on to the back of tail
+ *
+ * @param list pointer to the list
+ * @param pos position of the first element to move, from 0 to the size. Negative counts from the back
+ * @param tail list receiving the elements
+ * @return int 1 if split, 0 if the position is out of range or on allocation failure
+ */
+int cutil_list_split_at(struct cutil_list_t* list, ptrdiff_t pos, struct cutil_list_t* tail);
+
+/**
+ * @brief Move all the elements of other to the back of list in O(1), leaving other empty
+ *
+ * Costs O(n log batches) if other holds batches of cutil_list_insert_array(), see cutil_list_splice().
+ *
+ * @param list pointer to the list
+ * @param other list to empty into list
+ * @return int 1 if moved, 0 on invalid arguments or allocation failure
+ */
+int cutil_list_concat(struct cutil_list_t* list, struct cutil_list_t* other);
+
 void cutil_list_iterator_init(struct cutil_list_iterator_t* iterator, struct cutil_list_t* list, struct cutil_list_node_t* start);
 void cutil_list_iterator_destroy(struct cutil_list_iterator_t* iterator);
 
@@ -0,0 +1,97 @@
+#ifndef _CUTIL_POOL_H
+#define _CUTIL_POOL_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/**
+ * @brief CUtil Object Pool
+ *
+ * Slab allocator for objects of a single size. Objects are carved out of large chunks, released objects are kept
+ * on an intrusive free list, and destroying the pool releases every object at once in O(chunks).
+ *
+ * Initialize using the cutil_pool_init() function
+ * Destroy using the cutil_pool_destroy() function
+ */
+typedef struct cutil_pool_t
+{
+  void* chunks;       /// Chunks allocated from the heap, linked through their headers
+  void* freeList;     /// Released objects, linked through their first word
+  char* cursor;       /// Next never-used object in the current chunk or region
+  char* limit;        /// End of the current chunk or region
+  size_t objSize;     /// Size of each object, rounded up to the object alignment
+  size_t chunkObjs;   /// Number of objects per heap chunk. 0 never touches the heap
+} cutil_pool_t;
+
+/**
+ * @brief Constructor for the pool object
+ *
+ * @param pool pointer to a pool
+ * @param obj_size size of each object
+ * @param chunk_objs number of objects to allocate per heap chunk. 0 only serves objects from regions
+ */
+void cutil_pool_init(struct cutil_pool_t* pool, size_t obj_size, size_t chunk_objs);
+
+/**
+ * @brief Changes how many objects the heap chunks allocated from now on hold
+ *
+ * Chunks already allocated are kept. With 0, the pool stops growing and only hands out what it holds.
+ *
+ * @param pool pointer to a pool
+ * @param chunk_objs number of objects per heap chunk. 0 never touches the heap again
+ */
+void cutil_pool_set_chunk_objs(struct cutil_pool_t* pool, size_t chunk_objs);
+
+/**
+ * @brief Destructor for the pool object
+ *
+ * Frees every heap chunk, invalidating all objects handed out. Regions remain owned by the caller.
+ *
+ * @param pool pointer to a pool
+ */
+void cutil_pool_destroy(struct cutil_pool_t* pool);
+
+/**
+ * @brief Hands a caller owned memory region to the pool
+ *
+ * Objects are served from the region before any heap chunk is allocated. The region must outlive the pool.
+ *
+ * @param pool pointer to a pool
+ * @param region memory to carve objects from
+ * @param bytes size of the region
+ * @return size_t number of objects the region can hold
+ */
+size_t cutil_pool_add_region(struct cutil_pool_t* pool, void* region, size_t bytes);
+
+/**
+ * @brief Get an object from the pool
+ *
+ * @param pool pointer to a pool
+ * @return void* uninitialized object, or NULL if the pool is exhausted
+ */
+void* cutil_pool_alloc(struct cutil_pool_t* pool);
+
+/**
+ * @brief Return an object to the pool
+ *
+ * @param pool pointer to the pool the object was allocated from
+ * @param obj object to release
+ */
+void cutil_pool_free(struct cutil_pool_t* pool, void* obj);
+
+/**
+ * @brief Get the number of bytes the pool holds on the heap
+ *
+ * Counts every heap chunk, whether its objects are in use or not. Regions are not included.
+ *
+ * @param pool pointer to a pool
+ * @return size_t bytes allocated for chunks
+ */
+size_t cutil_pool_heap_bytes(struct cutil_pool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
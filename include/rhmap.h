@@ -0,0 +1,146 @@
+#ifndef _CUTIL_READ_HASH_MAP_H
+#define _CUTIL_READ_HASH_MAP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cutil.h"
+#include "epoch.h"
+#include "hash.h"
+#include "hmap.h"
+#include <stddef.h>
+
+/**
+ * @brief CUtil Read Optimized Hash Map
+ *
+ * Concurrent chained hash map for read mostly workloads. Readers never take a lock: bucket heads and chain links
+ * are published atomically, and a resize builds a complete new table which is swapped in with a single store.
+ * Unlinked entries and replaced tables are released through an epoch domain once no reader can still see them.
+ * Writers are serialized by a mutex.
+ *
+ * Keys and values are borrowed, like cutil_hmap_t. Removed keys and values are handed to the destructor only after
+ * the readers are done with them.
+ *
+ * Initialize using the cutil_rhmap_init() function
+ * Destroy using the cutil_rhmap_destroy() function
+ */
+typedef struct cutil_rhmap_t
+{
+  void* shared;                     /// Published bucket table, writer lock and element count
+  struct cutil_epoch_t epoch;       /// Reclamation domain for unlinked entries and old tables
+  size_t minBuckets;                /// Minimum number of buckets to keep
+  cutil_hash_func_t hashFn;         /// Hash function to hash the keys with
+  cutil_compare_func_t compareFn;   /// Comparison function telling identical keys apart, used when equalFn is NULL
+  cutil_equal_func_t equalFn;       /// Equality function to compare to see if two keys are identical
+  cutil_destructor_func_t destuctor;/// Method to dellocate data and cleanup an entry
+} cutil_rhmap_t;
+
+/**
+ * @brief Constructor for the rhmap object
+ *
+ * @param map pointer to a rhmap
+ * @return int 1 on success, 0 on allocation failure
+ */
+int cutil_rhmap_init(struct cutil_rhmap_t* map);
+
+/**
+ * @brief Destructor for the rhmap object
+ *
+ * Must not race with any other operation on the map.
+ *
+ * @param map pointer to a rhmap
+ */
+void cutil_rhmap_destroy(struct cutil_rhmap_t* map);
+
+/**
+ * @brief Sets the destructor for each entry. See cutil_hmap_set_destructor()
+ *
+ * @param map pointer to the rhmap
+ * @param destructor destructor function to use
+ */
+void cutil_rhmap_set_destructor(struct cutil_rhmap_t* map, cutil_destructor_func_t destructor);
+
+/**
+ * @brief Sets the hash function to hash the keys with. Only takes effect while the map is empty
+ *
+ * Must not race with any other operation on the map.
+ *
+ * @param map pointer to the rhmap
+ * @param hash_fn hash function
+ */
+void cutil_rhmap_set_hashfn(struct cutil_rhmap_t* map, cutil_hash_func_t hash_fn);
+
+/**
+ * @brief Sets the function telling whether two keys are identical. Only takes effect while the map is empty
+ *
+ * Default is `cutil_equal_bytes`. Must not race with any other operation on the map.
+ *
+ * @param map pointer to the rhmap
+ * @param equal_fn equality function
+ */
+void cutil_rhmap_set_equalfn(struct cutil_rhmap_t* map, cutil_equal_func_t equal_fn);
+
+/**
+ * @brief Compares keys with a three way comparison function instead of an equality function
+ *
+ * Keys are identical when it returns CUTIL_EQ. Only takes effect while the map is empty. Must not race with any
+ * other operation on the map.
+ *
+ * @param map pointer to the rhmap
+ * @param compare_fn comparison function, like `cutil_compare_lex`
+ */
+void cutil_rhmap_set_comparefn(struct cutil_rhmap_t* map, cutil_compare_func_t compare_fn);
+
+/**
+ * @brief Get the number of elements in the map
+ *
+ * @param map pointer to the rhmap
+ * @return size_t number of tuples
+ */
+size_t cutil_rhmap_size(struct cutil_rhmap_t* map);
+
+/**
+ * @brief Check to see if the key exists in the map. Wait-free
+ *
+ * @param map pointer to the rhmap
+ * @param key key to test
+ * @return int boolean
+ */
+int cutil_rhmap_probe_key(struct cutil_rhmap_t* map, struct cutil_hmap_key_t key);
+
+/**
+ * @brief Get value from map corresponding to the key. Wait-free
+ *
+ * The value is copied out, since the entry may be unlinked right after the lookup.
+ *
+ * @param map pointer to the rhmap
+ * @param key key to search
+ * @param value receives the value if the key is found. May be NULL
+ * @return int 1 if found, 0 otherwise
+ */
+int cutil_rhmap_get(struct cutil_rhmap_t* map, struct cutil_hmap_key_t key, void** value);
+
+/**
+ * @brief Insert into the map
+ *
+ * @param map pointer to the rhmap
+ * @param insert tuple to insert
+ * @return int number of elements added (1 or 0)
+ */
+int cutil_rhmap_insert(struct cutil_rhmap_t* map, struct cutil_hmap_tuple_t insert);
+
+/**
+ * @brief Remove tuple from the map
+ *
+ * The destructor runs once no reader can observe the entry any more.
+ *
+ * @param map pointer to the rhmap
+ * @param key key to delete
+ * @return int number of tuples deleted
+ */
+int cutil_rhmap_del(struct cutil_rhmap_t* map, struct cutil_hmap_key_t key);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,153 @@
+#ifndef _CUTIL_SKIPLIST_H
+#define _CUTIL_SKIPLIST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "list.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of levels of a skip list. With a quarter of the nodes promoted per level, enough for 4^16 elements
+ */
+#define CUTIL_SKIPLIST_MAX_LEVEL 16
+
+struct cutil_skiplist_node_t;
+
+/**
+ * @brief Forward link of a skip list level, along with the number of elements it skips
+ */
+typedef struct cutil_skiplist_link_t
+{
+  struct cutil_skiplist_node_t* next;
+  size_t width;                           /// Position of next minus the position of the link's node. Past the back, next is at size + 1
+} cutil_skiplist_link_t;
+
+/**
+ * @brief CUtil Indexable Skip List
+ *
+ * List with the positional operations of cutil_list_t in O(log n) rather than O(n): every link of the skip list
+ * knows how many elements it jumps over, so reaching a position follows O(log n) links, and an insert or a remove
+ * updates O(log n) widths. Reading the front or the back is O(1), but inserting or removing there is O(log n) like
+ * anywhere else, since every level's link over the end has its width updated.
+ *
+ * Positions follow cutil_list_t: 0 is the first element, -1 the last, CUTIL_BEG and CUTIL_END the ends. Functions
+ * which return an element return a pointer to its slot, which stays valid until the element is removed.
+ *
+ * Initialize using the cutil_skiplist_init() function
+ * Destroy using the cutil_skiplist_destroy() function
+ */
+typedef struct cutil_skiplist_t
+{
+  struct cutil_skiplist_link_t head[CUTIL_SKIPLIST_MAX_LEVEL]; /// Links of the head, at position 0
+  struct cutil_skiplist_node_t* end;      /// Last node
+  size_t length;                          /// Number of elements
+  size_t level;                           /// Number of levels in use
+  uint64_t rng;                           /// State of the generator drawing the node levels
+} cutil_skiplist_t;
+
+/**
+ * @brief Cursor over the elements of a skip list
+ */
+typedef struct cutil_skiplist_iterator_t
+{
+  struct cutil_skiplist_t* list;
+  struct cutil_skiplist_node_t* node;     /// Current node, NULL past either end
+} cutil_skiplist_iterator_t;
+
+/**
+ * @brief Constructor for the skiplist object
+ *
+ * @param list pointer to a skiplist
+ */
+void cutil_skiplist_init(struct cutil_skiplist_t* list);
+
+/**
+ * @brief Destructor for the skiplist object
+ *
+ * @param list pointer to a skiplist
+ * @param element_destructor_fn called on every element, or NULL
+ */
+void cutil_skiplist_destroy(struct cutil_skiplist_t* list, cutil_list_node_destructor_t element_destructor_fn);
+
+/**
+ * @brief Get the number of elements in the list
+ *
+ * @param list pointer to the skiplist
+ * @return size_t number of elements
+ */
+size_t cutil_skiplist_size(struct cutil_skiplist_t* list);
+
+/**
+ * @brief Get the element at a position in O(log n)
+ *
+ * @param list pointer to the skiplist
+ * @param pos position, negative counting from the back
+ * @return void** pointer to the element, or NULL if out of range
+ */
+void** cutil_skiplist_get(struct cutil_skiplist_t* list, ptrdiff_t pos);
+
+/**
+ * @brief Insert an element so that it ends up at the position, in O(log n)
+ *
+ * @param list pointer to the skiplist
+ * @param data element to insert
+ * @param pos position, from 0 to the size. Negative counts from the back, -1 appending
+ * @return int 1 if inserted, 0 if the position is out of range or on allocation failure
+ */
+int cutil_skiplist_insert(struct cutil_skiplist_t* list, void* data, ptrdiff_t pos);
+
+/**
+ * @brief Remove the element at a position in O(log n)
+ *
+ * @param list pointer to the skiplist
+ * @param pos position, negative counting from the back
+ * @return void* the removed element, or NULL if out of range
+ */
+void* cutil_skiplist_remove(struct cutil_skiplist_t* list, ptrdiff_t pos);
+
+void** cutil_skiplist_back(struct cutil_skiplist_t* list);
+int cutil_skiplist_insert_back(struct cutil_skiplist_t* list, void* data);
+void* cutil_skiplist_remove_back(struct cutil_skiplist_t* list);
+
+void** cutil_skiplist_front(struct cutil_skiplist_t* list);
+int cutil_skiplist_insert_front(struct cutil_skiplist_t* list, void* data);
+void* cutil_skiplist_remove_front(struct cutil_skiplist_t* list);
+
+/**
+ * @brief Points an iterator at the element at a position
+ *
+ * @param iterator iterator to initialize
+ * @param list pointer to the skiplist
+ * @param pos position of the first element to visit, negative counting from the back
+ */
+void cutil_skiplist_iterator_init(struct cutil_skiplist_iterator_t* iterator, struct cutil_skiplist_t* list, ptrdiff_t pos);
+void cutil_skiplist_iterator_destroy(struct cutil_skiplist_iterator_t* iterator);
+
+/**
+ * @brief Get the current element
+ *
+ * @return void** pointer to the element, or NULL past either end
+ */
+void** cutil_skiplist_iterator_get(struct cutil_skiplist_iterator_t* iterator);
+
+/**
+ * @brief Move to the next element
+ *
+ * @return void** pointer to the new current element, or NULL past the back
+ */
+void** cutil_skiplist_iterator_next(struct cutil_skiplist_iterator_t* iterator);
+
+/**
+ * @brief Move to the previous element
+ *
+ * @return void** pointer to the new current element, or NULL past the front
+ */
+void** cutil_skiplist_iterator_back(struct cutil_skiplist_iterator_t* iterator);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
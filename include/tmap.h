@@ -0,0 +1,229 @@
+#ifndef _CUTIL_TYPED_HASH_MAP_H
+#define _CUTIL_TYPED_HASH_MAP_H
+
+#include "flatmap.h"
+#include "hash.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * @brief Hash for integer keys, for use with CUTIL_HMAP_DECLARE(). The generated map mixes every hash anyway
+ */
+#define CUTIL_HMAP_HASH_INT(key) ((size_t) (key))
+
+/**
+ * @brief Equality for keys comparable with ==, for use with CUTIL_HMAP_DECLARE()
+ */
+#define CUTIL_HMAP_EQ_VALUE(a, b) ((a) == (b))
+
+/**
+ * @brief Declares a hash map specialized for a key and a value type
+ *
+ * Generates the `name_t` map type and its `static inline` functions. The map runs on the control bytes and group
+ * probing of cutil_flatmap_t, from flatprobe.h, but with the key and the value stored by value in every slot, and
+ * with the hash and equality called directly so that the compiler can inline them. A lookup of a `uint64_t` key is
+ * then a multiply-xorshift, a group compare and a single integer compare, without any indirect call.
+ *
+ * `hash(key)` must return something convertible to size_t. It doesn't need to be well distributed, since the map
+ * mixes it with cutil_hash_mix(). `eq(a, b)` must return non zero if the keys are identical. Both may be macros.
+ *
+ * Generated functions, where `name_t` is the map:
+ * * `int name_init(name_t* map)` - 1 on success, 0 on allocation failure
+ * * `void name_destroy(name_t* map)`
+ * * `size_t name_size(name_t* map)`
+ * * `int name_reserve(name_t* map, size_t n)` - grows so that n entries fit without resizing
+ * * `val_t* name_get(name_t* map, key_t key)` - pointer to the value, or NULL. Invalidated by the next insert
+ * * `int name_insert(name_t* map, key_t key, val_t value)` - 1 if inserted, 0 if the key exists or on failure
+ * * `int name_del(name_t* map, key_t key)` - number of entries removed
+ *
+ * Keys and values are copied in and out with plain assignment, and nothing is released when entries are deleted.
+ * Declare the map once per translation unit, outside of any function.
+ *
+ * Example: `CUTIL_HMAP_DECLARE(u64map, uint64_t, double, CUTIL_HMAP_HASH_INT, CUTIL_HMAP_EQ_VALUE)`
+ *
+ * @param name prefix of the generated type and functions
+ * @param key_t key type
+ * @param val_t value type
+ * @param hash hash function or macro taking a key
+ * @param eq equality function or macro taking two keys
+ */
+#define CUTIL_HMAP_DECLARE(name, key_t, val_t, hash, eq)                                                          \
+  typedef struct name##_slot                                                                                      \
+  {                                                                                                               \
+    key_t key;                                                                                                    \
+    val_t value;                                                                                                  \
+  } name##_slot;                                                                                                  \
+                                                                                                                  \
+  typedef struct name##_t                                                                                         \
+  {                                                                                                               \
+    name##_slot* slots;       /* Flat array of key/value slots */                                                 \
+    unsigned char* ctrl;      /* Control byte for each slot, see cutil_flatmap_t */                               \
+    size_t capacity;          /* Number of slots. Power of two and a multiple of the group width */               \
+    size_t size;              /* Number of items in the map */                                                    \
+    size_t tombstones;        /* Number of slots marked as deleted */                                             \
+  } name##_t;                                                                                                     \
+                                                                                                                  \
+  static inline size_t name##_hash_(key_t key)                                                                    \
+  {                                                                                                               \
+    return cutil_hash_mix((size_t) (hash(key)));                                                                  \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline int name##_alloc_(struct name##_t* map, size_t capacity)                                          \
+  {                                                                                                               \
+    unsigned char* ctrl = (unsigned char*) malloc(capacity);                                                      \
+    name##_slot* slots = (name##_slot*) malloc(sizeof(*slots) * capacity);                                        \
+    if (!ctrl || !slots)                                                                                          \
+    {                                                                                                             \
+      free(ctrl);                                                                                                 \
+      free(slots);                                                                                                \
+      return 0;                                                                                                   \
+    }                                                                                                             \
+                                                                                                                  \
+    cutil_flatmap_ctrl_clear(ctrl, capacity);                                                                     \
+                                                                                                                  \
+    map->ctrl = ctrl;                                                                                             \
+    map->slots = slots;                                                                                           \
+    map->capacity = capacity;                                                                                     \
+    map->tombstones = 0;                                                                                          \
+    return 1;                                                                                                     \
+  }                                                                                                               \
+                                                                                                                  \
+  /* Key looked up by name##_find_() */                                                                           \
+  typedef struct name##_query_                                                                                    \
+  {                                                                                                               \
+    const name##_slot* slots;                                                                                     \
+    key_t key;                                                                                                    \
+  } name##_query_;                                                                                                \
+                                                                                                                  \
+  static inline int name##_match_(const void* ctx, size_t idx)                                                    \
+  {                                                                                                               \
+    const name##_query_* q = (const name##_query_*) ctx;                                                          \
+    return eq(q->key, q->slots[idx].key);                                                                         \
+  }                                                                                                               \
+                                                                                                                  \
+  /* Returns the slot index of the key, or capacity if it is not in the map */                                    \
+  static inline size_t name##_find_(struct name##_t* map, key_t key, size_t h)                                    \
+  {                                                                                                               \
+    name##_query_ q;                                                                                              \
+    q.slots = map->slots;                                                                                         \
+    q.key = key;                                                                                                  \
+    return cutil_flatmap_find(map->ctrl, map->capacity, h, name##_match_, &q);                                    \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline int name##_resize_(struct name##_t* map, size_t capacity)                                         \
+  {                                                                                                               \
+    unsigned char* old_ctrl = map->ctrl;                                                                          \
+    name##_slot* old_slots = map->slots;                                                                          \
+    size_t old_capacity = map->capacity;                                                                          \
+                                                                                                                  \
+    if (!name##_alloc_(map, capacity))                                                                            \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    for (size_t i = 0; i < old_capacity; i++)                                                                     \
+    {                                                                                                             \
+      if (!cutil_flatmap_ctrl_full(old_ctrl[i]))                                                                  \
+        continue;                                                                                                 \
+                                                                                                                  \
+      size_t h = name##_hash_(old_slots[i].key);                                                                  \
+      map->slots[cutil_flatmap_claim(map->ctrl, map->capacity, h, NULL)] = old_slots[i];                          \
+    }                                                                                                             \
+                                                                                                                  \
+    free(old_ctrl);                                                                                               \
+    free(old_slots);                                                                                              \
+    return 1;                                                                                                     \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline int name##_init(struct name##_t* map)                                                             \
+  {                                                                                                               \
+    if (!map)                                                                                                     \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    map->slots = NULL;                                                                                            \
+    map->ctrl = NULL;                                                                                             \
+    map->capacity = 0;                                                                                            \
+    map->size = 0;                                                                                                \
+    map->tombstones = 0;                                                                                          \
+    return name##_alloc_(map, CUTIL_FLATMAP_GROUP_WIDTH);                                                         \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline void name##_destroy(struct name##_t* map)                                                         \
+  {                                                                                                               \
+    if (!map)                                                                                                     \
+      return;                                                                                                     \
+                                                                                                                  \
+    free(map->ctrl);                                                                                              \
+    free(map->slots);                                                                                             \
+    map->slots = NULL;                                                                                            \
+    map->ctrl = NULL;                                                                                             \
+    map->capacity = 0;                                                                                            \
+    map->size = 0;                                                                                                \
+    map->tombstones = 0;                                                                                          \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline size_t name##_size(struct name##_t* map)                                                          \
+  {                                                                                                               \
+    return (map) ? map->size : 0;                                                                                 \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline int name##_reserve(struct name##_t* map, size_t n)                                                \
+  {                                                                                                               \
+    if (!map || !map->ctrl)                                                                                       \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    /* same 7/8 max load factor as cutil_flatmap_t */                                                             \
+    size_t capacity = map->capacity;                                                                              \
+    while (n + map->tombstones > capacity / 8 * 7)                                                                \
+      capacity *= 2;                                                                                              \
+    return (capacity == map->capacity) ? 1 : name##_resize_(map, capacity);                                       \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline val_t* name##_get(struct name##_t* map, key_t key)                                                \
+  {                                                                                                               \
+    if (!map || !map->ctrl)                                                                                       \
+      return NULL;                                                                                                \
+                                                                                                                  \
+    size_t idx = name##_find_(map, key, name##_hash_(key));                                                       \
+    return (idx == map->capacity) ? NULL : &map->slots[idx].value;                                                \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline int name##_insert(struct name##_t* map, key_t key, val_t value)                                   \
+  {                                                                                                               \
+    if (!map || !map->ctrl)                                                                                       \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    size_t h = name##_hash_(key);                                                                                 \
+    if (name##_find_(map, key, h) != map->capacity)                                                               \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    /* grow, or just purge the tombstones, at the same 7/8 max load factor as cutil_flatmap_t */                  \
+    size_t capacity = cutil_flatmap_grow_for_insert(map->capacity, map->size, map->tombstones, 0.875f);           \
+    if (capacity && !name##_resize_(map, capacity))                                                               \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    size_t idx = cutil_flatmap_claim(map->ctrl, map->capacity, h, &map->tombstones);                              \
+    if (idx == map->capacity)                                                                                     \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    map->slots[idx].key = key;                                                                                    \
+    map->slots[idx].value = value;                                                                                \
+    map->size++;                                                                                                  \
+    return 1;                                                                                                     \
+  }                                                                                                               \
+                                                                                                                  \
+  static inline int name##_del(struct name##_t* map, key_t key)                                                   \
+  {                                                                                                               \
+    if (!map || !map->ctrl)                                                                                       \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    size_t idx = name##_find_(map, key, name##_hash_(key));                                                       \
+    if (idx == map->capacity)                                                                                     \
+      return 0;                                                                                                   \
+                                                                                                                  \
+    cutil_flatmap_erase(map->ctrl, idx, &map->tombstones);                                                        \
+    map->size--;                                                                                                  \
+    return 1;                                                                                                     \
+  }                                                                                                               \
+                                                                                                                  \
+  typedef int name##_declared_
+
+#endif
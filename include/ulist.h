@@ -0,0 +1,156 @@
+#ifndef _CUTIL_ULIST_H
+#define _CUTIL_ULIST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "list.h"
+#include <stddef.h>
+
+/**
+ * @brief Number of elements per node. A node fills exactly two 64 byte cache lines on 64 bit targets
+ */
+#define CUTIL_ULIST_NODE_CAP 13
+
+/**
+ * @brief Node of an unrolled list, holding up to CUTIL_ULIST_NODE_CAP elements in order
+ */
+typedef struct cutil_ulist_node_t
+{
+  struct cutil_ulist_node_t* next;
+  struct cutil_ulist_node_t* prev;
+  size_t count;                           /// Number of elements used in data
+  void* data[CUTIL_ULIST_NODE_CAP];
+} cutil_ulist_node_t;
+
+/**
+ * @brief CUtil Unrolled List
+ *
+ * Doubly linked list of small arrays of elements. It has the operations of cutil_list_t, but takes about a third of
+ * the memory per element, and traversals mostly read consecutive slots of the same cache lines instead of chasing a
+ * pointer per element. Positional lookups skip whole nodes. Every node but the first and the last stays at least half
+ * full, so inserts and removes in the middle cost at most two thirds of the memory of cutil_list_t.
+ *
+ * Elements are addressed by position, like cutil_list_t: 0 is the first, -1 the last, CUTIL_BEG and CUTIL_END the
+ * ends. Functions which return an element return a pointer to its slot, which stays valid until the next insert or
+ * remove.
+ *
+ * Initialize using the cutil_ulist_init() function
+ * Destroy using the cutil_ulist_destroy() function
+ */
+typedef struct cutil_ulist_t
+{
+  struct cutil_ulist_node_t* root;
+  struct cutil_ulist_node_t* end;
+  size_t length;                          /// Number of elements
+  size_t nodes;                           /// Number of nodes
+} cutil_ulist_t;
+
+/**
+ * @brief Cursor over the elements of an unrolled list
+ */
+typedef struct cutil_ulist_iterator_t
+{
+  struct cutil_ulist_t* list;
+  struct cutil_ulist_node_t* node;        /// Node of the current element, NULL past either end
+  size_t index;                           /// Slot of the current element in node
+} cutil_ulist_iterator_t;
+
+/**
+ * @brief Constructor for the ulist object
+ *
+ * @param list pointer to a ulist
+ */
+void cutil_ulist_init(struct cutil_ulist_t* list);
+
+/**
+ * @brief Destructor for the ulist object
+ *
+ * @param list pointer to a ulist
+ * @param element_destructor_fn called on every element, or NULL
+ */
+void cutil_ulist_destroy(struct cutil_ulist_t* list, cutil_list_node_destructor_t element_destructor_fn);
+
+/**
+ * @brief Get the number of elements in the list
+ *
+ * @param list pointer to the ulist
+ * @return size_t number of elements
+ */
+size_t cutil_ulist_size(struct cutil_ulist_t* list);
+
+/**
+ * @brief Get the element at a position
+ *
+ * @param list pointer to the ulist
+ * @param pos position, negative counting from the back
+ * @return void** pointer to the element, or NULL if out of range
+ */
+void** cutil_ulist_get(struct cutil_ulist_t* list, ptrdiff_t pos);
+
+/**
+ * @brief Insert an element so that it ends up at the position
+ *
+ * @param list pointer to the ulist
+ * @param data element to insert
+ * @param pos position, from 0 to the size. Negative counts from the back, -1 appending
+ * @return int 1 if inserted, 0 if the position is out of range or on allocation failure
+ */
+int cutil_ulist_insert(struct cutil_ulist_t* list, void* data, ptrdiff_t pos);
+
+/**
+ * @brief Remove the element at a position
+ *
+ * @param list pointer to the ulist
+ * @param pos position, negative counting from the back
+ * @return void* the removed element, or NULL if out of range
+ */
+void* cutil_ulist_remove(struct cutil_ulist_t* list, ptrdiff_t pos);
+
+void** cutil_ulist_back(struct cutil_ulist_t* list);
+int cutil_ulist_insert_back(struct cutil_ulist_t* list, void* data);
+void* cutil_ulist_remove_back(struct cutil_ulist_t* list);
+
+void** cutil_ulist_front(struct cutil_ulist_t* list);
+int cutil_ulist_insert_front(struct cutil_ulist_t* list, void* data);
+void* cutil_ulist_remove_front(struct cutil_ulist_t* list);
+
+/**
+ * @brief Points an iterator at the element at a position
+ *
+ * @param iterator iterator to initialize
+ * @param list pointer to the ulist
+ * @param pos position of the first element to visit, negative counting from the back
+ */
+void cutil_ulist_iterator_init(struct cutil_ulist_iterator_t* iterator, struct cutil_ulist_t* list, ptrdiff_t pos);
+void cutil_ulist_iterator_destroy(struct cutil_ulist_iterator_t* iterator);
+
+/**
+ * @brief Get the current element
+ *
+ * @return void** pointer to the element, or NULL past either end
+ */
+void** cutil_ulist_iterator_get(struct cutil_ulist_iterator_t* iterator);
+
+/**
+ * @brief Move to the next element
+ *
+ * @return void** pointer to the new current element, or NULL past the back
+ */
+void** cutil_ulist_iterator_next(struct cutil_ulist_iterator_t* iterator);
+
+/**
+ * @brief Move to the previous element
+ *
+ * @return void** pointer to the new current element, or NULL past the front
+ */
+void** cutil_ulist_iterator_back(struct cutil_ulist_iterator_t* iterator);
+
+void** cutil_ulist_iterator_peek(struct cutil_ulist_iterator_t* iterator);
+void** cutil_ulist_iterator_peek_back(struct cutil_ulist_iterator_t* iterator);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,224 @@
+#include "cutil.h"
+#include "cache.h"
+#include "hmap.h"
+#include "pool.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// entries per heap chunk of the entry pool
+#define CACHE_ENTRIES_PER_CHUNK 256
+
+typedef struct cache_entry
+{
+  struct cutil_hmap_tuple_t tuple;
+  size_t hash;                      /// Hash of the key in the index, so evictions don't rehash
+  size_t cost;
+  struct cache_entry* prev;
+  struct cache_entry* next;
+  atomic_uchar referenced;          /// CLOCK: set by hits, cleared by the hand
+} cache_entry;
+
+// Links the entry right behind the hand: the front of the LRU list, or the last entry the CLOCK hand reaches
+static void cache_link(struct cutil_cache_t* cache, cache_entry* e)
+{
+  cache_entry* hand = (cache_entry*) cache->hand;
+  if (!hand)
+  {
+    e->prev = e;
+    e->next = e;
+    cache->hand = e;
+    return;
+  }
+
+  e->next = hand;
+  e->prev = hand->prev;
+  hand->prev->next = e;
+  hand->prev = e;
+  if (cache->policy == CUTIL_CACHE_LRU)
+    cache->hand = e;
+}
+
+static void cache_unlink(struct cutil_cache_t* cache, cache_entry* e)
+{
+  if (e->next == e)
+  {
+    cache->hand = NULL;
+    return;
+  }
+
+  e->prev->next = e->next;
+  e->next->prev = e->prev;
+  if (cache->hand == e)
+    cache->hand = e->next;
+}
+
+// Removes the entry from the index and the list, and hands it to the evict callback
+static void cache_remove(struct cutil_cache_t* cache, cache_entry* e)
+{
+  cutil_hmap_del_hashed(&cache->index, e->tuple.key, e->hash);
+  cache_unlink(cache, e);
+  cache->cost -= e->cost;
+
+  if (cache->evictFn)
+    cache->evictFn(cache->evictCtx, &e->tuple);
+  cutil_pool_free(&cache->entryPool, e);
+}
+
+static cache_entry* cache_victim(struct cutil_cache_t* cache)
+{
+  cache_entry* hand = (cache_entry*) cache->hand;
+  if (cache->policy == CUTIL_CACHE_LRU)
+    return hand->prev;
+
+  // second chance: referenced entries are cleared and skipped. Terminates after at most one full turn
+  while (atomic_exchange_explicit(&hand->referenced, 0, memory_order_relaxed))
+    hand = hand->next;
+  cache->hand = hand;
+  return hand;
+}
+
+void cutil_cache_init(struct cutil_cache_t* cache, int policy, size_t capacity)
+{
+  if (!cache)
+    return;
+
+  cutil_hmap_init(&cache->index);
+  cutil_pool_init(&cache->entryPool, sizeof(cache_entry), CACHE_ENTRIES_PER_CHUNK);
+  cache->hand = NULL;
+  cache->capacity = capacity;
+  cache->cost = 0;
+  cache->policy = (policy == CUTIL_CACHE_CLOCK) ? CUTIL_CACHE_CLOCK : CUTIL_CACHE_LRU;
+  cache->evictFn = NULL;
+  cache->evictCtx = NULL;
+}
+
+void cutil_cache_destroy(struct cutil_cache_t* cache)
+{
+  if (!cache)
+    return;
+
+  cache_entry* e = (cache_entry*) cache->hand;
+  for (size_t i = 0, n = cutil_hmap_size(&cache->index); cache->evictFn && i < n; i++)
+  {
+    cache->evictFn(cache->evictCtx, &e->tuple);
+    e = e->next;
+  }
+
+  cutil_hmap_destroy(&cache->index);
+  cutil_pool_destroy(&cache->entryPool);
+  cache->hand = NULL;
+  cache->capacity = 0;
+  cache->cost = 0;
+  cache->evictFn = NULL;
+  cache->evictCtx = NULL;
+}
+
+void cutil_cache_set_evict(struct cutil_cache_t* cache, cutil_cache_evict_func_t evict_fn, void* ctx)
+{
+  if (!cache)
+    return;
+
+  cache->evictFn = evict_fn;
+  cache->evictCtx = ctx;
+}
+
+void cutil_cache_set_hashfn(struct cutil_cache_t* cache, cutil_hash_func_t hash_fn)
+{
+  if (cache)
+    cutil_hmap_set_hashfn(&cache->index, hash_fn);
+}
+
+size_t cutil_cache_size(struct cutil_cache_t* cache)
+{
+  return (cache) ? cutil_hmap_size(&cache->index) : 0;
+}
+
+size_t cutil_cache_cost(struct cutil_cache_t* cache)
+{
+  return (cache) ? cache->cost : 0;
+}
+
+int cutil_cache_probe_key(struct cutil_cache_t* cache, struct cutil_hmap_key_t key)
+{
+  return (cache) ? cutil_hmap_probe_key(&cache->index, key) : 0;
+}
+
+void** cutil_cache_get(struct cutil_cache_t* cache, struct cutil_hmap_key_t key)
+{
+  if (!cache)
+    return NULL;
+
+  void** slot = cutil_hmap_get(&cache->index, key);
+  if (!slot)
+    return NULL;
+
+  cache_entry* e = (cache_entry*) *slot;
+  if (cache->policy == CUTIL_CACHE_CLOCK)
+  {
+    // skip the store when the bit is already set, so hot entries don't bounce their cache line between readers
+    if (!atomic_load_explicit(&e->referenced, memory_order_relaxed))
+      atomic_store_explicit(&e->referenced, 1, memory_order_relaxed);
+  }
+  else if (cache->hand != e)
+  {
+    cache_unlink(cache, e);
+    cache_link(cache, e);
+  }
+
+  return &e->tuple.value;
+}
+
+int cutil_cache_put(struct cutil_cache_t* cache, struct cutil_hmap_tuple_t t, size_t cost)
+{
+  if (!cache || cost > cache->capacity)
+    return 0;
+
+  // hash once for the lookup, the insert and the eventual eviction
+  size_t hash = cutil_hmap_hash(&cache->index, t.key);
+
+  int inserted = 0;
+  void** slot = cutil_hmap_get_or_insert_hashed(&cache->index, cutil_hmap_make_tuple(t.key, NULL), hash, &inserted);
+  if (slot && !inserted)
+  {
+    // the index keeps the key of the old entry, so it goes as a whole
+    cache_remove(cache, (cache_entry*) *slot);
+    slot = cutil_hmap_get_or_insert_hashed(&cache->index, cutil_hmap_make_tuple(t.key, NULL), hash, &inserted);
+  }
+  if (!slot)
+    return 0;
+
+  cache_entry* e = cutil_pool_alloc(&cache->entryPool);
+  if (!e)
+  {
+    cutil_hmap_del_hashed(&cache->index, t.key, hash);
+    return 0;
+  }
+
+  *slot = e;
+  e->tuple = t;
+  e->hash = hash;
+  e->cost = cost;
+  atomic_init(&e->referenced, 1);
+
+  // make room before linking, so that the new entry can't be its own victim
+  cache->cost += cost;
+  while (cache->cost > cache->capacity)
+    cache_remove(cache, cache_victim(cache));
+  cache_link(cache, e);
+
+  return 1;
+}
+
+int cutil_cache_del(struct cutil_cache_t* cache, struct cutil_hmap_key_t key)
+{
+  if (!cache)
+    return 0;
+
+  void** slot = cutil_hmap_get(&cache->index, key);
+  if (!slot)
+    return 0;
+
+  cache_remove(cache, (cache_entry*) *slot);
+  return 1;
+}
@@ -0,0 +1,174 @@
+#include "cutil.h"
+#include "chmap.h"
+#include "hmap.h"
+#include "hash.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CHMAP_CACHE_LINE 64
+
+// aligned to a cache line so that neighbouring shard locks don't false share
+typedef struct chmap_shard
+{
+  _Alignas(CHMAP_CACHE_LINE) pthread_rwlock_t lock;
+  struct cutil_hmap_t map;
+} chmap_shard;
+
+// Picks the shard of a key, and hands back the hash so that the shard doesn't hash it again
+static inline chmap_shard* chmap_shard_of(struct cutil_chmap_t* map, struct cutil_hmap_key_t key, size_t* hash_out)
+{
+  size_t hash = *hash_out = cutil_hmap_key_hash(key, map->hashFn);
+  size_t idx = (map->shardShift >= sizeof(size_t) * 8) ? 0 : hash >> map->shardShift;
+  return (chmap_shard*) map->shards + idx;
+}
+
+void cutil_chmap_init(struct cutil_chmap_t* map, size_t shards)
+{
+  if (!map)
+    return;
+
+  size_t count = 1;
+  unsigned bits = 0;
+  while (count < shards)
+  {
+    count <<= 1;
+    bits++;
+  }
+
+  map->shards = NULL;
+  map->shardCount = 0;
+  map->shardShift = (unsigned) (sizeof(size_t) * 8 - bits);
+  map->hashFn = cutil_hash_default;
+
+  chmap_shard* s = aligned_alloc(CHMAP_CACHE_LINE, sizeof(*s) * count);
+  if (!s)
+    return;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    pthread_rwlock_init(&s[i].lock, NULL);
+    cutil_hmap_init(&s[i].map);
+  }
+
+  map->shards = (void*) s;
+  map->shardCount = count;
+}
+
+void cutil_chmap_destroy(struct cutil_chmap_t* map)
+{
+  if (!map)
+    return;
+
+  chmap_shard* s = (chmap_shard*) map->shards;
+  for (size_t i = 0; i < map->shardCount; i++)
+  {
+    cutil_hmap_destroy(&s[i].map);
+    pthread_rwlock_destroy(&s[i].lock);
+  }
+  free(s);
+
+  map->shards = NULL;
+  map->shardCount = 0;
+  map->shardShift = 0;
+  map->hashFn = NULL;
+}
+
+void cutil_chmap_set_destructor(struct cutil_chmap_t* map, cutil_destructor_func_t destructor)
+{
+  if (!map)
+    return;
+
+  chmap_shard* s = (chmap_shard*) map->shards;
+  for (size_t i = 0; i < map->shardCount; i++)
+    cutil_hmap_set_destructor(&s[i].map, destructor);
+}
+
+void cutil_chmap_set_hashfn(struct cutil_chmap_t* map, cutil_hash_func_t hash_fn)
+{
+  if (!map || !hash_fn || cutil_chmap_size(map) != 0)
+    return;
+
+  map->hashFn = hash_fn;
+  chmap_shard* s = (chmap_shard*) map->shards;
+  for (size_t i = 0; i < map->shardCount; i++)
+    cutil_hmap_set_hashfn(&s[i].map, hash_fn);
+}
+
+size_t cutil_chmap_size(struct cutil_chmap_t* map)
+{
+  if (!map)
+    return 0;
+
+  size_t size = 0;
+  chmap_shard* s = (chmap_shard*) map->shards;
+  for (size_t i = 0; i < map->shardCount; i++)
+  {
+    pthread_rwlock_rdlock(&s[i].lock);
+    size += cutil_hmap_size(&s[i].map);
+    pthread_rwlock_unlock(&s[i].lock);
+  }
+
+  return size;
+}
+
+int cutil_chmap_probe_key(struct cutil_chmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->shardCount)
+    return 0;
+
+  size_t hash;
+  chmap_shard* s = chmap_shard_of(map, key, &hash);
+  pthread_rwlock_rdlock(&s->lock);
+  int found = cutil_hmap_probe_key_hashed(&s->map, key, hash);
+  pthread_rwlock_unlock(&s->lock);
+
+  return found;
+}
+
+int cutil_chmap_insert(struct cutil_chmap_t* map, struct cutil_hmap_tuple_t insert)
+{
+  if (!map || !map->shardCount)
+    return 0;
+
+  size_t hash;
+  chmap_shard* s = chmap_shard_of(map, insert.key, &hash);
+  pthread_rwlock_wrlock(&s->lock);
+  int inserted = cutil_hmap_insert_hashed(&s->map, insert, hash);
+  pthread_rwlock_unlock(&s->lock);
+
+  return inserted;
+}
+
+int cutil_chmap_get(struct cutil_chmap_t* map, struct cutil_hmap_key_t key, void** value)
+{
+  if (!map || !map->shardCount)
+    return 0;
+
+  // shards never resize incrementally, so a lookup doesn't modify the shard's table and a read lock is enough. The
+  // only writes are the stats counters of a CUTIL_HMAP_STATS build, which cutil_hmap_get_hashed() bumps atomically
+  size_t hash;
+  chmap_shard* s = chmap_shard_of(map, key, &hash);
+  pthread_rwlock_rdlock(&s->lock);
+  void** v = cutil_hmap_get_hashed(&s->map, key, hash);
+  if (v && value)
+    *value = *v;
+  pthread_rwlock_unlock(&s->lock);
+
+  return (v) ? 1 : 0;
+}
+
+int cutil_chmap_del(struct cutil_chmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->shardCount)
+    return 0;
+
+  size_t hash;
+  chmap_shard* s = chmap_shard_of(map, key, &hash);
+  pthread_rwlock_wrlock(&s->lock);
+  int deleted = cutil_hmap_del_hashed(&s->map, key, hash);
+  pthread_rwlock_unlock(&s->lock);
+
+  return deleted;
+}
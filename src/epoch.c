@@ -0,0 +1,226 @@
+#include "epoch.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// number of retire lists. Memory retired in epoch e is released once the global epoch reaches e + 2
+#define EPOCH_LISTS 3
+
+typedef struct epoch_record
+{
+  atomic_size_t state;          // (epoch << 1) | 1 while in a critical section, 0 otherwise
+  size_t nesting;               // only touched by the owning thread
+  pthread_t owner;
+  struct epoch_record* next;
+} epoch_record;
+
+typedef struct epoch_retired
+{
+  void* ptr;
+  cutil_epoch_free_func_t fn;
+  void* ctx;
+  struct epoch_retired* next;
+} epoch_retired;
+
+typedef struct epoch_state
+{
+  atomic_size_t global;
+  _Atomic(epoch_record*) records;
+  size_t id;
+  pthread_mutex_t lock;         // serializes retiring and advancing
+  epoch_retired* retired[EPOCH_LISTS];
+} epoch_state;
+
+// domains get a unique id so that a stale thread local cache can't match a new domain at a reused address
+static atomic_size_t epoch_domains = 1;
+
+static _Thread_local struct
+{
+  size_t id;
+  epoch_record* record;
+} epoch_tls = { 0, NULL };
+
+static epoch_record* epoch_record_of(epoch_state* s)
+{
+  if (epoch_tls.id == s->id)
+    return epoch_tls.record;
+
+  // a record whose owner exited may be adopted by a thread that got the same id, which is harmless
+  pthread_t self = pthread_self();
+  epoch_record* r = atomic_load_explicit(&s->records, memory_order_acquire);
+  for (; r; r = r->next)
+  {
+    if (pthread_equal(r->owner, self))
+      break;
+  }
+
+  if (!r)
+  {
+    r = malloc(sizeof *r);
+    if (!r)
+      return NULL;
+
+    atomic_init(&r->state, 0);
+    r->nesting = 0;
+    r->owner = self;
+    r->next = atomic_load_explicit(&s->records, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&s->records, &r->next, r, memory_order_release, memory_order_relaxed))
+      ;
+  }
+
+  epoch_tls.id = s->id;
+  epoch_tls.record = r;
+  return r;
+}
+
+static void epoch_release_list(epoch_retired* l)
+{
+  while (l)
+  {
+    epoch_retired* next = l->next;
+    l->fn(l->ctx, l->ptr);
+    free(l);
+    l = next;
+  }
+}
+
+// Advances the global epoch if every active reader has seen it. Must hold the lock
+static int epoch_try_advance(epoch_state* s)
+{
+  // order the unlinking stores of the writer before reading the reader records
+  atomic_thread_fence(memory_order_seq_cst);
+
+  size_t e = atomic_load_explicit(&s->global, memory_order_relaxed);
+  for (epoch_record* r = atomic_load_explicit(&s->records, memory_order_acquire); r; r = r->next)
+  {
+    size_t st = atomic_load_explicit(&r->state, memory_order_acquire);
+    if ((st & 1) && (st >> 1) != e)
+      return 0;
+  }
+
+  atomic_store_explicit(&s->global, e + 1, memory_order_release);
+
+  // what was retired in e - 1 is now two epochs behind every reader
+  epoch_retired* l = s->retired[(e + 2) % EPOCH_LISTS];
+  s->retired[(e + 2) % EPOCH_LISTS] = NULL;
+  epoch_release_list(l);
+
+  return 1;
+}
+
+int cutil_epoch_init(struct cutil_epoch_t* epoch)
+{
+  if (!epoch)
+    return 0;
+
+  epoch_state* s = malloc(sizeof *s);
+  epoch->state = s;
+  if (!s)
+    return 0;
+
+  atomic_init(&s->global, 0);
+  atomic_init(&s->records, NULL);
+  s->id = atomic_fetch_add(&epoch_domains, 1);
+  pthread_mutex_init(&s->lock, NULL);
+  for (size_t i = 0; i < EPOCH_LISTS; i++)
+    s->retired[i] = NULL;
+
+  return 1;
+}
+
+void cutil_epoch_destroy(struct cutil_epoch_t* epoch)
+{
+  if (!epoch || !epoch->state)
+    return;
+
+  epoch_state* s = (epoch_state*) epoch->state;
+
+  // release in retirement order, oldest list first
+  size_t e = atomic_load(&s->global);
+  for (size_t i = 1; i <= EPOCH_LISTS; i++)
+    epoch_release_list(s->retired[(e + i) % EPOCH_LISTS]);
+
+  epoch_record* r = atomic_load(&s->records);
+  while (r)
+  {
+    epoch_record* next = r->next;
+    free(r);
+    r = next;
+  }
+
+  pthread_mutex_destroy(&s->lock);
+  free(s);
+  epoch->state = NULL;
+}
+
+void cutil_epoch_enter(struct cutil_epoch_t* epoch)
+{
+  epoch_state* s = (epoch_state*) epoch->state;
+  epoch_record* r = epoch_record_of(s);
+  if (!r || r->nesting++)
+    return;
+
+  // announcing a stale epoch only holds back reclamation, so no retry is needed
+  size_t e = atomic_load_explicit(&s->global, memory_order_acquire);
+  atomic_store_explicit(&r->state, (e << 1) | 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+void cutil_epoch_exit(struct cutil_epoch_t* epoch)
+{
+  epoch_state* s = (epoch_state*) epoch->state;
+  epoch_record* r = epoch_record_of(s);
+  if (!r || !r->nesting || --r->nesting)
+    return;
+
+  atomic_store_explicit(&r->state, 0, memory_order_release);
+}
+
+int cutil_epoch_retire(struct cutil_epoch_t* epoch, void* ptr, cutil_epoch_free_func_t fn, void* ctx)
+{
+  if (!epoch || !epoch->state || !fn)
+    return 0;
+
+  epoch_state* s = (epoch_state*) epoch->state;
+  epoch_retired* l = malloc(sizeof *l);
+
+  pthread_mutex_lock(&s->lock);
+  size_t e = atomic_load_explicit(&s->global, memory_order_relaxed);
+  if (l)
+  {
+    l->ptr = ptr;
+    l->fn = fn;
+    l->ctx = ctx;
+    l->next = s->retired[e % EPOCH_LISTS];
+    s->retired[e % EPOCH_LISTS] = l;
+    epoch_try_advance(s);
+  }
+  else
+  {
+    // no memory to defer with. Wait out two epochs instead
+    while (atomic_load_explicit(&s->global, memory_order_relaxed) < e + 2)
+    {
+      if (!epoch_try_advance(s))
+        sched_yield();
+    }
+  }
+  pthread_mutex_unlock(&s->lock);
+
+  if (!l)
+    fn(ctx, ptr);
+
+  return (l) ? 1 : 0;
+}
+
+void cutil_epoch_reclaim(struct cutil_epoch_t* epoch)
+{
+  if (!epoch || !epoch->state)
+    return;
+
+  epoch_state* s = (epoch_state*) epoch->state;
+  pthread_mutex_lock(&s->lock);
+  epoch_try_advance(s);
+  pthread_mutex_unlock(&s->lock);
+}
@@ -0,0 +1,269 @@
+#include "cutil.h"
+#include "flatmap.h"
+#include "hash.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define GROUP CUTIL_FLATMAP_GROUP_WIDTH
+
+typedef struct flatmap_slot
+{
+  void* key;
+  size_t len;
+  void* value;
+} flatmap_slot;
+
+// the user hash functions are often weak in the low bits, which pick both the group and the fragment
+static inline size_t flatmap_hash(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key)
+{
+  return cutil_hmap_key_hash(key, map->hashFn);
+}
+
+static int flatmap_alloc(struct cutil_flatmap_t* map, size_t capacity)
+{
+  unsigned char* ctrl = malloc(capacity);
+  flatmap_slot* slots = malloc(sizeof(*slots) * capacity);
+  if (!ctrl || !slots)
+  {
+    free(ctrl);
+    free(slots);
+    return 0;
+  }
+
+  cutil_flatmap_ctrl_clear(ctrl, capacity);
+
+  map->ctrl = ctrl;
+  map->slots = slots;
+  map->capacity = capacity;
+  map->tombstones = 0;
+  return 1;
+}
+
+static inline int flatmap_key_equal(struct cutil_flatmap_t* map, void* a, void* b, size_t alen, size_t blen)
+{
+  if (map->equalFn)
+    return map->equalFn(a, b, alen, blen);
+  return map->compareFn(a, b, alen, blen) == CUTIL_EQ;
+}
+
+// Key looked up by flatmap_find()
+typedef struct flatmap_query
+{
+  struct cutil_flatmap_t* map;
+  void* key;
+  size_t len;
+} flatmap_query;
+
+static inline int flatmap_match(const void* ctx, size_t idx)
+{
+  const flatmap_query* q = (const flatmap_query*) ctx;
+  flatmap_slot* slot = (flatmap_slot*) q->map->slots + idx;
+  return flatmap_key_equal(q->map, q->key, slot->key, q->len, slot->len);
+}
+
+// Any slot carrying the hash fragment, for cutil_flatmap_probe_hashfn()
+static inline int flatmap_match_any(const void* ctx, size_t idx)
+{
+  (void) ctx;
+  (void) idx;
+  return 1;
+}
+
+// Returns the slot index of the key, or capacity if it is not in the map
+static size_t flatmap_find(struct cutil_flatmap_t* map, void* key, size_t len, size_t hash)
+{
+  flatmap_query q = { map, key, len };
+  return cutil_flatmap_find(map->ctrl, map->capacity, hash, flatmap_match, &q);
+}
+
+static int flatmap_resize(struct cutil_flatmap_t* map, size_t capacity)
+{
+  unsigned char* old_ctrl = map->ctrl;
+  flatmap_slot* old_slots = (flatmap_slot*) map->slots;
+  size_t old_capacity = map->capacity;
+
+  if (!flatmap_alloc(map, capacity))
+    return 0;
+
+  flatmap_slot* slots = (flatmap_slot*) map->slots;
+  for (size_t i = 0; i < old_capacity; i++)
+  {
+    if (!cutil_flatmap_ctrl_full(old_ctrl[i]))
+      continue;
+
+    size_t hash = flatmap_hash(map, cutil_hmap_make_key(old_slots[i].key, old_slots[i].len));
+    slots[cutil_flatmap_claim(map->ctrl, map->capacity, hash, NULL)] = old_slots[i];
+  }
+
+  free(old_ctrl);
+  free(old_slots);
+  return 1;
+}
+
+void cutil_flatmap_init(struct cutil_flatmap_t* map)
+{
+  if (!map)
+    return;
+
+  map->slots = NULL;
+  map->ctrl = NULL;
+  map->capacity = 0;
+  map->size = 0;
+  map->tombstones = 0;
+  map->loadFactorMax = 0.875f;
+  map->hashFn = cutil_hash_default;
+  map->compareFn = cutil_compare_lex;
+  map->equalFn = cutil_equal_bytes;
+  map->destuctor = NULL;
+
+  flatmap_alloc(map, GROUP);
+}
+
+void cutil_flatmap_destroy(struct cutil_flatmap_t* map)
+{
+  if (!map)
+    return;
+
+  flatmap_slot* slots = (flatmap_slot*) map->slots;
+  if (map->destuctor)
+  {
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+      if (!cutil_flatmap_ctrl_full(map->ctrl[i]))
+        continue;
+
+      struct cutil_hmap_tuple_t t = cutil_hmap_make_tuple(cutil_hmap_make_key(slots[i].key, slots[i].len), slots[i].value);
+      map->destuctor(&t);
+    }
+  }
+
+  free(map->ctrl);
+  free(map->slots);
+
+  map->slots = NULL;
+  map->ctrl = NULL;
+  map->capacity = 0;
+  map->size = 0;
+  map->tombstones = 0;
+  map->loadFactorMax = 0.f;
+  map->hashFn = NULL;
+  map->compareFn = NULL;
+  map->equalFn = NULL;
+  map->destuctor = NULL;
+}
+
+void cutil_flatmap_set_destructor(struct cutil_flatmap_t* map, cutil_destructor_func_t destructor)
+{
+  if (map)
+    map->destuctor = destructor;
+}
+
+void cutil_flatmap_set_hashfn(struct cutil_flatmap_t* map, cutil_hash_func_t hash_fn)
+{
+  if (map && hash_fn && map->size == 0)
+    map->hashFn = hash_fn;
+}
+
+void cutil_flatmap_set_equalfn(struct cutil_flatmap_t* map, cutil_equal_func_t equal_fn)
+{
+  if (map && equal_fn && map->size == 0)
+    map->equalFn = equal_fn;
+}
+
+void cutil_flatmap_set_comparefn(struct cutil_flatmap_t* map, cutil_compare_func_t compare_fn)
+{
+  if (map && compare_fn && map->size == 0)
+  {
+    map->compareFn = compare_fn;
+    map->equalFn = NULL;
+  }
+}
+
+size_t cutil_flatmap_size(struct cutil_flatmap_t* map)
+{
+  return (map) ? map->size : 0;
+}
+
+int cutil_flatmap_probe_key(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->ctrl)
+    return 0;
+
+  size_t hash = flatmap_hash(map, key);
+  return (flatmap_find(map, key.key, key.len, hash) != map->capacity) ? 1 : 0;
+}
+
+int cutil_flatmap_probe_hashfn(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->ctrl)
+    return 0;
+
+  size_t hash = flatmap_hash(map, key);
+  return (cutil_flatmap_find(map->ctrl, map->capacity, hash, flatmap_match_any, NULL) != map->capacity) ? 1 : 0;
+}
+
+int cutil_flatmap_insert(struct cutil_flatmap_t* map, struct cutil_hmap_tuple_t t)
+{
+  if (!map || !map->ctrl)
+    return 0;
+
+  size_t hash = flatmap_hash(map, t.key);
+
+  // Element already exists. Don't insert
+  if (flatmap_find(map, t.key.key, t.key.len, hash) != map->capacity)
+    return 0;
+
+  // grow, or just purge the tombstones if the live entries would fit in half the table
+  size_t capacity = cutil_flatmap_grow_for_insert(map->capacity, map->size, map->tombstones, map->loadFactorMax);
+  if (capacity && !flatmap_resize(map, capacity))
+    return 0;
+
+  size_t idx = cutil_flatmap_claim(map->ctrl, map->capacity, hash, &map->tombstones);
+  if (idx == map->capacity)
+    return 0;
+
+  flatmap_slot* slot = (flatmap_slot*) map->slots + idx;
+  slot->key = t.key.key;
+  slot->len = t.key.len;
+  slot->value = t.value;
+  map->size++;
+
+  return 1;
+}
+
+void** cutil_flatmap_get(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->ctrl)
+    return NULL;
+
+  size_t hash = flatmap_hash(map, key);
+  size_t idx = flatmap_find(map, key.key, key.len, hash);
+  if (idx == map->capacity)
+    return NULL;
+
+  return &((flatmap_slot*) map->slots)[idx].value;
+}
+
+int cutil_flatmap_del(struct cutil_flatmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->ctrl)
+    return 0;
+
+  size_t hash = flatmap_hash(map, key);
+  size_t idx = flatmap_find(map, key.key, key.len, hash);
+  if (idx == map->capacity)
+    return 0;
+
+  flatmap_slot* slot = (flatmap_slot*) map->slots + idx;
+  if (map->destuctor)
+  {
+    struct cutil_hmap_tuple_t rm = cutil_hmap_make_tuple(cutil_hmap_make_key(slot->key, slot->len), slot->value);
+    map->destuctor(&rm);
+  }
+
+  cutil_flatmap_erase(map->ctrl, idx, &map->tombstones);
+  map->size--;
+
+  return 1;
+}
@@ -1,36 +1,470 @@
 #include "hash.h"
 #include "cutil.h"
 
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HASH_HAVE_AVX2 1
+#endif
+
+// word of the key at the given position. memcpy keeps unaligned keys well defined, and compiles to a single load
+static inline size_t hash_read_word(const unsigned char* p)
+{
+  size_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// the bytes past the last whole word, little endian. Unsigned, so that bytes above 0x7F don't sign extend
+static inline size_t hash_read_tail(const unsigned char* p, size_t rem)
+{
+  size_t last = 0;
+  for (size_t i = 0; i < rem; i++)
+    last |= (size_t) p[i] << (i * 8);
+  return last;
+}
+
 size_t cutil_hash_arb_add_chained(void* data, size_t length)
 {
   size_t hash = 0;
-  size_t* view = data;
+  const unsigned char* view = (const unsigned char*) data;
   for (size_t i = 0; i < length / sizeof(size_t); i++)
-    hash += view[i];
+    hash += hash_read_word(view + i * sizeof(size_t));
 
   size_t rem = length % sizeof(size_t);
-  char* rem_view = (char*) data;
-  size_t last = 0;
-  for (size_t i = 0; i < rem; i++)
-    last |= rem_view[i] << (i * 8);
-  
-  return hash + last;
+  return hash + hash_read_tail(view + length - rem, rem);
 }
 
 size_t cutil_hash_arb_xor_chained(void* data, size_t length)
 {
   size_t hash = 0;
-  size_t* view = data;
+  const unsigned char* view = (const unsigned char*) data;
   for (size_t i = 0; i < length / sizeof(size_t); i++)
-    hash ^= view[i];
-  
+    hash ^= hash_read_word(view + i * sizeof(size_t));
+
   size_t rem = length % sizeof(size_t);
-  char* rem_view = (char*) data;
-  size_t last = 0;
-  for (size_t i = 0; i < rem; i++)
-    last |= rem_view[i] << (i * 8);
-  
-  return hash ^ last;
+  return hash ^ hash_read_tail(view + length - rem, rem);
+}
+
+static const uint64_t hash_wy_secret[4] = {
+  0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+// 64 x 64 -> 128 bit multiply, low half to a and high half to b
+static inline void hash_mum(uint64_t* a, uint64_t* b)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t) *a * *b;
+  *a = (uint64_t) r;
+  *b = (uint64_t) (r >> 64);
+#else
+  uint64_t ha = *a >> 32, la = (uint32_t) *a, hb = *b >> 32, lb = (uint32_t) *b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t hash_mix2(uint64_t a, uint64_t b)
+{
+  hash_mum(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t hash_r8(const unsigned char* p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t hash_r4(const unsigned char* p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// wyhash (final version 4) of the key, little endian targets
+static uint64_t hash_wy(const unsigned char* p, size_t len, uint64_t seed)
+{
+  const uint64_t* s = hash_wy_secret;
+  seed ^= hash_mix2(seed ^ s[0], s[1]);
+
+  uint64_t a, b;
+  if (len <= 16)
+  {
+    if (len >= 4)
+    {
+      a = (hash_r4(p) << 32) | hash_r4(p + ((len >> 3) << 2));
+      b = (hash_r4(p + len - 4) << 32) | hash_r4(p + len - 4 - ((len >> 3) << 2));
+    }
+    else if (len > 0)
+    {
+      a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+      b = 0;
+    }
+    else
+    {
+      a = b = 0;
+    }
+  }
+  else
+  {
+    size_t i = len;
+    if (i >= 48)
+    {
+      uint64_t see1 = seed, see2 = seed;
+      do
+      {
+        seed = hash_mix2(hash_r8(p) ^ s[1], hash_r8(p + 8) ^ seed);
+        see1 = hash_mix2(hash_r8(p + 16) ^ s[2], hash_r8(p + 24) ^ see1);
+        see2 = hash_mix2(hash_r8(p + 32) ^ s[3], hash_r8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16)
+    {
+      seed = hash_mix2(hash_r8(p) ^ s[1], hash_r8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = hash_r8(p + i - 16);
+    b = hash_r8(p + i - 8);
+  }
+
+  a ^= s[1];
+  b ^= seed;
+  hash_mum(&a, &b);
+  return hash_mix2(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+size_t cutil_hash_wy(void* data, size_t length)
+{
+  return (size_t) hash_wy((const unsigned char*) data, length, 0);
+}
+
+// The striped hash runs 8 independent 64 bit accumulators over 64 byte stripes. Every lane multiplies the low and
+// high halves of its word xored with a secret, and also adds the raw word to its neighbour lane, which keeps the
+// input recoverable from the sum and avoids the zero products of a plain multiply. Every block of stripes, the
+// accumulators are scrambled so that their high bits flow back down. All implementations compute the same value.
+#define HASH_STRIPE_LANES 8
+#define HASH_STRIPE_BYTES 64
+#define HASH_STRIPES_PER_BLOCK 16
+#define HASH_STRIPE_PRIME 0x9E3779B1u
+
+static const uint64_t hash_stripe_secret[HASH_STRIPE_LANES] = {
+  0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+  0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull
+};
+
+#if !defined(__SSE2__)
+static void hash_stripe_run_scalar(uint64_t* acc, const unsigned char* p, size_t stripes)
+{
+  for (size_t s = 0; s < stripes; s++, p += HASH_STRIPE_BYTES)
+  {
+    for (size_t i = 0; i < HASH_STRIPE_LANES; i++)
+    {
+      uint64_t d = hash_r8(p + i * 8);
+      uint64_t dk = d ^ hash_stripe_secret[i];
+      acc[i ^ 1] += d;
+      acc[i] += (dk & 0xFFFFFFFFu) * (dk >> 32);
+    }
+
+    if ((s + 1) % HASH_STRIPES_PER_BLOCK == 0)
+    {
+      for (size_t i = 0; i < HASH_STRIPE_LANES; i++)
+        acc[i] = (acc[i] ^ (acc[i] >> 47) ^ hash_stripe_secret[i]) * HASH_STRIPE_PRIME;
+    }
+  }
+}
+#endif
+
+#if defined(__SSE2__)
+static void hash_stripe_run_sse2(uint64_t* acc, const unsigned char* p, size_t stripes)
+{
+  __m128i a[4], k[4];
+  for (size_t i = 0; i < 4; i++)
+  {
+    a[i] = _mm_loadu_si128((const __m128i*) (acc + 2 * i));
+    k[i] = _mm_loadu_si128((const __m128i*) (hash_stripe_secret + 2 * i));
+  }
+  const __m128i prime = _mm_set1_epi32((int) HASH_STRIPE_PRIME);
+
+  for (size_t s = 0; s < stripes; s++, p += HASH_STRIPE_BYTES)
+  {
+    for (size_t i = 0; i < 4; i++)
+    {
+      __m128i d = _mm_loadu_si128((const __m128i*) (p + 16 * i));
+      __m128i dk = _mm_xor_si128(d, k[i]);
+      __m128i prod = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+      a[i] = _mm_add_epi64(a[i], _mm_add_epi64(prod, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+
+    if ((s + 1) % HASH_STRIPES_PER_BLOCK == 0)
+    {
+      for (size_t i = 0; i < 4; i++)
+      {
+        __m128i x = _mm_xor_si128(_mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47)), k[i]);
+        __m128i lo = _mm_mul_epu32(x, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+        a[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < 4; i++)
+    _mm_storeu_si128((__m128i*) (acc + 2 * i), a[i]);
+}
+#endif
+
+#if defined(HASH_HAVE_AVX2)
+__attribute__((target("avx2")))
+static void hash_stripe_run_avx2(uint64_t* acc, const unsigned char* p, size_t stripes)
+{
+  __m256i a[2], k[2];
+  for (size_t i = 0; i < 2; i++)
+  {
+    a[i] = _mm256_loadu_si256((const __m256i*) (acc + 4 * i));
+    k[i] = _mm256_loadu_si256((const __m256i*) (hash_stripe_secret + 4 * i));
+  }
+  const __m256i prime = _mm256_set1_epi32((int) HASH_STRIPE_PRIME);
+
+  for (size_t s = 0; s < stripes; s++, p += HASH_STRIPE_BYTES)
+  {
+    for (size_t i = 0; i < 2; i++)
+    {
+      __m256i d = _mm256_loadu_si256((const __m256i*) (p + 32 * i));
+      __m256i dk = _mm256_xor_si256(d, k[i]);
+      __m256i prod = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+      a[i] = _mm256_add_epi64(a[i], _mm256_add_epi64(prod, _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+
+    if ((s + 1) % HASH_STRIPES_PER_BLOCK == 0)
+    {
+      for (size_t i = 0; i < 2; i++)
+      {
+        __m256i x = _mm256_xor_si256(_mm256_xor_si256(a[i], _mm256_srli_epi64(a[i], 47)), k[i]);
+        __m256i lo = _mm256_mul_epu32(x, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+        a[i] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < 2; i++)
+    _mm256_storeu_si256((__m256i*) (acc + 4 * i), a[i]);
+}
+#endif
+
+typedef void (*hash_stripe_run_t)(uint64_t* acc, const unsigned char* p, size_t stripes);
+
+#if defined(__SSE2__)
+#define HASH_STRIPE_RUN_BASE hash_stripe_run_sse2
+#else
+#define HASH_STRIPE_RUN_BASE hash_stripe_run_scalar
+#endif
+
+// Widest implementation the CPU supports, picked once at load time rather than on every hash
+static hash_stripe_run_t hash_stripe_run = HASH_STRIPE_RUN_BASE;
+
+#if defined(HASH_HAVE_AVX2)
+static int hash_have_avx2(void)
+{
+  // constructors may run before the one of libgcc which fills in the CPU features
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((constructor))
+static void hash_stripe_select(void)
+{
+  if (hash_have_avx2())
+    hash_stripe_run = hash_stripe_run_avx2;
+}
+#endif
+
+static uint64_t hash_stripe(const unsigned char* p, size_t len, hash_stripe_run_t run)
+{
+  uint64_t acc[HASH_STRIPE_LANES];
+  for (size_t i = 0; i < HASH_STRIPE_LANES; i++)
+    acc[i] = hash_stripe_secret[(i + 3) % HASH_STRIPE_LANES];
+
+  size_t stripes = len / HASH_STRIPE_BYTES;
+  run(acc, p, stripes);
+
+  // fold the lanes pairwise, then let the bytes past the last stripe finish the hash
+  uint64_t h = (uint64_t) len * 0x9E3779B97F4A7C15ull;
+  for (size_t i = 0; i < HASH_STRIPE_LANES; i += 2)
+    h += hash_mix2(acc[i] ^ hash_wy_secret[i / 2], acc[i + 1] ^ hash_stripe_secret[i]);
+
+  size_t done = stripes * HASH_STRIPE_BYTES;
+  return hash_wy(p + done, len - done, h);
+}
+
+size_t cutil_hash_stripe(void* data, size_t length)
+{
+  return (size_t) hash_stripe((const unsigned char*) data, length, hash_stripe_run);
+}
+
+int cutil_hash_stripe_isa(void* data, size_t length, int isa, size_t* out)
+{
+  hash_stripe_run_t run = NULL;
+  switch (isa)
+  {
+#if !defined(__SSE2__)
+  case CUTIL_HASH_ISA_SCALAR:
+    run = hash_stripe_run_scalar;
+    break;
+#else
+  case CUTIL_HASH_ISA_SSE2:
+    run = hash_stripe_run_sse2;
+    break;
+#endif
+#if defined(HASH_HAVE_AVX2)
+  case CUTIL_HASH_ISA_AVX2:
+    run = (hash_have_avx2()) ? hash_stripe_run_avx2 : NULL;
+    break;
+#endif
+  default:
+    break;
+  }
+
+  if (!run || !out)
+    return 0;
+
+  *out = (size_t) hash_stripe((const unsigned char*) data, length, run);
+  return 1;
+}
+
+size_t cutil_hash_default(void* data, size_t length)
+{
+  if (length < CUTIL_HASH_LONG_KEY)
+    return (size_t) hash_wy((const unsigned char*) data, length, 0);
+  return (size_t) hash_stripe((const unsigned char*) data, length, hash_stripe_run);
+}
+
+#define HASH_ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define HASH_SIPROUND(v0, v1, v2, v3)                                                                            \
+  do                                                                                                             \
+  {                                                                                                              \
+    v0 += v1; v1 = HASH_ROTL(v1, 13); v1 ^= v0; v0 = HASH_ROTL(v0, 32);                                          \
+    v2 += v3; v3 = HASH_ROTL(v3, 16); v3 ^= v2;                                                                  \
+    v0 += v3; v3 = HASH_ROTL(v3, 21); v3 ^= v0;                                                                  \
+    v2 += v1; v1 = HASH_ROTL(v1, 17); v1 ^= v2; v2 = HASH_ROTL(v2, 32);                                          \
+  } while (0)
+
+// SipHash with c compression rounds per word and d finalization rounds, 64 bit output
+static inline uint64_t hash_sip(const unsigned char* p, size_t len, const struct cutil_hash_seed_t* seed, int c, int d)
+{
+  uint64_t v0 = seed->k0 ^ 0x736f6d6570736575ull;
+  uint64_t v1 = seed->k1 ^ 0x646f72616e646f6dull;
+  uint64_t v2 = seed->k0 ^ 0x6c7967656e657261ull;
+  uint64_t v3 = seed->k1 ^ 0x7465646279746573ull;
+
+  const unsigned char* end = p + (len & ~(size_t) 7);
+  for (; p != end; p += 8)
+  {
+    uint64_t m = hash_r8(p);
+    v3 ^= m;
+    for (int i = 0; i < c; i++)
+      HASH_SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+  }
+
+  uint64_t m = ((uint64_t) len << 56) | (uint64_t) hash_read_tail(p, len & 7);
+  v3 ^= m;
+  for (int i = 0; i < c; i++)
+    HASH_SIPROUND(v0, v1, v2, v3);
+  v0 ^= m;
+
+  v2 ^= 0xff;
+  for (int i = 0; i < d; i++)
+    HASH_SIPROUND(v0, v1, v2, v3);
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+size_t cutil_hash_siphash(void* data, size_t length, const struct cutil_hash_seed_t* seed)
+{
+  return (size_t) hash_sip((const unsigned char*) data, length, seed, 2, 4);
+}
+
+size_t cutil_hash_siphash13(void* data, size_t length, const struct cutil_hash_seed_t* seed)
+{
+  return (size_t) hash_sip((const unsigned char*) data, length, seed, 1, 3);
+}
+
+int cutil_hash_seed_random(struct cutil_hash_seed_t* seed)
+{
+  if (!seed)
+    return 0;
+
+  uint64_t k[2];
+  if (getentropy(k, sizeof(k)) != 0)
+    return 0;
+
+  seed->k0 = k[0];
+  seed->k1 = k[1];
+  return 1;
+}
+
+int cutil_equal_bytes(void* data, void* data2, size_t len1, size_t len2)
+{
+  if (len1 != len2)
+    return 0;
+  if (data == data2)
+    return 1;
+
+  const unsigned char* a = (const unsigned char*) data;
+  const unsigned char* b = (const unsigned char*) data2;
+  size_t len = len1;
+
+  // short keys: two overlapping loads cover the key, without a loop
+  if (len <= 16)
+  {
+    if (len >= 8)
+      return ((hash_r8(a) ^ hash_r8(b)) | (hash_r8(a + len - 8) ^ hash_r8(b + len - 8))) == 0;
+    if (len >= 4)
+      return ((hash_r4(a) ^ hash_r4(b)) | (hash_r4(a + len - 4) ^ hash_r4(b + len - 4))) == 0;
+    unsigned diff = 0;
+    for (size_t i = 0; i < len; i++)
+      diff |= (unsigned) (a[i] ^ b[i]);
+    return diff == 0;
+  }
+
+  // longer keys: 16 byte blocks, and a last block overlapping the one before
+#if defined(__SSE2__)
+  for (size_t i = 0; i + 16 < len; i += 16)
+  {
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + i)), _mm_loadu_si128((const __m128i*) (b + i)));
+    if (_mm_movemask_epi8(eq) != 0xFFFF)
+      return 0;
+  }
+  __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + len - 16)),
+    _mm_loadu_si128((const __m128i*) (b + len - 16)));
+  return _mm_movemask_epi8(eq) == 0xFFFF;
+#else
+  for (size_t i = 0; i + 16 < len; i += 16)
+  {
+    if ((hash_r8(a + i) ^ hash_r8(b + i)) | (hash_r8(a + i + 8) ^ hash_r8(b + i + 8)))
+      return 0;
+  }
+  return ((hash_r8(a + len - 16) ^ hash_r8(b + len - 16)) | (hash_r8(a + len - 8) ^ hash_r8(b + len - 8))) == 0;
+#endif
 }
 
 int cutil_compare_lex(void* data, void* data2, size_t len1, size_t len2)
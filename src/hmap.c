@@ -2,14 +2,20 @@
 #include "hmap.h"
 #include "hash.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef CUTIL_HMAP_STATS
+#include <time.h>
+#endif
 
 typedef struct hmap_node
 {
-  struct cutil_hmap_key_t key;
-  void* data;
+  struct cutil_hmap_tuple_t tuple;
+  size_t hash;                /// Hash of the key, so resizes and chain walks never rehash
   struct hmap_node* next;
+  unsigned char keyData[];    /// Copy of the key when the map owns its keys
 } hmap_node;
 
 typedef struct hmap_bucket
@@ -17,28 +23,247 @@ typedef struct hmap_bucket
   struct hmap_node* start;
 } hmap_bucket;
 
-static int cutil_hmap_rebucket(struct cutil_hmap_t* map)
+// entries per heap chunk of the node pool
+#define HMAP_NODES_PER_CHUNK 256
+
+// keys hashed and prefetched together by the batch operations
+#define HMAP_BATCH 16
+
+#if defined(__GNUC__)
+#define HMAP_PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#define HMAP_PREFETCH(addr) ((void) (addr))
+#endif
+
+#ifdef CUTIL_HMAP_STATS
+// lookups count too, and they may run concurrently under a shared lock (see chmap and cache), so counters are
+// bumped atomically. Relaxed is enough, nothing is ordered by them
+#if defined(__GNUC__)
+#define HMAP_COUNT(map, counter, n) ((void) __atomic_fetch_add(&(map)->counters.counter, (n), __ATOMIC_RELAXED))
+#define HMAP_COUNTER(map, counter) __atomic_load_n(&(map)->counters.counter, __ATOMIC_RELAXED)
+#else
+#define HMAP_COUNT(map, counter, n) ((map)->counters.counter += (n))
+#define HMAP_COUNTER(map, counter) ((map)->counters.counter)
+#endif
+
+static unsigned long long hmap_clock(void)
 {
-  // invalid action
-  if (!map)
-    return 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000000ull + (unsigned long long) ts.tv_nsec;
+}
+#define HMAP_CLOCK() hmap_clock()
+#else
+// the argument is still evaluated, but without stats it's a constant expression the compiler drops
+#define HMAP_COUNT(map, counter, n) ((void) (n))
+#define HMAP_CLOCK() 0ull
+#endif
 
-  size_t target_buckets = map->buckets;
-  float lf = (float) map->size / (float) (map->buckets + 1);
-  if (lf > map->loadFactorMax)
-    target_buckets = map->size * map->loadFactorMax;
-  if (lf < map->loadFactorMin)
-    target_buckets = map->size * map->loadFactorMin;
-  
-  if (target_buckets < map->minBuckets)
-    target_buckets = map->minBuckets;
+// bucket counts are powers of two, so the bucket index is a mask of the mixed hash
+#define HMAP_INDEX(hash, buckets) ((hash) & ((buckets) - 1))
 
-  if (target_buckets == map->buckets)
-    return 1;
+// Largest power of two a size_t holds, which bounds the bucket count
+#define HMAP_MAX_BUCKETS ((SIZE_MAX >> 1) + 1)
+
+// The bucket array is followed by a bitmap with one bit per bucket, set while the bucket holds a chain
+#define HMAP_OCCUPANCY_WORDS(buckets) (((buckets) + 63) / 64)
+
+static inline uint64_t* hmap_occupancy(struct hmap_bucket* buckets, size_t count)
+{
+  return (uint64_t*) (buckets + count);
+}
+
+static inline void hmap_mark(struct cutil_hmap_t* map, size_t idx)
+{
+  hmap_occupancy((struct hmap_bucket*) map->mapData, map->buckets)[idx / 64] |= (uint64_t) 1 << (idx % 64);
+}
+
+static inline void hmap_unmark_if_empty(struct cutil_hmap_t* map, size_t idx)
+{
+  struct hmap_bucket* buckets = (struct hmap_bucket*) map->mapData;
+  if (!buckets[idx].start)
+    hmap_occupancy(buckets, map->buckets)[idx / 64] &= ~((uint64_t) 1 << (idx % 64));
+}
+
+// Returns the first non empty bucket in [from, end), or end
+static size_t hmap_next_occupied(struct cutil_hmap_t* map, size_t from, size_t end)
+{
+  uint64_t* occ = hmap_occupancy((struct hmap_bucket*) map->mapData, map->buckets);
+  while (from < end)
+  {
+    uint64_t word = occ[from / 64] >> (from % 64);
+    if (word)
+    {
+#if defined(__GNUC__)
+      from += (size_t) __builtin_ctzll(word);
+#else
+      while (!(word & 1))
+      {
+        word >>= 1;
+        from++;
+      }
+#endif
+      return (from < end) ? from : end;
+    }
+    from = (from / 64 + 1) * 64;
+  }
+
+  return end;
+}
+
+// Hashes a key. The finalizer lets the low bits pick the bucket even for weak hash functions
+static inline size_t hmap_hash(struct cutil_hmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map->keyedHashFn)
+    return cutil_hmap_key_hash(key, map->hashFn);
+
+  // keyed hashes are well distributed already, so they skip the finalizer
+  size_t hash = map->keyedHashFn(key.key, key.len, &map->seed);
+  return (hash) ? hash : 1;
+}
+
+static inline int hmap_key_equal(struct cutil_hmap_t* map, struct cutil_hmap_key_t a, struct cutil_hmap_key_t b)
+{
+  if (map->equalFn)
+    return map->equalFn(a.key, b.key, a.len, b.len);
+  return map->compareFn(a.key, b.key, a.len, b.len) == CUTIL_EQ;
+}
+
+// Returns the link pointing at the node holding the key, or NULL if the bucket doesn't hold it
+static struct hmap_node** hmap_bucket_find(struct cutil_hmap_t* map, struct hmap_bucket* bucket, struct cutil_hmap_key_t key, size_t hash)
+{
+  struct hmap_node** link = &bucket->start;
+  while (*link)
+  {
+    // only compare the bytes when the full hashes agree
+    if ((*link)->hash == hash)
+    {
+      HMAP_COUNT(map, compares, 1);
+      if (hmap_key_equal(map, key, (*link)->tuple.key))
+        return link;
+    }
+    link = &(*link)->next;
+  }
+
+  return NULL;
+}
 
+// Looks the key up in the current buckets, then in the buckets being migrated
+static struct hmap_node** hmap_find(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash)
+{
+  struct hmap_bucket* buckets = (struct hmap_bucket*) map->mapData;
+  struct hmap_node** link = hmap_bucket_find(map, &buckets[HMAP_INDEX(hash, map->buckets)], key, hash);
+  if (!link && map->oldData)
+  {
+    struct hmap_bucket* old = (struct hmap_bucket*) map->oldData;
+    link = hmap_bucket_find(map, &old[HMAP_INDEX(hash, map->oldBuckets)], key, hash);
+  }
+
+  if (link)
+    HMAP_COUNT(map, hits, 1);
+  else
+    HMAP_COUNT(map, misses, 1);
+  return link;
+}
+
+// Moves up to `steps` buckets from the old bucket array into the current one
+static void hmap_rehash_step(struct cutil_hmap_t* map, size_t steps)
+{
+  struct hmap_bucket* old = (struct hmap_bucket*) map->oldData;
+  if (!old)
+    return;
+
+  unsigned long long start = HMAP_CLOCK();
+  struct hmap_bucket* repl = (struct hmap_bucket*) map->mapData;
+  for (; steps > 0 && map->rehashIdx < map->oldBuckets; steps--)
+  {
+    struct hmap_node* n = old[map->rehashIdx].start;
+    while (n)
+    {
+      size_t hash_nw = HMAP_INDEX(n->hash, map->buckets);
+      struct hmap_node* tmp_next = n->next;
+      n->next = repl[hash_nw].start;
+      repl[hash_nw].start = n;
+      hmap_mark(map, hash_nw);
+      n = tmp_next;
+    }
+    old[map->rehashIdx++].start = NULL;
+  }
+
+  HMAP_COUNT(map, resizeNanos, HMAP_CLOCK() - start);
+  if (map->rehashIdx < map->oldBuckets)
+    return;
+
+  free(old);
+  map->oldData = NULL;
+  map->oldBuckets = 0;
+  map->rehashIdx = 0;
+}
+
+static size_t hmap_node_bytes(int owned_keys)
+{
+  return sizeof(struct hmap_node) + (owned_keys ? CUTIL_HMAP_INLINE_KEY : 0);
+}
+
+static struct hmap_node* hmap_node_alloc(struct cutil_hmap_t* map, struct cutil_hmap_key_t key)
+{
+  // long owned keys get a node and key in a single allocation, outside of the pool
+  struct hmap_node* n = (map->ownedKeys && key.len > CUTIL_HMAP_INLINE_KEY)
+    ? malloc(sizeof(*n) + key.len)
+    : cutil_pool_alloc(&map->nodePool);
+  if (!n)
+    return NULL;
+
+  n->tuple.key = key;
+  if (map->ownedKeys)
+  {
+    if (key.len)
+      memcpy(n->keyData, key.key, key.len);
+    n->tuple.key.key = n->keyData;
+  }
+  return n;
+}
+
+static void hmap_node_free(struct cutil_hmap_t* map, struct hmap_node* n)
+{
+  if (map->ownedKeys && n->tuple.key.len > CUTIL_HMAP_INLINE_KEY)
+    free(n);
+  else
+    cutil_pool_free(&map->nodePool, n);
+}
+
+static size_t hmap_pow2(size_t n)
+{
+  size_t p = 1;
+  while (p < n && p < HMAP_MAX_BUCKETS)
+    p <<= 1;
+  return p;
+}
+
+// Smallest bucket count holding `size` entries at load factor `lf`, or 0 if no bucket count does
+static size_t hmap_buckets_for(struct cutil_hmap_t* map, size_t size, float lf)
+{
+  size_t target = map->minBuckets;
+  while ((float) size > (float) target * lf)
+  {
+    if (target >= HMAP_MAX_BUCKETS)
+      return 0;
+    target <<= 1;
+  }
+  return target;
+}
+
+// Allocates `target_buckets` buckets and hands the current ones over for migration
+static int hmap_resize(struct cutil_hmap_t* map, size_t target_buckets)
+{
+  unsigned long long start = HMAP_CLOCK();
   size_t current_bkts = map->buckets;
   struct hmap_bucket* current = (struct hmap_bucket*) map->mapData;
-  struct hmap_bucket* repl = (struct hmap_bucket*) malloc(sizeof(*repl) * target_buckets);
+  if (target_buckets > SIZE_MAX / (2 * sizeof(*current)))
+    return 0;
+
+  struct hmap_bucket* repl = (struct hmap_bucket*) malloc(
+    sizeof(*repl) * target_buckets + sizeof(uint64_t) * HMAP_OCCUPANCY_WORDS(target_buckets));
   if (!repl)
     return 0;
 
@@ -47,30 +272,75 @@ static int cutil_hmap_rebucket(struct cutil_hmap_t* map)
   {
     repl[i].start = NULL;
   }
+  memset(hmap_occupancy(repl, target_buckets), 0, sizeof(uint64_t) * HMAP_OCCUPANCY_WORDS(target_buckets));
+  HMAP_COUNT(map, resizes, 1);
+  HMAP_COUNT(map, resizeNanos, HMAP_CLOCK() - start);
 
   map->buckets = target_buckets;
   map->mapData = (void*) repl;
   if (!current)
     return 1;
-  
-  for (size_t i = 0; i < current_bkts; i++)
+
+  // hand the old buckets over, then drain them now or a few at a time
+  map->oldData = (void*) current;
+  map->oldBuckets = current_bkts;
+  map->rehashIdx = 0;
+  if (!map->rehashStep)
+    hmap_rehash_step(map, current_bkts);
+
+  return 1;
+}
+
+static int cutil_hmap_rebucket(struct cutil_hmap_t* map)
+{
+  // invalid action
+  if (!map)
+    return 0;
+
+  // an incremental resize is still in progress. Let it finish first
+  if (map->oldData)
+    return 1;
+
+  if (!map->mapData)
+    return hmap_resize(map, map->minBuckets);
+
+  // double when over the max load factor. Shrink below the min load factor, but only down to where the load
+  // factor sits between min and max, so that a map hovering around a threshold doesn't resize back and forth
+  size_t target_buckets = map->buckets;
+  float lf = (float) map->size / (float) map->buckets;
+  if (lf > map->loadFactorMax)
   {
-    struct hmap_node* n = current[i].start;
-    while (n)
-    {
-      // rehash and move to new bucket
-      size_t hash_nw = map->hashFn(n->key.key, n->key.len) % target_buckets;
-      struct hmap_node* tmp_next = n->next;
-      current[i].start = tmp_next;
-      n->next = repl[hash_nw].start;
-      repl[hash_nw].start = n;
-      n = tmp_next;
-    }
+    // past the largest bucket count, the chains take the extra entries
+    target_buckets = hmap_buckets_for(map, map->size, map->loadFactorMax);
+    if (!target_buckets)
+      target_buckets = map->buckets;
+    else if (target_buckets < map->buckets * 2)
+      target_buckets = map->buckets * 2;
+  }
+  else if (lf < map->loadFactorMin)
+  {
+    target_buckets = hmap_buckets_for(map, map->size, (map->loadFactorMin + map->loadFactorMax) / 2.f);
   }
 
-  free(current);
-//  printf("Rebucket: %ld -> %ld\n", buckets_start, map->buckets);
+  if (target_buckets < map->minBuckets)
+    target_buckets = map->minBuckets;
+
+  if (target_buckets == map->buckets)
+    return 1;
+
+  return hmap_resize(map, target_buckets);
+}
 
+// Resizes to exactly `target_buckets` and completes the migration right away
+static int hmap_resize_now(struct cutil_hmap_t* map, size_t target_buckets)
+{
+  hmap_rehash_step(map, map->oldBuckets);
+  if (target_buckets == map->buckets)
+    return 1;
+
+  if (!hmap_resize(map, target_buckets))
+    return 0;
+  hmap_rehash_step(map, map->oldBuckets);
   return 1;
 }
 
@@ -80,13 +350,25 @@ void cutil_hmap_init(struct cutil_hmap_t* map)
     return;
 
   map->mapData = NULL;
+  map->buckets = 0;
   map->minBuckets = 16;
   map->size = 0;
-  map->loadFactorMin = 0.50;
+  map->loadFactorMin = 0.25;
   map->loadFactorMax = 0.75;
-  map->hashFn = cutil_hash_arb_xor_chained;
+  map->hashFn = cutil_hash_default;
+  map->keyedHashFn = NULL;
+  map->seed.k0 = 0;
+  map->seed.k1 = 0;
   map->compareFn = cutil_compare_lex;
+  map->equalFn = cutil_equal_bytes;
   map->destuctor = NULL;
+  map->oldData = NULL;
+  map->oldBuckets = 0;
+  map->rehashIdx = 0;
+  map->rehashStep = 0;
+  map->ownedKeys = 0;
+  cutil_hmap_stats_reset(map);
+  cutil_pool_init(&map->nodePool, hmap_node_bytes(0), HMAP_NODES_PER_CHUNK);
 
   cutil_hmap_rebucket(map);
 
@@ -96,13 +378,10 @@ void cutil_hmap_init(struct cutil_hmap_t* map)
   }
 }
 
-void cutil_hmap_destroy(struct cutil_hmap_t* map)
+static void hmap_free_buckets(struct cutil_hmap_t* map, struct hmap_bucket* buckets, size_t count)
 {
-  if (!map)
-    return;
-  
-  struct hmap_bucket* buckets = (struct hmap_bucket*) map->mapData;
-  for (size_t i = 0; i < map->buckets; i++)
+  // pooled nodes go away with the pool, so only walk the chains if there is a destructor to call or a long key
+  for (size_t i = 0; (map->destuctor || map->ownedKeys) && i < count; i++)
   {
     // free the bucket
     struct hmap_node* n = buckets[i].start;
@@ -111,18 +390,31 @@ void cutil_hmap_destroy(struct cutil_hmap_t* map)
       struct hmap_node* cur = n;
       n = n->next;
 
-      struct cutil_hmap_tuple_t t = cutil_hmap_make_tuple(cur->key, cur->data);
+      struct cutil_hmap_tuple_t t = cur->tuple;
       if (map->destuctor)
         map->destuctor(&t);
-      
-      free(cur);
+      if (map->ownedKeys && cur->tuple.key.len > CUTIL_HMAP_INLINE_KEY)
+        free(cur);
     }
   }
 
   free(buckets);
+}
+
+void cutil_hmap_destroy(struct cutil_hmap_t* map)
+{
+  if (!map)
+    return;
+  
+  hmap_free_buckets(map, (struct hmap_bucket*) map->mapData, map->buckets);
+  hmap_free_buckets(map, (struct hmap_bucket*) map->oldData, map->oldBuckets);
+  cutil_pool_destroy(&map->nodePool);
 
   map->minBuckets = 0;
   map->hashFn = NULL;
+  map->keyedHashFn = NULL;
+  map->seed.k0 = 0;
+  map->seed.k1 = 0;
   map->size = 0;
   map->buckets = map->minBuckets;
   map->loadFactorMax = 0.f;
@@ -130,6 +422,11 @@ void cutil_hmap_destroy(struct cutil_hmap_t* map)
   map->destuctor = NULL;
   map->mapData = NULL;
   map->compareFn = NULL;
+  map->equalFn = NULL;
+  map->oldData = NULL;
+  map->oldBuckets = 0;
+  map->rehashIdx = 0;
+  map->rehashStep = 0;
 }
 
 void cutil_hmap_set_destructor(struct cutil_hmap_t* map, cutil_destructor_func_t dest)
@@ -140,13 +437,49 @@ void cutil_hmap_set_destructor(struct cutil_hmap_t* map, cutil_destructor_func_t
 
 void cutil_hmap_set_hashfn(struct cutil_hmap_t* map, cutil_hash_func_t hash_fn)
 {
-  if (map)
+  // entries cache their hash, so the function can't change under them
+  if (map && map->size == 0)
+  {
     map->hashFn = hash_fn;
+    map->keyedHashFn = NULL;
+  }
+}
+
+void cutil_hmap_set_equalfn(struct cutil_hmap_t* map, cutil_equal_func_t equal_fn)
+{
+  if (map && equal_fn && map->size == 0)
+    map->equalFn = equal_fn;
+}
+
+void cutil_hmap_set_comparefn(struct cutil_hmap_t* map, cutil_compare_func_t compare_fn)
+{
+  if (map && compare_fn && map->size == 0)
+  {
+    map->compareFn = compare_fn;
+    map->equalFn = NULL;
+  }
+}
+
+int cutil_hmap_set_keyed_hashfn(struct cutil_hmap_t* map, cutil_keyed_hash_func_t hash_fn, const struct cutil_hash_seed_t* seed)
+{
+  if (!map || map->size != 0)
+    return 0;
+
+  struct cutil_hash_seed_t s;
+  if (seed)
+    s = *seed;
+  else if (hash_fn && !cutil_hash_seed_random(&s))
+    return 0;
+
+  map->keyedHashFn = hash_fn;
+  map->seed.k0 = (hash_fn) ? s.k0 : 0;
+  map->seed.k1 = (hash_fn) ? s.k1 : 0;
+  return 1;
 }
 
 void cutil_hmap_set_loadfactor(struct cutil_hmap_t* map, float min, float max)
 {
-  if (map && min < max)
+  if (map && min < max && max > 0)
   {
     map->loadFactorMin = min;
     map->loadFactorMax = max;
@@ -157,10 +490,72 @@ void cutil_hmap_set_loadfactor(struct cutil_hmap_t* map, float min, float max)
 void cutil_hmap_set_min_buckets(struct cutil_hmap_t* map, size_t min)
 {
   if (map)
-    map->minBuckets = min;
+    map->minBuckets = hmap_pow2(min);
   cutil_hmap_rebucket(map);
 }
 
+int cutil_hmap_reserve(struct cutil_hmap_t* map, size_t n)
+{
+  if (!map)
+    return 0;
+
+  size_t target_buckets = hmap_buckets_for(map, n, map->loadFactorMax);
+  if (!target_buckets)
+    return 0;
+  if (target_buckets <= map->buckets)
+    return 1;
+
+  return hmap_resize_now(map, target_buckets);
+}
+
+int cutil_hmap_shrink_to_fit(struct cutil_hmap_t* map)
+{
+  if (!map)
+    return 0;
+
+  size_t target_buckets = hmap_buckets_for(map, map->size, map->loadFactorMax);
+  return (target_buckets) ? hmap_resize_now(map, target_buckets) : 0;
+}
+
+void cutil_hmap_set_incremental(struct cutil_hmap_t* map, size_t step)
+{
+  if (!map)
+    return;
+
+  map->rehashStep = step;
+  if (!step)
+    hmap_rehash_step(map, map->oldBuckets);
+}
+
+size_t cutil_hmap_set_node_region(struct cutil_hmap_t* map, void* region, size_t bytes)
+{
+  return (map) ? cutil_pool_add_region(&map->nodePool, region, bytes) : 0;
+}
+
+void cutil_hmap_set_pool_fixed(struct cutil_hmap_t* map, int fixed)
+{
+  if (map)
+    cutil_pool_set_chunk_objs(&map->nodePool, (fixed) ? 0 : HMAP_NODES_PER_CHUNK);
+}
+
+size_t cutil_hmap_node_size(struct cutil_hmap_t* map)
+{
+  return (map) ? map->nodePool.objSize : 0;
+}
+
+int cutil_hmap_set_owned_keys(struct cutil_hmap_t* map, int owned)
+{
+  // the node size changes, so the pool has to start over, keeping whether it may grow
+  if (!map || map->size != 0)
+    return 0;
+
+  size_t chunk_objs = map->nodePool.chunkObjs;
+  cutil_pool_destroy(&map->nodePool);
+  cutil_pool_init(&map->nodePool, hmap_node_bytes(owned), chunk_objs);
+  map->ownedKeys = owned ? 1 : 0;
+  return 1;
+}
+
 size_t cutil_hmap_size(struct cutil_hmap_t* map)
 {
   return (map) ? map->size : 0;
@@ -171,165 +566,492 @@ int cutil_hmap_probe_hashfn(struct cutil_hmap_t* map, struct cutil_hmap_key_t ke
   if (!map)
     return 0;
   
-  size_t hash = map->hashFn(key.key, key.len) % map->buckets;
+  size_t hash = hmap_hash(map, key);
   struct hmap_bucket* buckets = map->mapData;
+  if (buckets[HMAP_INDEX(hash, map->buckets)].start != NULL)
+    return 1;
 
-  return (buckets[hash].start != NULL) ? 1 : 0;
+  struct hmap_bucket* old = map->oldData;
+  return (old && old[HMAP_INDEX(hash, map->oldBuckets)].start != NULL) ? 1 : 0;
 }
 
 int cutil_hmap_probe_key(struct cutil_hmap_t* map, struct cutil_hmap_key_t key)
+{
+  return (map) ? cutil_hmap_probe_key_hashed(map, key, hmap_hash(map, key)) : 0;
+}
+
+int cutil_hmap_probe_key_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash)
 {
   if (!map)
     return 0;
-  
-  size_t hash = map->hashFn(key.key, key.len) % map->buckets;
-  struct hmap_bucket* buckets = map->mapData;
 
-  if (!buckets[hash].start)
-    return 0;
-  
-  struct hmap_node* n = buckets[hash].start;
-  int comp;
-  while (n && (comp = map->compareFn(key.key, n->key.key, key.len, n->key.len)) != CUTIL_EQ)
-    n = n->next;
-  
-  return (comp == CUTIL_EQ) ? 1 : 0;
+  return (hmap_find(map, key, hash) != NULL) ? 1 : 0;
 }
 
-int cutil_hmap_insert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t)
+// Adds a node for a key known to be missing. Nodes never move, so the node stays valid across the resize
+static struct hmap_node* hmap_link_new(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash)
 {
-  if (!map)
-    return 0;
-  
-  size_t hash = map->hashFn(t.key.key, t.key.len) % map->buckets;
+  struct hmap_node* ins = hmap_node_alloc(map, t.key);
+  if (!ins)
+    return NULL;
+
+  // new entries always go to the current buckets
   struct hmap_bucket* buckets = map->mapData;
+  if (buckets[HMAP_INDEX(hash, map->buckets)].start)
+    HMAP_COUNT(map, collisions, 1);
+  ins->tuple.value = t.value;
+  ins->hash = hash;
+  ins->next = buckets[HMAP_INDEX(hash, map->buckets)].start;
+  buckets[HMAP_INDEX(hash, map->buckets)].start = ins;
+  hmap_mark(map, HMAP_INDEX(hash, map->buckets));
 
-  // check to see if found
-  int found = CUTIL_LT;
-  struct hmap_node* tmp = buckets[hash].start;
-  while (tmp)
-  {
-    found = map->compareFn(tmp->key.key, t.key.key, tmp->key.len, t.key.len);
-    if (found)
-      break;
-    
-    tmp = tmp->next;
-  }
+  map->size++;
 
+  // inserts only ever grow, so that a reserve() ahead of a bulk load sticks
+  if ((float) map->size > (float) map->buckets * map->loadFactorMax)
+    cutil_hmap_rebucket(map);
 
+  return ins;
+}
+
+static int hmap_insert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash)
+{
   // Element already exists. Don't insert
-  if (found == CUTIL_EQ)
+  if (hmap_find(map, t.key, hash))
     return 0;
 
-  struct hmap_node* ins = malloc(sizeof *ins);
-  if (!ins)
+  return (hmap_link_new(map, t, hash)) ? 1 : 0;
+}
+
+// Unlinks the node of the key. If `taken` is set, the tuple is handed over there instead of to the destructor
+static int hmap_del_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash, struct cutil_hmap_tuple_t* taken)
+{
+  struct hmap_node** link = hmap_find(map, key, hash);
+
+  // key not found
+  if (!link)
     return 0;
 
-  ins->data = t.value;
-  ins->key = t.key;
-  ins->next = buckets[hash].start;
-  buckets[hash].start = ins;
+  struct hmap_node* n = *link;
+  *link = n->next;
+  hmap_unmark_if_empty(map, HMAP_INDEX(hash, map->buckets));
+  map->size--;
 
-  map->size++;
+  if (taken)
+  {
+    // an owned key goes away with the node
+    *taken = n->tuple;
+    if (map->ownedKeys)
+      taken->key.key = key.key;
+  }
+  else if (map->destuctor)
+  {
+    struct cutil_hmap_tuple_t rm = n->tuple;
+    map->destuctor(&rm);
+  }
+
+  hmap_node_free(map, n);
   cutil_hmap_rebucket(map);
 
   return 1;
 }
 
+// Pulls in the bucket slots of a whole group, then the chain heads, so the misses of independent keys overlap
+static void hmap_prefetch_group(struct cutil_hmap_t* map, const size_t* hashes, size_t n)
+{
+  struct hmap_bucket* buckets = (struct hmap_bucket*) map->mapData;
+  struct hmap_bucket* old = (struct hmap_bucket*) map->oldData;
+
+  for (size_t i = 0; i < n; i++)
+  {
+    HMAP_PREFETCH(&buckets[HMAP_INDEX(hashes[i], map->buckets)]);
+    if (old)
+      HMAP_PREFETCH(&old[HMAP_INDEX(hashes[i], map->oldBuckets)]);
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    struct hmap_node* head = buckets[HMAP_INDEX(hashes[i], map->buckets)].start;
+    if (head)
+      HMAP_PREFETCH(head);
+  }
+}
+
+int cutil_hmap_insert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t)
+{
+  return (map) ? cutil_hmap_insert_hashed(map, t, hmap_hash(map, t.key)) : 0;
+}
+
+int cutil_hmap_insert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash)
+{
+  if (!map)
+    return 0;
+  
+  hmap_rehash_step(map, map->rehashStep);
+
+  return hmap_insert_hashed(map, t, hash);
+}
+
 void** cutil_hmap_get(struct cutil_hmap_t* map, struct cutil_hmap_key_t key)
+{
+  return (map) ? cutil_hmap_get_hashed(map, key, hmap_hash(map, key)) : NULL;
+}
+
+void** cutil_hmap_get_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash)
 {
   if (!map)
     return NULL;
   
-  size_t hash = map->hashFn(key.key, key.len) % map->buckets;
+  hmap_rehash_step(map, map->rehashStep);
 
-  struct hmap_bucket* buckets = (struct hmap_bucket*) map->mapData;
+  struct hmap_node** link = hmap_find(map, key, hash);
   
-  struct hmap_node* tmp = buckets[hash].start;
-  int comp = CUTIL_GT;
-  while (tmp && (comp = map->compareFn(key.key, tmp->key.key, key.len, tmp->key.len)) != CUTIL_EQ)
-    tmp = tmp->next;
-  
-  if (!tmp || comp != CUTIL_EQ)
-    return NULL;
-  
-  return &tmp->data;
+  return (link) ? &(*link)->tuple.value : NULL;
 }
 
 int cutil_hmap_del(struct cutil_hmap_t* map, struct cutil_hmap_key_t key)
+{
+  return (map) ? cutil_hmap_del_hashed(map, key, hmap_hash(map, key)) : 0;
+}
+
+int cutil_hmap_del_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash)
 {
   if (!map)
     return 0;
   
-  size_t hash = map->hashFn(key.key, key.len) % map->buckets;
-  struct hmap_bucket* buckets = (struct hmap_bucket*) map->mapData;
+  hmap_rehash_step(map, map->rehashStep);
+
+  return hmap_del_hashed(map, key, hash, NULL);
+}
+
+void** cutil_hmap_get_or_insert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, int* inserted)
+{
+  if (!map)
+  {
+    if (inserted)
+      *inserted = 0;
+    return NULL;
+  }
+
+  return cutil_hmap_get_or_insert_hashed(map, t, hmap_hash(map, t.key), inserted);
+}
+
+void** cutil_hmap_get_or_insert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash, int* inserted)
+{
+  if (inserted)
+    *inserted = 0;
+  if (!map)
+    return NULL;
+
+  hmap_rehash_step(map, map->rehashStep);
+
+  struct hmap_node** link = hmap_find(map, t.key, hash);
+  if (link)
+    return &(*link)->tuple.value;
+
+  struct hmap_node* n = hmap_link_new(map, t, hash);
+  if (!n)
+    return NULL;
+
+  if (inserted)
+    *inserted = 1;
+  return &n->tuple.value;
+}
+
+void** cutil_hmap_upsert(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, void** previous)
+{
+  if (!map)
+  {
+    if (previous)
+      *previous = NULL;
+    return NULL;
+  }
+
+  return cutil_hmap_upsert_hashed(map, t, hmap_hash(map, t.key), previous);
+}
+
+void** cutil_hmap_upsert_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t t, size_t hash, void** previous)
+{
+  if (previous)
+    *previous = NULL;
+  if (!map)
+    return NULL;
+
+  hmap_rehash_step(map, map->rehashStep);
+
+  struct hmap_node** link = hmap_find(map, t.key, hash);
+  struct hmap_node* n = (link) ? *link : hmap_link_new(map, t, hash);
+  if (!n)
+    return NULL;
+
+  if (link)
+  {
+    if (previous)
+      *previous = n->tuple.value;
+    n->tuple.value = t.value;
+  }
 
-  // hash search failed
-  if (!buckets[hash].start)
+  return &n->tuple.value;
+}
+
+int cutil_hmap_take(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, struct cutil_hmap_tuple_t* out)
+{
+  return (map) ? cutil_hmap_take_hashed(map, key, hmap_hash(map, key), out) : 0;
+}
+
+int cutil_hmap_take_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t key, size_t hash, struct cutil_hmap_tuple_t* out)
+{
+  if (!map || !out)
+    return 0;
+
+  hmap_rehash_step(map, map->rehashStep);
+
+  return hmap_del_hashed(map, key, hash, out);
+}
+
+size_t cutil_hmap_get_many(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, size_t n, void*** values)
+{
+  if (!map || !keys || !values)
+    return 0;
+
+  size_t found = 0;
+  size_t hashes[HMAP_BATCH];
+  for (size_t base = 0; base < n; base += HMAP_BATCH)
+  {
+    size_t cnt = (n - base < HMAP_BATCH) ? n - base : HMAP_BATCH;
+    for (size_t i = 0; i < cnt; i++)
+      hashes[i] = hmap_hash(map, keys[base + i]);
+    found += cutil_hmap_get_many_hashed(map, keys + base, hashes, cnt, values + base);
+  }
+
+  return found;
+}
+
+size_t cutil_hmap_get_many_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, const size_t* hashes, size_t n, void*** values)
+{
+  if (!map || !keys || !hashes || !values)
     return 0;
 
-  // begin chained search
-  struct hmap_node* n = buckets[hash].start;
-  struct hmap_node* prev = NULL;
-  while (n)
+  size_t found = 0;
+  for (size_t base = 0; base < n; base += HMAP_BATCH)
   {
-    int comp = map->compareFn(key.key, n->key.key, key.len, n->key.len);
-    // key found!
-    if (comp == CUTIL_EQ)
+    size_t cnt = (n - base < HMAP_BATCH) ? n - base : HMAP_BATCH;
+    hmap_rehash_step(map, map->rehashStep * cnt);
+    hmap_prefetch_group(map, hashes + base, cnt);
+
+    for (size_t i = base; i < base + cnt; i++)
     {
-      // if start node
-      if (prev == NULL)
-        buckets[hash].start = n->next;
-      else
-        prev->next = n->next;
-      map->size--;
+      struct hmap_node** link = hmap_find(map, keys[i], hashes[i]);
+      values[i] = (link) ? &(*link)->tuple.value : NULL;
+      found += (link) ? 1 : 0;
+    }
+  }
 
-      if (map->destuctor)
-      {
-        struct cutil_hmap_tuple_t rm = cutil_hmap_make_tuple(n->key, n->data);
-        map->destuctor(&rm);
-      }
+  return found;
+}
+
+size_t cutil_hmap_insert_many(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t* tuples, size_t n)
+{
+  if (!map || !tuples)
+    return 0;
+
+  size_t inserted = 0;
+  size_t hashes[HMAP_BATCH];
+  for (size_t base = 0; base < n; base += HMAP_BATCH)
+  {
+    size_t cnt = (n - base < HMAP_BATCH) ? n - base : HMAP_BATCH;
+    for (size_t i = 0; i < cnt; i++)
+      hashes[i] = hmap_hash(map, tuples[base + i].key);
+    inserted += cutil_hmap_insert_many_hashed(map, tuples + base, hashes, cnt);
+  }
+
+  return inserted;
+}
+
+size_t cutil_hmap_insert_many_hashed(struct cutil_hmap_t* map, struct cutil_hmap_tuple_t* tuples, const size_t* hashes, size_t n)
+{
+  if (!map || !tuples || !hashes)
+    return 0;
+
+  size_t inserted = 0;
+  for (size_t base = 0; base < n; base += HMAP_BATCH)
+  {
+    size_t cnt = (n - base < HMAP_BATCH) ? n - base : HMAP_BATCH;
+    hmap_rehash_step(map, map->rehashStep * cnt);
+    hmap_prefetch_group(map, hashes + base, cnt);
+
+    // an insert may resize, which only costs the remaining prefetches their usefulness
+    for (size_t i = base; i < base + cnt; i++)
+      inserted += hmap_insert_hashed(map, tuples[i], hashes[i]);
+  }
 
-      free(n);
+  return inserted;
+}
+
+size_t cutil_hmap_del_many(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, size_t n)
+{
+  if (!map || !keys)
+    return 0;
 
-      return 1;
+  size_t deleted = 0;
+  size_t hashes[HMAP_BATCH];
+  for (size_t base = 0; base < n; base += HMAP_BATCH)
+  {
+    size_t cnt = (n - base < HMAP_BATCH) ? n - base : HMAP_BATCH;
+    for (size_t i = 0; i < cnt; i++)
+      hashes[i] = hmap_hash(map, keys[base + i]);
+    deleted += cutil_hmap_del_many_hashed(map, keys + base, hashes, cnt);
+  }
+
+  return deleted;
+}
+
+size_t cutil_hmap_del_many_hashed(struct cutil_hmap_t* map, struct cutil_hmap_key_t* keys, const size_t* hashes, size_t n)
+{
+  if (!map || !keys || !hashes)
+    return 0;
+
+  size_t deleted = 0;
+  for (size_t base = 0; base < n; base += HMAP_BATCH)
+  {
+    size_t cnt = (n - base < HMAP_BATCH) ? n - base : HMAP_BATCH;
+    hmap_rehash_step(map, map->rehashStep * cnt);
+    hmap_prefetch_group(map, hashes + base, cnt);
+
+    for (size_t i = base; i < base + cnt; i++)
+      deleted += hmap_del_hashed(map, keys[i], hashes[i], NULL);
+  }
+
+  return deleted;
+}
+
+// Adds the chains of buckets [from, count) to the histogram, along with the bytes of the nodes kept outside of the pool
+static void hmap_stats_chains(struct cutil_hmap_t* map, struct hmap_bucket* buckets, size_t from, size_t count, struct cutil_hmap_stats_t* stats)
+{
+  for (size_t i = from; i < count; i++)
+  {
+    size_t len = 0;
+    for (struct hmap_node* n = buckets[i].start; n; n = n->next)
+    {
+      len++;
+      if (map->ownedKeys && n->tuple.key.len > CUTIL_HMAP_INLINE_KEY)
+        stats->nodeBytes += sizeof(*n) + n->tuple.key.len;
     }
+
+    stats->chains[(len < CUTIL_HMAP_STATS_CHAINS) ? len : CUTIL_HMAP_STATS_CHAINS - 1]++;
+    if (len > stats->maxChain)
+      stats->maxChain = len;
   }
 
-  return 0;
+  if (buckets)
+    stats->bucketBytes += sizeof(*buckets) * count + sizeof(uint64_t) * HMAP_OCCUPANCY_WORDS(count);
+}
+
+int cutil_hmap_stats(struct cutil_hmap_t* map, struct cutil_hmap_stats_t* stats)
+{
+  if (!map || !stats)
+    return 0;
+
+  memset(stats, 0, sizeof(*stats));
+  stats->size = map->size;
+  stats->buckets = map->buckets;
+  stats->oldBuckets = map->oldBuckets;
+  stats->nodeBytes = cutil_pool_heap_bytes(&map->nodePool);
+  hmap_stats_chains(map, (struct hmap_bucket*) map->mapData, 0, map->buckets, stats);
+  // buckets already migrated are empty, and don't count as chains
+  hmap_stats_chains(map, (struct hmap_bucket*) map->oldData, map->rehashIdx, map->oldBuckets, stats);
+#ifdef CUTIL_HMAP_STATS
+  stats->counters.hits = HMAP_COUNTER(map, hits);
+  stats->counters.misses = HMAP_COUNTER(map, misses);
+  stats->counters.compares = HMAP_COUNTER(map, compares);
+  stats->counters.collisions = HMAP_COUNTER(map, collisions);
+  stats->counters.resizes = HMAP_COUNTER(map, resizes);
+  stats->counters.resizeNanos = HMAP_COUNTER(map, resizeNanos);
+#endif
+
+  return 1;
+}
+
+void cutil_hmap_stats_reset(struct cutil_hmap_t* map)
+{
+#ifdef CUTIL_HMAP_STATS
+  if (map)
+    memset(&map->counters, 0, sizeof(map->counters));
+#else
+  (void) map;
+#endif
 }
 
 struct cutil_hmap_iterator_t cutil_hmap_iterator_create(struct cutil_hmap_t* hmap)
+{
+  return cutil_hmap_iterator_range(hmap, 0, (hmap) ? hmap->buckets : 0);
+}
+
+struct cutil_hmap_iterator_t cutil_hmap_iterator_range(struct cutil_hmap_t* hmap, size_t begin, size_t end)
 {
   struct cutil_hmap_iterator_t it;
-  if (!hmap)
-    return it;
-  
   it.hmap = hmap;
   it.cur_bkt = 0;
+  it.end_bkt = 0;
   it.cur_nd = NULL;
+  if (!hmap || !hmap->mapData)
+    return it;
+
+  // iterators only walk the current buckets
+  hmap_rehash_step(hmap, hmap->oldBuckets);
+
+  if (end > hmap->buckets)
+    end = hmap->buckets;
+  if (begin > end)
+    begin = end;
+
+  it.end_bkt = end;
+  it.cur_bkt = hmap_next_occupied(hmap, begin, end);
+  if (it.cur_bkt < end)
+    it.cur_nd = ((struct hmap_bucket*) hmap->mapData)[it.cur_bkt].start;
+
+  return it;
+}
+
+size_t cutil_hmap_iterator_partition(struct cutil_hmap_t* hmap, struct cutil_hmap_iterator_t* iterators, size_t k)
+{
+  if (!hmap || !iterators || !k)
+    return 0;
+
+  // complete the migration first so that the ranges are cut from the final bucket count
+  hmap_rehash_step(hmap, hmap->oldBuckets);
+
+  for (size_t i = 0; i < k; i++)
+    iterators[i] = cutil_hmap_iterator_range(hmap, hmap->buckets * i / k, hmap->buckets * (i + 1) / k);
+
+  return k;
 }
 
 struct cutil_hmap_tuple_t* cutil_hmap_iterator_peek(struct cutil_hmap_iterator_t* iterator)
 {
-  // if (!iterator || !iterator->hmap)
-  //   return NULL;
-  
-  // struct hmap_bucket* buckets = (struct hmap_bucket*) iterator->hmap->mapData;
+  if (!iterator || !iterator->cur_nd)
+    return NULL;
 
-  // // find the first node
-  // if (iterator->cur_nd == NULL && iterator->cur_bkt == 0)
-  // {
-  //   for (size_t i = iterator->cur_bkt; i < iterator->hmap->buckets; i++)
-  //   {
-  //     if (!buckets[i].start)
-  //       continue;
-  //   }
-  // }
+  return &((struct hmap_node*) iterator->cur_nd)->tuple;
 }
 
 struct cutil_hmap_tuple_t* cutil_hmap_iterator_next(struct cutil_hmap_iterator_t* iterator)
 {
+  if (!iterator || !iterator->cur_nd)
+    return NULL;
+
+  struct hmap_node* n = ((struct hmap_node*) iterator->cur_nd)->next;
+  if (!n)
+  {
+    // skip runs of empty buckets a bitmap word at a time
+    struct cutil_hmap_t* hmap = iterator->hmap;
+    iterator->cur_bkt = hmap_next_occupied(hmap, iterator->cur_bkt + 1, iterator->end_bkt);
+    if (iterator->cur_bkt < iterator->end_bkt)
+      n = ((struct hmap_bucket*) hmap->mapData)[iterator->cur_bkt].start;
+  }
+
+  iterator->cur_nd = n;
+  return (n) ? &n->tuple : NULL;
 }
 
 struct cutil_hmap_key_t cutil_hmap_make_key(void* key, size_t len)
@@ -340,11 +1062,15 @@ struct cutil_hmap_key_t cutil_hmap_make_key(void* key, size_t len)
   return k;
 }
 
+size_t cutil_hmap_hash(struct cutil_hmap_t* map, struct cutil_hmap_key_t key)
+{
+  return (map) ? hmap_hash(map, key) : 0;
+}
+
 struct cutil_hmap_tuple_t cutil_hmap_make_tuple(struct cutil_hmap_key_t key, void* data)
 {
   struct cutil_hmap_tuple_t t;
-  t.key.key = key.key;
-  t.key.len = key.len;
+  t.key = key;
   t.value = data;
 
   return t;
@@ -0,0 +1,364 @@
+#include "cutil.h"
+#include "hmapfile.h"
+#include "hash.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HMAPFILE_MAGIC "CUTILHM1"
+
+// alignment of the sections and of every value
+#define HMAPFILE_ALIGN 16
+
+// All offsets are from the start of the image. The layout is:
+// header | bucket index (buckets + 1) | entries (size) | per entry: value, key
+typedef struct hmapfile_header
+{
+  char magic[8];
+  uint64_t size;
+  uint64_t buckets;
+  uint64_t valueSize;
+  uint64_t bucketOff;
+  uint64_t entryOff;
+  uint64_t bytes;
+} hmapfile_header;
+
+typedef struct hmapfile_entry
+{
+  uint64_t hash;
+  uint64_t keyOff;
+  uint64_t keyLen;
+  uint64_t valueOff;
+} hmapfile_entry;
+
+// a tuple of the map being written, along with its hash
+typedef struct hmapfile_src
+{
+  struct cutil_hmap_tuple_t* tuple;
+  size_t hash;
+} hmapfile_src;
+
+static inline uint64_t hmapfile_align(uint64_t off)
+{
+  return (off + HMAPFILE_ALIGN - 1) & ~(uint64_t) (HMAPFILE_ALIGN - 1);
+}
+
+static int hmapfile_put(FILE* f, uint64_t* off, const void* data, size_t bytes)
+{
+  *off += bytes;
+  return fwrite(data, 1, bytes, f) == bytes;
+}
+
+static int hmapfile_zeros(FILE* f, uint64_t* off, size_t bytes)
+{
+  static const char zeros[256] = { 0 };
+  int ok = 1;
+  for (size_t n; ok && bytes; bytes -= n)
+  {
+    n = (bytes < sizeof(zeros)) ? bytes : sizeof(zeros);
+    ok = hmapfile_put(f, off, zeros, n);
+  }
+  return ok;
+}
+
+// Writes zeros up to the next aligned offset
+static int hmapfile_pad(FILE* f, uint64_t* off)
+{
+  return hmapfile_zeros(f, off, (size_t) (hmapfile_align(*off) - *off));
+}
+
+// Writes the image of the tuples, sorted by bucket with `idx` holding the start of every bucket
+static int hmapfile_emit(FILE* f, hmapfile_src* src, uint64_t* idx, size_t n, size_t buckets, size_t value_size)
+{
+  hmapfile_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, HMAPFILE_MAGIC, sizeof(h.magic));
+  h.size = n;
+  h.buckets = buckets;
+  h.valueSize = value_size;
+  h.bucketOff = hmapfile_align(sizeof(h));
+  h.entryOff = hmapfile_align(h.bucketOff + sizeof(uint64_t) * (buckets + 1));
+
+  // lay the values and keys out first, so that the entries can be written in one pass
+  uint64_t off = h.entryOff + sizeof(hmapfile_entry) * n;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (value_size)
+      off = hmapfile_align(off) + value_size;
+    off += src[i].tuple->key.len;
+  }
+  h.bytes = off;
+
+  off = 0;
+  int ok = hmapfile_put(f, &off, &h, sizeof(h)) && hmapfile_pad(f, &off)
+    && hmapfile_put(f, &off, idx, sizeof(uint64_t) * (buckets + 1)) && hmapfile_pad(f, &off);
+
+  uint64_t data = h.entryOff + sizeof(hmapfile_entry) * n;
+  for (size_t i = 0; ok && i < n; i++)
+  {
+    hmapfile_entry e;
+    e.hash = src[i].hash;
+    if (value_size)
+      data = hmapfile_align(data);
+    e.valueOff = data;
+    data += value_size;
+    e.keyOff = data;
+    e.keyLen = src[i].tuple->key.len;
+    data += e.keyLen;
+    ok = hmapfile_put(f, &off, &e, sizeof(e));
+  }
+
+  for (size_t i = 0; ok && i < n; i++)
+  {
+    struct cutil_hmap_tuple_t* t = src[i].tuple;
+    if (value_size)
+    {
+      ok = hmapfile_pad(f, &off);
+      if (ok)
+        ok = (t->value) ? hmapfile_put(f, &off, t->value, value_size) : hmapfile_zeros(f, &off, value_size);
+    }
+    if (ok && t->key.len)
+      ok = hmapfile_put(f, &off, t->key.key, t->key.len);
+  }
+
+  return ok && off == h.bytes;
+}
+
+// Flushes the directory holding `path`, so that a rename into it survives a crash
+static int hmapfile_sync_dir(const char* path)
+{
+  const char* slash = strrchr(path, '/');
+  char* dir = (slash) ? malloc((size_t) (slash - path) + 2) : NULL;
+  if (slash && !dir)
+    return 0;
+
+  if (dir)
+  {
+    // keep the slash of a file directly under the root
+    size_t len = (slash == path) ? 1 : (size_t) (slash - path);
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+  }
+
+  int fd = open((dir) ? dir : ".", O_RDONLY);
+  free(dir);
+  if (fd < 0)
+    return 0;
+
+  int ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+int cutil_hmapfile_write(struct cutil_hmap_t* map, const char* path, size_t value_size)
+{
+  if (!map || !path)
+    return 0;
+
+  size_t n = cutil_hmap_size(map);
+  size_t buckets = 1;
+  while (buckets < n)
+    buckets <<= 1;
+
+  hmapfile_src* src = malloc(sizeof(*src) * (n ? n : 1));
+  hmapfile_src* sorted = malloc(sizeof(*sorted) * (n ? n : 1));
+  uint64_t* idx = calloc(buckets + 1, sizeof(*idx));
+  char* tmp = malloc(strlen(path) + sizeof(".XXXXXX"));
+  int ok = src && sorted && idx && tmp;
+
+  // counting sort by bucket. idx[b + 1] first counts bucket b, then becomes its end
+  size_t cnt = 0;
+  struct cutil_hmap_iterator_t it = cutil_hmap_iterator_create(map);
+  for (struct cutil_hmap_tuple_t* t = cutil_hmap_iterator_peek(&it); ok && t; t = cutil_hmap_iterator_next(&it))
+  {
+    // the image is looked up with the plain hash function, even when the map has a keyed one
+    src[cnt].tuple = t;
+    src[cnt].hash = cutil_hmap_key_hash(t->key, map->hashFn);
+    idx[(src[cnt].hash & (buckets - 1)) + 1]++;
+    cnt++;
+  }
+
+  if (ok)
+  {
+    for (size_t b = 0; b < buckets; b++)
+      idx[b + 1] += idx[b];
+
+    // place every tuple at the running start of its bucket, then shift the starts back into place
+    for (size_t i = 0; i < cnt; i++)
+      sorted[idx[src[i].hash & (buckets - 1)]++] = src[i];
+    for (size_t b = buckets; b > 0; b--)
+      idx[b] = idx[b - 1];
+    idx[0] = 0;
+  }
+
+  // the image is written to a unique file next to the target and renamed over it once it is on disk, so that
+  // concurrent writers don't share a temporary file and a crash leaves either the old image or the new one
+  FILE* f = NULL;
+  if (ok)
+  {
+    strcpy(tmp, path);
+    strcat(tmp, ".XXXXXX");
+    int fd = mkstemp(tmp);
+    ok = fd >= 0;
+    if (ok)
+    {
+      (void) fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+      f = fdopen(fd, "wb");
+      ok = f != NULL;
+      if (!ok)
+      {
+        close(fd);
+        remove(tmp);
+      }
+    }
+  }
+
+  if (ok)
+  {
+    ok = hmapfile_emit(f, sorted, idx, cnt, buckets, value_size);
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+      remove(tmp);
+    ok = ok && hmapfile_sync_dir(path);
+  }
+
+  free(src);
+  free(sorted);
+  free(idx);
+  free(tmp);
+
+  return ok;
+}
+
+int cutil_hmapfile_open(struct cutil_hmapfile_t* img, const char* path)
+{
+  if (!img)
+    return 0;
+
+  memset(img, 0, sizeof(*img));
+  img->hashFn = cutil_hash_default;
+  img->compareFn = cutil_compare_lex;
+  img->equalFn = cutil_equal_bytes;
+  if (!path)
+    return 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  struct stat st;
+  void* base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(hmapfile_header))
+    base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return 0;
+
+  // check the header and that the index and the entries lie inside the file
+  const hmapfile_header* h = (const hmapfile_header*) base;
+  size_t bytes = (size_t) st.st_size;
+  int ok = memcmp(h->magic, HMAPFILE_MAGIC, sizeof(h->magic)) == 0
+    && h->bytes == bytes
+    && h->buckets && (h->buckets & (h->buckets - 1)) == 0
+    && h->bucketOff <= bytes && (bytes - h->bucketOff) / sizeof(uint64_t) > h->buckets
+    && h->entryOff <= bytes && (bytes - h->entryOff) / sizeof(hmapfile_entry) >= h->size;
+  if (ok)
+    ok = ((const uint64_t*) ((const char*) base + h->bucketOff))[h->buckets] == h->size;
+
+  if (!ok)
+  {
+    munmap(base, bytes);
+    return 0;
+  }
+
+  img->base = base;
+  img->bytes = bytes;
+  img->size = (size_t) h->size;
+  img->buckets = (size_t) h->buckets;
+  img->valueSize = (size_t) h->valueSize;
+  img->bucketIdx = (const char*) base + h->bucketOff;
+  img->entries = (const char*) base + h->entryOff;
+
+  return 1;
+}
+
+void cutil_hmapfile_close(struct cutil_hmapfile_t* img)
+{
+  if (!img)
+    return;
+
+  if (img->base)
+    munmap(img->base, img->bytes);
+
+  img->base = NULL;
+  img->bytes = 0;
+  img->size = 0;
+  img->buckets = 0;
+  img->valueSize = 0;
+  img->bucketIdx = NULL;
+  img->entries = NULL;
+}
+
+void cutil_hmapfile_set_hashfn(struct cutil_hmapfile_t* img, cutil_hash_func_t hash_fn)
+{
+  if (img && hash_fn)
+    img->hashFn = hash_fn;
+}
+
+void cutil_hmapfile_set_comparefn(struct cutil_hmapfile_t* img, cutil_compare_func_t compare_fn)
+{
+  if (img && compare_fn)
+  {
+    img->compareFn = compare_fn;
+    img->equalFn = NULL;
+  }
+}
+
+void cutil_hmapfile_set_equalfn(struct cutil_hmapfile_t* img, cutil_equal_func_t equal_fn)
+{
+  if (img && equal_fn)
+    img->equalFn = equal_fn;
+}
+
+size_t cutil_hmapfile_size(struct cutil_hmapfile_t* img)
+{
+  return (img) ? img->size : 0;
+}
+
+int cutil_hmapfile_probe_key(struct cutil_hmapfile_t* img, struct cutil_hmap_key_t key)
+{
+  return (cutil_hmapfile_get(img, key) != NULL) ? 1 : 0;
+}
+
+const void* cutil_hmapfile_get(struct cutil_hmapfile_t* img, struct cutil_hmap_key_t key)
+{
+  if (!img || !img->base)
+    return NULL;
+
+  size_t hash = cutil_hmap_key_hash(key, img->hashFn);
+  const uint64_t* idx = (const uint64_t*) img->bucketIdx;
+  const hmapfile_entry* entries = (const hmapfile_entry*) img->entries;
+  size_t b = hash & (img->buckets - 1);
+
+  for (uint64_t i = idx[b]; i < idx[b + 1]; i++)
+  {
+    const hmapfile_entry* e = &entries[i];
+    if (e->hash != hash)
+      continue;
+
+    void* k = (char*) img->base + e->keyOff;
+    if ((img->equalFn) ? img->equalFn(key.key, k, key.len, (size_t) e->keyLen)
+      : img->compareFn(key.key, k, key.len, (size_t) e->keyLen) == CUTIL_EQ)
+      return (const char*) img->base + e->valueOff;
+  }
+
+  return NULL;
+}
@@ -1,10 +1,232 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "cutil.h"
 #include "list.h"
 
+// Nodes allocated together by cutil_list_insert_array(). Its nodes may be spliced into other lists, so every list
+// holding some of them references the block. The nodes are freed with the last of them, the header once the last
+// list referencing it lets go of it
+typedef struct cutil_list_block_t
+{
+  size_t refs;                            /// Number of lists referencing the block
+  size_t live;                            /// Number of nodes not freed yet, 0 once the nodes are released
+  size_t count;                           /// Number of nodes
+  struct cutil_list_node_t* nodes;
+} list_block;
+
+// Blocks a list references, sorted by the address of their nodes so that finding the block of a node is a binary
+// search. Blocks released through another list stay until the list next adds a block or is destroyed
+typedef struct cutil_list_blocks_t
+{
+  size_t count;
+  size_t cap;
+  struct cutil_list_block_t* items[];
+} list_blocks;
+
+// Index of the first block whose nodes start after `addr`
+static size_t list_blocks_upper(list_blocks* blocks, uintptr_t addr)
+{
+  size_t lo = 0, hi = blocks->count;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if ((uintptr_t) blocks->items[mid]->nodes <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Index of the live block holding the node, or the block count if it has its own allocation. Released blocks are
+// skipped, their old address range may have been reused since
+static size_t list_blocks_find(list_blocks* blocks, struct cutil_list_node_t* node)
+{
+  uintptr_t addr = (uintptr_t) node;
+  size_t i = list_blocks_upper(blocks, addr);
+  if (i == 0)
+    return blocks->count;
+
+  list_block* b = blocks->items[i - 1];
+  return (b->live && addr < (uintptr_t) (b->nodes + b->count)) ? i - 1 : blocks->count;
+}
+
+// Drops the reference of the list on its block at `i`, freeing the array once it is empty
+static void list_blocks_drop(struct cutil_list_t* list, size_t i)
+{
+  list_blocks* blocks = list->blocks;
+  list_block* b = blocks->items[i];
+  if (--b->refs == 0)
+    free(b);
+
+  blocks->count--;
+  memmove(blocks->items + i, blocks->items + i + 1, (blocks->count - i) * sizeof(blocks->items[0]));
+  if (!blocks->count)
+  {
+    free(blocks);
+    list->blocks = NULL;
+  }
+}
+
+// Drops the blocks whose nodes were all freed through other lists
+static void list_blocks_prune(struct cutil_list_t* list)
+{
+  list_blocks* blocks = list->blocks;
+  if (!blocks)
+    return;
+
+  size_t kept = 0;
+  for (size_t i = 0; i < blocks->count; i++)
+  {
+    list_block* b = blocks->items[i];
+    if (b->live)
+      blocks->items[kept++] = b;
+    else if (--b->refs == 0)
+      free(b);
+  }
+  blocks->count = kept;
+  if (!kept)
+  {
+    free(blocks);
+    list->blocks = NULL;
+  }
+}
+
+// Makes room for `extra` more blocks, so that adding them can't fail halfway
+static int list_blocks_reserve(struct cutil_list_t* list, size_t extra)
+{
+  list_blocks* blocks = list->blocks;
+  size_t count = (blocks) ? blocks->count : 0;
+  size_t cap = (blocks) ? blocks->cap : 0;
+  if (count + extra <= cap)
+    return 1;
+
+  while (cap < count + extra)
+    cap = (cap) ? cap * 2 : 4;
+  list_blocks* grown = realloc(blocks, sizeof(*grown) + cap * sizeof(grown->items[0]));
+  if (!grown)
+    return 0;
+
+  grown->count = count;
+  grown->cap = cap;
+  list->blocks = grown;
+  return 1;
+}
+
+// References a block from the list, unless it does already. Room must have been reserved
+static void list_blocks_add(struct cutil_list_t* list, list_block* block)
+{
+  list_blocks* blocks = list->blocks;
+  size_t i = list_blocks_upper(blocks, (uintptr_t) block->nodes);
+  if (i > 0 && blocks->items[i - 1] == block)
+    return;
+
+  memmove(blocks->items + i + 1, blocks->items + i, (blocks->count - i) * sizeof(blocks->items[0]));
+  blocks->items[i] = block;
+  blocks->count++;
+  block->refs++;
+}
+
+static struct cutil_list_node_t* list_node_new(void* data)
+{
+  struct cutil_list_node_t* node = malloc(sizeof *node);
+  if (!node)
+    return NULL;
+
+  cutil_list_node_init(node);
+  node->data = data;
+  return node;
+}
+
+// Nodes of a block are given back along with the whole block, once the last of them is freed
+static void list_node_free(struct cutil_list_t* list, struct cutil_list_node_t* node)
+{
+  cutil_list_node_destroy(node);
+
+  list_blocks* blocks = list->blocks;
+  size_t i = (blocks) ? list_blocks_find(blocks, node) : 0;
+  if (!blocks || i == blocks->count)
+  {
+    free(node);
+    return;
+  }
+
+  list_block* b = blocks->items[i];
+  if (--b->live == 0)
+  {
+    free(b->nodes);
+    list_blocks_drop(list, i);
+  }
+}
+
+// Normalizes a position to an index, or returns -1. Insert positions range over one more slot than the elements
+static ptrdiff_t list_index(struct cutil_list_t* list, ptrdiff_t pos, int insert)
+{
+  ptrdiff_t len = (ptrdiff_t) list->length + (insert ? 1 : 0);
+  if (pos == CUTIL_END)
+    return len - 1;
+  if (pos < 0)
+    pos += len;
+  return (pos >= 0 && pos < len) ? pos : -1;
+}
+
+// Finds the node at `idx`, walking from the nearer end. `idx` equal to the length gives NULL
+static struct cutil_list_node_t* list_node_at(struct cutil_list_t* list, size_t idx)
+{
+  struct cutil_list_node_t* node;
+  if (idx < list->length / 2)
+  {
+    node = list->root;
+    while (idx--)
+      node = node->next;
+  }
+  else
+  {
+    node = NULL;
+    for (size_t i = list->length; i > idx; i--)
+      node = (node) ? node->prev : list->end;
+  }
+  return node;
+}
+
+// Links the chain first..last of `count` nodes before `at`, or at the back if `at` is NULL
+static void list_link(struct cutil_list_t* list, struct cutil_list_node_t* at,
+  struct cutil_list_node_t* first, struct cutil_list_node_t* last, size_t count)
+{
+  struct cutil_list_node_t* prev = (at) ? at->prev : list->end;
+  first->prev = prev;
+  last->next = at;
+  if (prev)
+    prev->next = first;
+  else
+    list->root = first;
+  if (at)
+    at->prev = last;
+  else
+    list->end = last;
+  list->length += count;
+}
+
+// Unlinks the chain first..last of `count` nodes, leaving its inner links alone
+static void list_unlink(struct cutil_list_t* list,
+  struct cutil_list_node_t* first, struct cutil_list_node_t* last, size_t count)
+{
+  if (first->prev)
+    first->prev->next = last->next;
+  else
+    list->root = last->next;
+  if (last->next)
+    last->next->prev = first->prev;
+  else
+    list->end = first->prev;
+  first->prev = NULL;
+  last->next = NULL;
+  list->length -= count;
+}
+
 void cutil_list_node_init(struct cutil_list_node_t* node)
 {
   if (!node)
@@ -26,7 +248,7 @@ void cutil_list_node_destroy(struct cutil_list_node_t* node)
 
 void** cutil_list_node_data(struct cutil_list_node_t* node)
 {
-  return (!node) ? NULL : node->data;
+  return (!node) ? NULL : &node->data;
 }
 
 void cutil_list_init(struct cutil_list_t* list)
@@ -37,6 +259,7 @@ void cutil_list_init(struct cutil_list_t* list)
   list->root = NULL;
   list->end = NULL;
   list->length = 0;
+  list->blocks = NULL;
 }
 
 void cutil_list_destroy(struct cutil_list_t* list, cutil_list_node_destructor_t destructor)
@@ -50,11 +273,14 @@ void cutil_list_destroy(struct cutil_list_t* list, cutil_list_node_destructor_t
     list->root = list->root->next;
     if (destructor)
       destructor(*cutil_list_node_data(tmp));
-    cutil_list_node_destroy(tmp);
-    free(tmp);
+    list_node_free(list, tmp);
     list->length--;
   }
   list->end = NULL;
+
+  // what is left are blocks whose nodes were freed through other lists
+  while (list->blocks)
+    list_blocks_drop(list, list->blocks->count - 1);
 }
 
 size_t cutil_list_size(struct cutil_list_t* list)
@@ -64,124 +290,44 @@ size_t cutil_list_size(struct cutil_list_t* list)
 
 struct cutil_list_node_t* cutil_list_get(struct cutil_list_t* list, ptrdiff_t pos)
 {
-  ptrdiff_t abs = (pos < 0) ? (-pos) - 1 : pos;
   if (!list || !list->root)
     return NULL;
-  
-  struct cutil_list_node_t* ret = NULL;
-  if (pos == CUTIL_BEG || pos == -(list->length))
-    return list->root;
-  if (pos == CUTIL_END || pos == list->length - 1)
-    return list->end;
-  if (abs >= list->length)
-    return NULL;
-  
-  if (pos < 0)
-  {
-    ret = list->end;
-    ptrdiff_t ctr = 0;
-    while (++ctr < abs && ret)  // iterate to the correct position
-      ret = ret->prev;
-    
-    return ret;
-  }
-  else
-  {
-    ret = list->root;
-    ptrdiff_t ctr = 0;
-    while (++ctr < abs && ret)  // iterate to the correct position
-      ret = ret->next;
-    
-    return ret;
-  }
+
+  ptrdiff_t idx = list_index(list, pos, 0);
+  return (idx < 0) ? NULL : list_node_at(list, (size_t) idx);
 }
 
 int cutil_list_insert(struct cutil_list_t* list, void* data, ptrdiff_t pos)
 {
-  ptrdiff_t abs = (pos < 0) ? -pos - 1 : pos;
-  if (!list || !list->root)
+  if (!list)
     return 0;
-  
-  if (pos == CUTIL_BEG || pos == -(list->length + 1))
-    return cutil_list_insert_front(list, data);
-  
-  if (pos == CUTIL_END || pos == list->length || pos == -1)
-    return cutil_list_insert_back(list, data);
 
-  if (abs > list->length)
+  ptrdiff_t idx = list_index(list, pos, 1);
+  if (idx < 0)
     return 0;
 
-  struct cutil_list_node_t* add = malloc(sizeof *add);
+  struct cutil_list_node_t* add = list_node_new(data);
   if (!add)
     return 0;
 
-  cutil_list_node_init(add);
-  add->data = data;
-  
-  if (pos < 0)
-  {
-    struct cutil_list_node_t* it = list->end;
-    ptrdiff_t ctr = 0;
-    while (++ctr < abs && it)
-      it = it->prev;
-
-    add->next = it->next;
-    it->next = add;
-    add->prev = it;
-    add->next->prev = add;
-  }
-  else
-  {
-    struct cutil_list_node_t* it = list->root;
-    ptrdiff_t ctr = 0;
-
-    // iterate to position before add location
-    while (++ctr < abs && it)
-      it = it->next;
-    
-    add->next = it->next;
-    it->next = add;
-    add->prev = it;
-    add->next->prev = add;
-  }
-  list->length++;
-
+  list_link(list, list_node_at(list, (size_t) idx), add, add, 1);
   return 1;
 }
 
 void* cutil_list_remove(struct cutil_list_t* list, ptrdiff_t pos)
 {
-  ptrdiff_t abs = (pos < 0) ? (-pos) - 1 : pos;
   if (!list || !list->root)
     return NULL;
 
-  if (!(abs < list->length || pos == CUTIL_END))
+  ptrdiff_t idx = list_index(list, pos, 0);
+  if (idx < 0)
     return NULL;
 
-  struct cutil_list_node_t* tmp = list->root;
-  ptrdiff_t ctr = 0;
-
-  while (ctr++ < abs && tmp)
-    tmp = (pos < 0) ? tmp->prev : tmp->next;
-  
-  if (!tmp)
-    return NULL;
+  struct cutil_list_node_t* tmp = list_node_at(list, (size_t) idx);
+  list_unlink(list, tmp, tmp, 1);
 
-  // remove node tmp
-  if (tmp->next)
-    tmp->next->prev = tmp->prev;
-  else
-    list->end = tmp->next;
-  
-  if (tmp->prev)
-    tmp->prev->next = tmp->prev;
-  else
-    list->root = tmp->prev;
-  
-  list->length--;
   void* data = tmp->data;
-  cutil_list_node_destroy(tmp);
-  free(tmp);
+  list_node_free(list, tmp);
   return data;
 }
 
@@ -195,24 +341,11 @@ int cutil_list_insert_back(struct cutil_list_t* list, void* data)
   if (!list)
     return 0;
   
-  struct cutil_list_node_t* add = malloc(sizeof *add);
+  struct cutil_list_node_t* add = list_node_new(data);
   if (!add)
     return 0;
-  cutil_list_node_init(add);
-  add->data = data;
-  list->length++;
-
-  if (!list->end)
-  {
-    list->root = add;
-    list->end = add;
-    return 1;
-  }
-
-  add->prev = list->end;
-  list->end->next = add;
-  list->end = add;
 
+  list_link(list, NULL, add, add, 1);
   return 1;
 }
 
@@ -222,38 +355,28 @@ void* cutil_list_remove_back(struct cutil_list_t* list)
     return NULL;
   
   struct cutil_list_node_t* del = list->end;
-  void* data = list->end->data;
-
-  if (list->end == list->root)
-    list->root = (list->end = NULL);
-  list->length--;
-  list->end = del->prev;
-  if (list->end)
-    list->end->next = NULL;
-  
-  cutil_list_node_destroy(del);
-  free(del);
+  void* data = del->data;
+
+  list_unlink(list, del, del, 1);
+  list_node_free(list, del);
   return data;
 }
 
+struct cutil_list_node_t* cutil_list_front(struct cutil_list_t* list)
+{
+  return (!list) ? NULL : list->root;
+}
+
 int cutil_list_insert_front(struct cutil_list_t* list, void* data)
 {
   if (!list)
     return 0;
   
-  struct cutil_list_node_t* add = malloc(sizeof *add);
+  struct cutil_list_node_t* add = list_node_new(data);
   if (!add)
     return 0;
 
-  cutil_list_node_init(add);
-  add->data = data;
-  add->next = list->root;
-  if (list->root)
-    list->root->prev = add;
-  list->root = add;
-
-  list->length++;
-
+  list_link(list, list->root, add, add, 1);
   return 1;
 }
 
@@ -265,16 +388,120 @@ void* cutil_list_remove_front(struct cutil_list_t* list)
   struct cutil_list_node_t* del = list->root;
   void* data = del->data;
 
-  list->root = del->next;
-  if (list->root)
+  list_unlink(list, del, del, 1);
+  list_node_free(list, del);
+  return data;
+}
+
+int cutil_list_insert_array(struct cutil_list_t* list, void* const* data, size_t count, ptrdiff_t pos)
+{
+  if (!list || (!data && count))
+    return 0;
+
+  ptrdiff_t idx = list_index(list, pos, 1);
+  if (idx < 0)
+    return 0;
+  if (!count)
+    return 1;
+  if (count > SIZE_MAX / sizeof(struct cutil_list_node_t))
+    return 0;
+
+  list_blocks_prune(list);
+  if (!list_blocks_reserve(list, 1))
+    return 0;
+
+  list_block* block = malloc(sizeof *block);
+  struct cutil_list_node_t* nodes = malloc(count * sizeof *nodes);
+  if (!block || !nodes)
   {
-    list->root->prev = NULL;
-    list->end = list->root;
+    free(block);
+    free(nodes);
+    return 0;
   }
 
-  cutil_list_node_destroy(del);
-  free(del);
-  return data;
+  // the nodes are chained in array order, so walking the batch reads the block front to back
+  block->refs = 0;
+  block->live = count;
+  block->count = count;
+  block->nodes = nodes;
+  for (size_t i = 0; i < count; i++)
+  {
+    nodes[i].data = data[i];
+    nodes[i].prev = (i > 0) ? &nodes[i - 1] : NULL;
+    nodes[i].next = (i + 1 < count) ? &nodes[i + 1] : NULL;
+  }
+  list_blocks_add(list, block);
+
+  list_link(list, list_node_at(list, (size_t) idx), &block->nodes[0], &block->nodes[count - 1], count);
+  return 1;
+}
+
+int cutil_list_splice(struct cutil_list_t* list, struct cutil_list_node_t* at, struct cutil_list_t* other,
+  struct cutil_list_node_t* first, struct cutil_list_node_t* last, size_t count)
+{
+  if (!list || !other || !first || !last)
+    return 0;
+
+  if (!count)
+  {
+    for (struct cutil_list_node_t* it = first; it != last; it = it->next)
+    {
+      if (!it)
+        return 0;
+      count++;
+    }
+    count++;
+  }
+
+  // list takes a reference on the blocks of the moved nodes. Nodes of a batch mostly stay next to each other, so
+  // the block of the previous node is tried before searching
+  list_blocks* from = other->blocks;
+  if (from && list != other)
+  {
+    list_blocks_prune(list);
+    if (!list_blocks_reserve(list, from->count))
+      return 0;
+
+    list_block* b = NULL;
+    for (struct cutil_list_node_t* it = first; it != last->next; it = it->next)
+    {
+      if (b && it >= b->nodes && it < b->nodes + b->count)
+        continue;
+
+      size_t i = list_blocks_find(from, it);
+      b = (i < from->count) ? from->items[i] : NULL;
+      if (b)
+        list_blocks_add(list, b);
+    }
+  }
+
+  list_unlink(other, first, last, count);
+  list_link(list, at, first, last, count);
+  return 1;
+}
+
+int cutil_list_split_at(struct cutil_list_t* list, ptrdiff_t pos, struct cutil_list_t* tail)
+{
+  if (!list || !tail || list == tail)
+    return 0;
+
+  ptrdiff_t idx = list_index(list, pos, 1);
+  if (idx < 0)
+    return 0;
+  if ((size_t) idx == list->length)
+    return 1;
+
+  return cutil_list_splice(tail, NULL, list, list_node_at(list, (size_t) idx), list->end, list->length - (size_t) idx);
+}
+
+int cutil_list_concat(struct cutil_list_t* list, struct cutil_list_t* other)
+{
+  if (!list || !other || list == other)
+    return 0;
+  if (!other->root)
+    return 1;
+
+  return cutil_list_splice(list, NULL, other, other->root, other->end, other->length);
 }
 
 void cutil_list_iterator_init(struct cutil_list_iterator_t* iterator, struct cutil_list_t* list, struct cutil_list_node_t* node)
@@ -0,0 +1,141 @@
+#include "pool.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// alignment of every object handed out by the pool
+#define POOL_ALIGN (sizeof(max_align_t) < 16 ? sizeof(max_align_t) : 16)
+
+typedef struct pool_chunk
+{
+  struct pool_chunk* next;
+  size_t objs;        // number of objects, since chunkObjs may change between chunks
+} pool_chunk;
+
+static size_t pool_round(size_t n)
+{
+  return (n + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+}
+
+// keep whatever is left of the current chunk or region on the free list before switching to a new one
+static void pool_retire_cursor(struct cutil_pool_t* pool)
+{
+  while (pool->cursor && pool->cursor + pool->objSize <= pool->limit)
+  {
+    cutil_pool_free(pool, pool->cursor);
+    pool->cursor += pool->objSize;
+  }
+  pool->cursor = NULL;
+  pool->limit = NULL;
+}
+
+void cutil_pool_init(struct cutil_pool_t* pool, size_t obj_size, size_t chunk_objs)
+{
+  if (!pool)
+    return;
+
+  pool->chunks = NULL;
+  pool->freeList = NULL;
+  pool->cursor = NULL;
+  pool->limit = NULL;
+  pool->objSize = pool_round(obj_size < sizeof(void*) ? sizeof(void*) : obj_size);
+  pool->chunkObjs = chunk_objs;
+}
+
+void cutil_pool_set_chunk_objs(struct cutil_pool_t* pool, size_t chunk_objs)
+{
+  if (pool)
+    pool->chunkObjs = chunk_objs;
+}
+
+void cutil_pool_destroy(struct cutil_pool_t* pool)
+{
+  if (!pool)
+    return;
+
+  pool_chunk* c = (pool_chunk*) pool->chunks;
+  while (c)
+  {
+    pool_chunk* next = c->next;
+    free(c);
+    c = next;
+  }
+
+  pool->chunks = NULL;
+  pool->freeList = NULL;
+  pool->cursor = NULL;
+  pool->limit = NULL;
+}
+
+size_t cutil_pool_add_region(struct cutil_pool_t* pool, void* region, size_t bytes)
+{
+  if (!pool || !region)
+    return 0;
+
+  char* start = (char*) pool_round((uintptr_t) region);
+  char* end = (char*) region + bytes;
+  if (start + pool->objSize > end)
+    return 0;
+
+  pool_retire_cursor(pool);
+  pool->cursor = start;
+  pool->limit = end;
+
+  return (size_t) (end - start) / pool->objSize;
+}
+
+void* cutil_pool_alloc(struct cutil_pool_t* pool)
+{
+  if (!pool)
+    return NULL;
+
+  if (pool->freeList)
+  {
+    void* obj = pool->freeList;
+    pool->freeList = *(void**) obj;
+    return obj;
+  }
+
+  if (!pool->cursor || pool->cursor + pool->objSize > pool->limit)
+  {
+    if (!pool->chunkObjs)
+      return NULL;
+
+    size_t header = pool_round(sizeof(pool_chunk));
+    pool_chunk* c = malloc(header + pool->objSize * pool->chunkObjs);
+    if (!c)
+      return NULL;
+
+    pool_retire_cursor(pool);
+    c->next = (pool_chunk*) pool->chunks;
+    c->objs = pool->chunkObjs;
+    pool->chunks = c;
+    pool->cursor = (char*) c + header;
+    pool->limit = pool->cursor + pool->objSize * pool->chunkObjs;
+  }
+
+  void* obj = pool->cursor;
+  pool->cursor += pool->objSize;
+  return obj;
+}
+
+void cutil_pool_free(struct cutil_pool_t* pool, void* obj)
+{
+  if (!pool || !obj)
+    return;
+
+  *(void**) obj = pool->freeList;
+  pool->freeList = obj;
+}
+
+size_t cutil_pool_heap_bytes(struct cutil_pool_t* pool)
+{
+  if (!pool)
+    return 0;
+
+  size_t bytes = 0;
+  for (pool_chunk* c = (pool_chunk*) pool->chunks; c; c = c->next)
+    bytes += pool_round(sizeof(pool_chunk)) + pool->objSize * c->objs;
+
+  return bytes;
+}
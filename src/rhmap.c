@@ -0,0 +1,333 @@
+#include "cutil.h"
+#include "rhmap.h"
+#include "epoch.h"
+#include "hash.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef struct rhmap_node
+{
+  struct cutil_hmap_key_t key;
+  void* data;
+  size_t hash;
+  _Atomic(struct rhmap_node*) next;
+} rhmap_node;
+
+typedef struct rhmap_table
+{
+  size_t buckets;
+  _Atomic(rhmap_node*) heads[];
+} rhmap_table;
+
+typedef struct rhmap_shared
+{
+  _Atomic(rhmap_table*) table;
+  atomic_size_t size;
+  pthread_mutex_t lock;     // serializes the writers
+} rhmap_shared;
+
+#define RHMAP_LOAD_FACTOR 0.75f
+
+static rhmap_table* rhmap_table_alloc(size_t buckets)
+{
+  rhmap_table* t = malloc(sizeof(*t) + sizeof(t->heads[0]) * buckets);
+  if (!t)
+    return NULL;
+
+  t->buckets = buckets;
+  for (size_t i = 0; i < buckets; i++)
+    atomic_init(&t->heads[i], NULL);
+  return t;
+}
+
+// Frees a table and the nodes chained in it. The keys and values live on in the table that replaced it
+static void rhmap_release_table(void* ctx, void* ptr)
+{
+  (void) ctx;
+  rhmap_table* t = (rhmap_table*) ptr;
+  for (size_t i = 0; i < t->buckets; i++)
+  {
+    rhmap_node* n = atomic_load_explicit(&t->heads[i], memory_order_relaxed);
+    while (n)
+    {
+      rhmap_node* next = atomic_load_explicit(&n->next, memory_order_relaxed);
+      free(n);
+      n = next;
+    }
+  }
+  free(t);
+}
+
+// Runs the destructor of an entry removed from the map and frees its node
+static void rhmap_release_node(void* ctx, void* ptr)
+{
+  struct cutil_rhmap_t* map = (struct cutil_rhmap_t*) ctx;
+  rhmap_node* n = (rhmap_node*) ptr;
+  if (map->destuctor)
+  {
+    struct cutil_hmap_tuple_t rm = cutil_hmap_make_tuple(n->key, n->data);
+    map->destuctor(&rm);
+  }
+  free(n);
+}
+
+static inline int rhmap_key_equal(struct cutil_rhmap_t* map, struct cutil_hmap_key_t a, struct cutil_hmap_key_t b)
+{
+  if (map->equalFn)
+    return map->equalFn(a.key, b.key, a.len, b.len);
+  return map->compareFn(a.key, b.key, a.len, b.len) == CUTIL_EQ;
+}
+
+// Returns the link pointing at the node of the key in the given table, or NULL. The node is stored in `node`:
+// readers must not load it from the link again, since a writer may have relinked it to the next node meanwhile
+static _Atomic(rhmap_node*)* rhmap_find(struct cutil_rhmap_t* map, rhmap_table* t, struct cutil_hmap_key_t key, size_t hash, rhmap_node** node)
+{
+  _Atomic(rhmap_node*)* link = &t->heads[hash % t->buckets];
+  rhmap_node* n;
+  while ((n = atomic_load_explicit(link, memory_order_acquire)))
+  {
+    if (n->hash == hash && rhmap_key_equal(map, key, n->key))
+    {
+      *node = n;
+      return link;
+    }
+    link = &n->next;
+  }
+
+  return NULL;
+}
+
+// Copies every entry into a new table, publishes it and retires the old one. Must hold the writer lock
+static int rhmap_resize(struct cutil_rhmap_t* map, size_t buckets)
+{
+  rhmap_shared* sh = (rhmap_shared*) map->shared;
+  rhmap_table* old = atomic_load_explicit(&sh->table, memory_order_relaxed);
+  rhmap_table* repl = rhmap_table_alloc(buckets);
+  if (!repl)
+    return 0;
+
+  // readers may be walking the old chains, so the nodes are copied rather than relinked
+  for (size_t i = 0; i < old->buckets; i++)
+  {
+    for (rhmap_node* n = atomic_load_explicit(&old->heads[i], memory_order_relaxed); n;
+         n = atomic_load_explicit(&n->next, memory_order_relaxed))
+    {
+      rhmap_node* cp = malloc(sizeof *cp);
+      if (!cp)
+      {
+        rhmap_release_table(NULL, repl);
+        return 0;
+      }
+
+      cp->key = n->key;
+      cp->data = n->data;
+      cp->hash = n->hash;
+      _Atomic(rhmap_node*)* head = &repl->heads[n->hash % buckets];
+      atomic_init(&cp->next, atomic_load_explicit(head, memory_order_relaxed));
+      atomic_store_explicit(head, cp, memory_order_relaxed);
+    }
+  }
+
+  atomic_store_explicit(&sh->table, repl, memory_order_release);
+  cutil_epoch_retire(&map->epoch, old, rhmap_release_table, NULL);
+
+  return 1;
+}
+
+int cutil_rhmap_init(struct cutil_rhmap_t* map)
+{
+  if (!map)
+    return 0;
+
+  map->shared = NULL;
+  map->minBuckets = 16;
+  map->hashFn = cutil_hash_default;
+  map->compareFn = cutil_compare_lex;
+  map->equalFn = cutil_equal_bytes;
+  map->destuctor = NULL;
+
+  rhmap_shared* sh = malloc(sizeof *sh);
+  rhmap_table* t = rhmap_table_alloc(map->minBuckets);
+  if (!sh || !t || !cutil_epoch_init(&map->epoch))
+  {
+    free(sh);
+    free(t);
+    return 0;
+  }
+
+  atomic_init(&sh->table, t);
+  atomic_init(&sh->size, 0);
+  pthread_mutex_init(&sh->lock, NULL);
+  map->shared = sh;
+
+  return 1;
+}
+
+void cutil_rhmap_destroy(struct cutil_rhmap_t* map)
+{
+  if (!map || !map->shared)
+    return;
+
+  // pending removals still need their destructor
+  cutil_epoch_destroy(&map->epoch);
+
+  rhmap_shared* sh = (rhmap_shared*) map->shared;
+  rhmap_table* t = atomic_load(&sh->table);
+  for (size_t i = 0; i < t->buckets; i++)
+  {
+    rhmap_node* n = atomic_load_explicit(&t->heads[i], memory_order_relaxed);
+    while (n)
+    {
+      rhmap_node* next = atomic_load_explicit(&n->next, memory_order_relaxed);
+      rhmap_release_node(map, n);
+      n = next;
+    }
+  }
+  free(t);
+
+  pthread_mutex_destroy(&sh->lock);
+  free(sh);
+
+  map->shared = NULL;
+  map->minBuckets = 0;
+  map->hashFn = NULL;
+  map->compareFn = NULL;
+  map->equalFn = NULL;
+  map->destuctor = NULL;
+}
+
+void cutil_rhmap_set_destructor(struct cutil_rhmap_t* map, cutil_destructor_func_t destructor)
+{
+  if (map)
+    map->destuctor = destructor;
+}
+
+void cutil_rhmap_set_hashfn(struct cutil_rhmap_t* map, cutil_hash_func_t hash_fn)
+{
+  if (map && hash_fn && cutil_rhmap_size(map) == 0)
+    map->hashFn = hash_fn;
+}
+
+void cutil_rhmap_set_equalfn(struct cutil_rhmap_t* map, cutil_equal_func_t equal_fn)
+{
+  if (map && equal_fn && cutil_rhmap_size(map) == 0)
+    map->equalFn = equal_fn;
+}
+
+void cutil_rhmap_set_comparefn(struct cutil_rhmap_t* map, cutil_compare_func_t compare_fn)
+{
+  if (map && compare_fn && cutil_rhmap_size(map) == 0)
+  {
+    map->compareFn = compare_fn;
+    map->equalFn = NULL;
+  }
+}
+
+size_t cutil_rhmap_size(struct cutil_rhmap_t* map)
+{
+  if (!map || !map->shared)
+    return 0;
+
+  return atomic_load_explicit(&((rhmap_shared*) map->shared)->size, memory_order_relaxed);
+}
+
+int cutil_rhmap_probe_key(struct cutil_rhmap_t* map, struct cutil_hmap_key_t key)
+{
+  return cutil_rhmap_get(map, key, NULL);
+}
+
+int cutil_rhmap_get(struct cutil_rhmap_t* map, struct cutil_hmap_key_t key, void** value)
+{
+  if (!map || !map->shared)
+    return 0;
+
+  rhmap_shared* sh = (rhmap_shared*) map->shared;
+  size_t hash = cutil_hmap_key_hash(key, map->hashFn);
+
+  cutil_epoch_enter(&map->epoch);
+  rhmap_table* t = atomic_load_explicit(&sh->table, memory_order_acquire);
+  rhmap_node* n = NULL;
+  _Atomic(rhmap_node*)* link = rhmap_find(map, t, key, hash, &n);
+  if (link && value)
+    *value = n->data;
+  cutil_epoch_exit(&map->epoch);
+
+  return (link) ? 1 : 0;
+}
+
+int cutil_rhmap_insert(struct cutil_rhmap_t* map, struct cutil_hmap_tuple_t t)
+{
+  if (!map || !map->shared)
+    return 0;
+
+  rhmap_shared* sh = (rhmap_shared*) map->shared;
+  size_t hash = cutil_hmap_key_hash(t.key, map->hashFn);
+
+  pthread_mutex_lock(&sh->lock);
+  rhmap_table* table = atomic_load_explicit(&sh->table, memory_order_relaxed);
+
+  // Element already exists. Don't insert
+  rhmap_node* existing;
+  if (rhmap_find(map, table, t.key, hash, &existing))
+  {
+    pthread_mutex_unlock(&sh->lock);
+    return 0;
+  }
+
+  rhmap_node* ins = malloc(sizeof *ins);
+  if (!ins)
+  {
+    pthread_mutex_unlock(&sh->lock);
+    return 0;
+  }
+
+  size_t size = atomic_load_explicit(&sh->size, memory_order_relaxed) + 1;
+  if ((float) size > (float) table->buckets * RHMAP_LOAD_FACTOR && rhmap_resize(map, table->buckets * 2))
+    table = atomic_load_explicit(&sh->table, memory_order_relaxed);
+
+  // the node is complete before the release store makes it reachable
+  ins->key = t.key;
+  ins->data = t.value;
+  ins->hash = hash;
+  _Atomic(rhmap_node*)* head = &table->heads[hash % table->buckets];
+  atomic_init(&ins->next, atomic_load_explicit(head, memory_order_relaxed));
+  atomic_store_explicit(head, ins, memory_order_release);
+  atomic_store_explicit(&sh->size, size, memory_order_relaxed);
+
+  pthread_mutex_unlock(&sh->lock);
+  return 1;
+}
+
+int cutil_rhmap_del(struct cutil_rhmap_t* map, struct cutil_hmap_key_t key)
+{
+  if (!map || !map->shared)
+    return 0;
+
+  rhmap_shared* sh = (rhmap_shared*) map->shared;
+  size_t hash = cutil_hmap_key_hash(key, map->hashFn);
+
+  pthread_mutex_lock(&sh->lock);
+  rhmap_table* table = atomic_load_explicit(&sh->table, memory_order_relaxed);
+  rhmap_node* n;
+  _Atomic(rhmap_node*)* link = rhmap_find(map, table, key, hash, &n);
+  if (!link)
+  {
+    pthread_mutex_unlock(&sh->lock);
+    return 0;
+  }
+
+  // readers already on the node still see a valid next link
+  atomic_store_explicit(link, atomic_load_explicit(&n->next, memory_order_relaxed), memory_order_release);
+  size_t size = atomic_load_explicit(&sh->size, memory_order_relaxed) - 1;
+  atomic_store_explicit(&sh->size, size, memory_order_relaxed);
+  cutil_epoch_retire(&map->epoch, n, rhmap_release_node, map);
+
+  // shrink with some hysteresis, so that a workload hovering around a threshold doesn't copy the table every time
+  if (table->buckets / 2 >= map->minBuckets && (float) size < (float) table->buckets * RHMAP_LOAD_FACTOR / 4.f)
+    rhmap_resize(map, table->buckets / 2);
+
+  pthread_mutex_unlock(&sh->lock);
+  return 1;
+}
@@ -0,0 +1,301 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cutil.h"
+#include "skiplist.h"
+
+typedef struct cutil_skiplist_node_t
+{
+  void* data;
+  struct cutil_skiplist_node_t* prev;     /// Previous node on level 0, NULL for the first
+  size_t level;                           /// Number of links
+  struct cutil_skiplist_link_t links[];
+} skiplist_node;
+
+// Draws the level of a new node: every level keeps a quarter of the nodes of the one below
+static size_t skiplist_random_level(struct cutil_skiplist_t* list)
+{
+  // xorshift64
+  uint64_t x = list->rng;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  list->rng = x;
+
+  size_t level = 1;
+  while ((x & 3) == 0 && level < CUTIL_SKIPLIST_MAX_LEVEL)
+  {
+    level++;
+    x >>= 2;
+  }
+  return level;
+}
+
+// Normalizes a position to an index, or returns -1. Insert positions range over one more slot than the elements
+static ptrdiff_t skiplist_index(struct cutil_skiplist_t* list, ptrdiff_t pos, int insert)
+{
+  ptrdiff_t len = (ptrdiff_t) list->length + (insert ? 1 : 0);
+  if (pos == CUTIL_END)
+    return len - 1;
+  if (pos < 0)
+    pos += len;
+  return (pos >= 0 && pos < len) ? pos : -1;
+}
+
+// Walks down to the links which precede position `rank` on every level, counting the head as position 0 and the
+// elements from 1. `update[i]` receives the links of the last node before `rank` on level i, and `ranks[i]` its position
+static struct cutil_skiplist_link_t* skiplist_seek(struct cutil_skiplist_t* list, size_t rank,
+  struct cutil_skiplist_link_t** update, size_t* ranks)
+{
+  struct cutil_skiplist_link_t* links = list->head;
+  size_t traversed = 0;
+  for (size_t i = CUTIL_SKIPLIST_MAX_LEVEL; i-- > 0;)
+  {
+    // levels above the ones in use only hold the head, so there is nothing to walk
+    while (i < list->level && links[i].next && traversed + links[i].width < rank)
+    {
+      traversed += links[i].width;
+      links = links[i].next->links;
+    }
+    if (update)
+    {
+      update[i] = links;
+      ranks[i] = traversed;
+    }
+  }
+  return links;
+}
+
+static skiplist_node* skiplist_node_at(struct cutil_skiplist_t* list, size_t idx)
+{
+  return skiplist_seek(list, idx + 1, NULL, NULL)[0].next;
+}
+
+void cutil_skiplist_init(struct cutil_skiplist_t* list)
+{
+  if (!list)
+    return;
+
+  for (size_t i = 0; i < CUTIL_SKIPLIST_MAX_LEVEL; i++)
+  {
+    list->head[i].next = NULL;
+    list->head[i].width = 1;
+  }
+  list->end = NULL;
+  list->length = 0;
+  list->level = 1;
+  list->rng = 0x9E3779B97F4A7C15ull ^ (uint64_t) (uintptr_t) list;
+  if (!list->rng)
+    list->rng = 1;
+}
+
+void cutil_skiplist_destroy(struct cutil_skiplist_t* list, cutil_list_node_destructor_t destructor)
+{
+  if (!list)
+    return;
+
+  skiplist_node* n = list->head[0].next;
+  while (n)
+  {
+    skiplist_node* next = n->links[0].next;
+    if (destructor)
+      destructor(n->data);
+    free(n);
+    n = next;
+  }
+
+  for (size_t i = 0; i < CUTIL_SKIPLIST_MAX_LEVEL; i++)
+  {
+    list->head[i].next = NULL;
+    list->head[i].width = 1;
+  }
+  list->end = NULL;
+  list->length = 0;
+  list->level = 1;
+}
+
+size_t cutil_skiplist_size(struct cutil_skiplist_t* list)
+{
+  return (!list) ? 0 : list->length;
+}
+
+void** cutil_skiplist_get(struct cutil_skiplist_t* list, ptrdiff_t pos)
+{
+  if (!list || !list->length)
+    return NULL;
+
+  ptrdiff_t idx = skiplist_index(list, pos, 0);
+  if (idx < 0)
+    return NULL;
+
+  skiplist_node* n = ((size_t) idx == list->length - 1) ? list->end : skiplist_node_at(list, (size_t) idx);
+  return &n->data;
+}
+
+int cutil_skiplist_insert(struct cutil_skiplist_t* list, void* data, ptrdiff_t pos)
+{
+  if (!list)
+    return 0;
+
+  ptrdiff_t idx = skiplist_index(list, pos, 1);
+  if (idx < 0)
+    return 0;
+
+  size_t level = skiplist_random_level(list);
+  skiplist_node* add = malloc(sizeof(*add) + level * sizeof(struct cutil_skiplist_link_t));
+  if (!add)
+    return 0;
+
+  add->data = data;
+  add->level = level;
+  if (level > list->level)
+    list->level = level;
+
+  // the new node takes position idx + 1, so it goes after everything before that
+  struct cutil_skiplist_link_t* update[CUTIL_SKIPLIST_MAX_LEVEL];
+  size_t ranks[CUTIL_SKIPLIST_MAX_LEVEL];
+  skiplist_seek(list, (size_t) idx + 1, update, ranks);
+
+  size_t rank = (size_t) idx + 1;
+  for (size_t i = 0; i < CUTIL_SKIPLIST_MAX_LEVEL; i++)
+  {
+    if (i < level)
+    {
+      // split the link around the new node. Everything past it moves up one position
+      add->links[i].next = update[i][i].next;
+      add->links[i].width = ranks[i] + update[i][i].width - rank + 1;
+      update[i][i].next = add;
+      update[i][i].width = rank - ranks[i];
+    }
+    else
+    {
+      update[i][i].width++;
+    }
+  }
+
+  add->prev = (update[0] == list->head) ? NULL : cutil_container_of(update[0], skiplist_node, links);
+  if (add->links[0].next)
+    add->links[0].next->prev = add;
+  else
+    list->end = add;
+
+  list->length++;
+  return 1;
+}
+
+void* cutil_skiplist_remove(struct cutil_skiplist_t* list, ptrdiff_t pos)
+{
+  if (!list || !list->length)
+    return NULL;
+
+  ptrdiff_t idx = skiplist_index(list, pos, 0);
+  if (idx < 0)
+    return NULL;
+
+  struct cutil_skiplist_link_t* update[CUTIL_SKIPLIST_MAX_LEVEL];
+  size_t ranks[CUTIL_SKIPLIST_MAX_LEVEL];
+  skiplist_node* del = skiplist_seek(list, (size_t) idx + 1, update, ranks)[0].next;
+
+  // links over the node absorb its links, the ones above it get one shorter
+  for (size_t i = 0; i < CUTIL_SKIPLIST_MAX_LEVEL; i++)
+  {
+    if (i < del->level)
+    {
+      update[i][i].next = del->links[i].next;
+      update[i][i].width += del->links[i].width - 1;
+    }
+    else
+    {
+      update[i][i].width--;
+    }
+  }
+
+  if (del->links[0].next)
+    del->links[0].next->prev = del->prev;
+  else
+    list->end = del->prev;
+
+  while (list->level > 1 && !list->head[list->level - 1].next)
+    list->level--;
+
+  list->length--;
+  void* data = del->data;
+  free(del);
+  return data;
+}
+
+void** cutil_skiplist_back(struct cutil_skiplist_t* list)
+{
+  return (!list || !list->end) ? NULL : &list->end->data;
+}
+
+int cutil_skiplist_insert_back(struct cutil_skiplist_t* list, void* data)
+{
+  return (list) ? cutil_skiplist_insert(list, data, (ptrdiff_t) list->length) : 0;
+}
+
+void* cutil_skiplist_remove_back(struct cutil_skiplist_t* list)
+{
+  return (list && list->length) ? cutil_skiplist_remove(list, (ptrdiff_t) list->length - 1) : NULL;
+}
+
+void** cutil_skiplist_front(struct cutil_skiplist_t* list)
+{
+  return (!list || !list->head[0].next) ? NULL : &list->head[0].next->data;
+}
+
+int cutil_skiplist_insert_front(struct cutil_skiplist_t* list, void* data)
+{
+  return cutil_skiplist_insert(list, data, 0);
+}
+
+void* cutil_skiplist_remove_front(struct cutil_skiplist_t* list)
+{
+  return cutil_skiplist_remove(list, 0);
+}
+
+void cutil_skiplist_iterator_init(struct cutil_skiplist_iterator_t* iterator, struct cutil_skiplist_t* list, ptrdiff_t pos)
+{
+  if (!iterator || !list)
+    return;
+
+  iterator->list = list;
+  iterator->node = NULL;
+
+  ptrdiff_t idx = (list->length) ? skiplist_index(list, pos, 0) : -1;
+  if (idx >= 0)
+    iterator->node = ((size_t) idx == list->length - 1) ? list->end : skiplist_node_at(list, (size_t) idx);
+}
+
+void cutil_skiplist_iterator_destroy(struct cutil_skiplist_iterator_t* iterator)
+{
+  if (!iterator)
+    return;
+
+  iterator->list = NULL;
+  iterator->node = NULL;
+}
+
+void** cutil_skiplist_iterator_get(struct cutil_skiplist_iterator_t* iterator)
+{
+  return (iterator && iterator->list && iterator->node) ? &iterator->node->data : NULL;
+}
+
+void** cutil_skiplist_iterator_next(struct cutil_skiplist_iterator_t* iterator)
+{
+  if (!iterator || !iterator->list || !iterator->node)
+    return NULL;
+
+  iterator->node = iterator->node->links[0].next;
+  return cutil_skiplist_iterator_get(iterator);
+}
+
+void** cutil_skiplist_iterator_back(struct cutil_skiplist_iterator_t* iterator)
+{
+  if (!iterator || !iterator->list || !iterator->node)
+    return NULL;
+
+  iterator->node = iterator->node->prev;
+  return cutil_skiplist_iterator_get(iterator);
+}
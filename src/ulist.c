@@ -0,0 +1,401 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cutil.h"
+#include "ulist.h"
+
+// every node but the first and the last keeps at least this many elements, so the list stays at least half full
+#define ULIST_FILL_MIN (CUTIL_ULIST_NODE_CAP / 2)
+
+static struct cutil_ulist_node_t* ulist_node_new(struct cutil_ulist_t* list)
+{
+  struct cutil_ulist_node_t* node = malloc(sizeof *node);
+  if (!node)
+    return NULL;
+
+  node->next = NULL;
+  node->prev = NULL;
+  node->count = 0;
+  list->nodes++;
+  return node;
+}
+
+// Links `add` after `at`, or at the front if `at` is NULL
+static void ulist_link_after(struct cutil_ulist_t* list, struct cutil_ulist_node_t* at, struct cutil_ulist_node_t* add)
+{
+  add->prev = at;
+  add->next = (at) ? at->next : list->root;
+  if (add->next)
+    add->next->prev = add;
+  else
+    list->end = add;
+  if (at)
+    at->next = add;
+  else
+    list->root = add;
+}
+
+static void ulist_unlink_free(struct cutil_ulist_t* list, struct cutil_ulist_node_t* node)
+{
+  if (node->prev)
+    node->prev->next = node->next;
+  else
+    list->root = node->next;
+  if (node->next)
+    node->next->prev = node->prev;
+  else
+    list->end = node->prev;
+
+  list->nodes--;
+  free(node);
+}
+
+// Normalizes a position to an index, or returns -1. Insert positions range over one more slot than the elements
+static ptrdiff_t ulist_index(struct cutil_ulist_t* list, ptrdiff_t pos, int insert)
+{
+  ptrdiff_t len = (ptrdiff_t) list->length + (insert ? 1 : 0);
+  if (pos == CUTIL_END)
+    return len - 1;
+  if (pos < 0)
+    pos += len;
+  return (pos >= 0 && pos < len) ? pos : -1;
+}
+
+// Finds the node holding the element at `idx`, walking whole nodes from the nearer end
+static struct cutil_ulist_node_t* ulist_find(struct cutil_ulist_t* list, size_t idx, size_t* offset)
+{
+  struct cutil_ulist_node_t* node;
+  if (idx < list->length / 2)
+  {
+    node = list->root;
+    while (idx >= node->count)
+    {
+      idx -= node->count;
+      node = node->next;
+    }
+  }
+  else
+  {
+    size_t from_back = list->length - idx;  // 1 for the last element
+    node = list->end;
+    while (from_back > node->count)
+    {
+      from_back -= node->count;
+      node = node->prev;
+    }
+    idx = node->count - from_back;
+  }
+
+  *offset = idx;
+  return node;
+}
+
+// Refills a node which ran below ULIST_FILL_MIN after a remove. It borrows an element from a neighbour which can
+// spare one, and otherwise merges with a neighbour, which then holds less than CUTIL_ULIST_NODE_CAP elements
+static void ulist_rebalance(struct cutil_ulist_t* list, struct cutil_ulist_node_t* node)
+{
+  if (node->count == 0)
+  {
+    ulist_unlink_free(list, node);
+    return;
+  }
+  if (node->count >= ULIST_FILL_MIN)
+    return;
+
+  struct cutil_ulist_node_t* next = node->next;
+  struct cutil_ulist_node_t* prev = node->prev;
+  if (next && next->count > ULIST_FILL_MIN)
+  {
+    node->data[node->count++] = next->data[0];
+    next->count--;
+    memmove(next->data, next->data + 1, next->count * sizeof(void*));
+  }
+  else if (prev && prev->count > ULIST_FILL_MIN)
+  {
+    memmove(node->data + 1, node->data, node->count * sizeof(void*));
+    node->data[0] = prev->data[--prev->count];
+    node->count++;
+  }
+  else if (next)
+  {
+    memcpy(node->data + node->count, next->data, next->count * sizeof(void*));
+    node->count += next->count;
+    ulist_unlink_free(list, next);
+  }
+  else if (prev)
+  {
+    memcpy(prev->data + prev->count, node->data, node->count * sizeof(void*));
+    prev->count += node->count;
+    ulist_unlink_free(list, node);
+  }
+}
+
+void cutil_ulist_init(struct cutil_ulist_t* list)
+{
+  if (!list)
+    return;
+
+  list->root = NULL;
+  list->end = NULL;
+  list->length = 0;
+  list->nodes = 0;
+}
+
+void cutil_ulist_destroy(struct cutil_ulist_t* list, cutil_list_node_destructor_t destructor)
+{
+  if (!list)
+    return;
+
+  while (list->root)
+  {
+    struct cutil_ulist_node_t* tmp = list->root;
+    list->root = tmp->next;
+    for (size_t i = 0; destructor && i < tmp->count; i++)
+      destructor(tmp->data[i]);
+    free(tmp);
+  }
+
+  list->end = NULL;
+  list->length = 0;
+  list->nodes = 0;
+}
+
+size_t cutil_ulist_size(struct cutil_ulist_t* list)
+{
+  return (!list) ? 0 : list->length;
+}
+
+void** cutil_ulist_get(struct cutil_ulist_t* list, ptrdiff_t pos)
+{
+  if (!list || !list->length)
+    return NULL;
+
+  ptrdiff_t idx = ulist_index(list, pos, 0);
+  if (idx < 0)
+    return NULL;
+
+  size_t offset;
+  struct cutil_ulist_node_t* node = ulist_find(list, (size_t) idx, &offset);
+  return &node->data[offset];
+}
+
+int cutil_ulist_insert(struct cutil_ulist_t* list, void* data, ptrdiff_t pos)
+{
+  if (!list)
+    return 0;
+
+  ptrdiff_t idx = ulist_index(list, pos, 1);
+  if (idx < 0)
+    return 0;
+  if (idx == 0)
+    return cutil_ulist_insert_front(list, data);
+  if ((size_t) idx == list->length)
+    return cutil_ulist_insert_back(list, data);
+
+  size_t offset;
+  struct cutil_ulist_node_t* node = ulist_find(list, (size_t) idx, &offset);
+
+  // a full node splits in two halves, and the element goes into the half its position falls in
+  if (node->count == CUTIL_ULIST_NODE_CAP)
+  {
+    struct cutil_ulist_node_t* half = ulist_node_new(list);
+    if (!half)
+      return 0;
+
+    size_t keep = CUTIL_ULIST_NODE_CAP / 2;
+    half->count = CUTIL_ULIST_NODE_CAP - keep;
+    memcpy(half->data, node->data + keep, half->count * sizeof(void*));
+    node->count = keep;
+    ulist_link_after(list, node, half);
+
+    if (offset > keep)
+    {
+      offset -= keep;
+      node = half;
+    }
+  }
+
+  memmove(node->data + offset + 1, node->data + offset, (node->count - offset) * sizeof(void*));
+  node->data[offset] = data;
+  node->count++;
+  list->length++;
+  return 1;
+}
+
+void* cutil_ulist_remove(struct cutil_ulist_t* list, ptrdiff_t pos)
+{
+  if (!list || !list->length)
+    return NULL;
+
+  ptrdiff_t idx = ulist_index(list, pos, 0);
+  if (idx < 0)
+    return NULL;
+
+  size_t offset;
+  struct cutil_ulist_node_t* node = ulist_find(list, (size_t) idx, &offset);
+  void* data = node->data[offset];
+  memmove(node->data + offset, node->data + offset + 1, (node->count - offset - 1) * sizeof(void*));
+  node->count--;
+  list->length--;
+
+  ulist_rebalance(list, node);
+  return data;
+}
+
+void** cutil_ulist_back(struct cutil_ulist_t* list)
+{
+  return (!list || !list->end) ? NULL : &list->end->data[list->end->count - 1];
+}
+
+int cutil_ulist_insert_back(struct cutil_ulist_t* list, void* data)
+{
+  if (!list)
+    return 0;
+
+  // appends fill nodes completely, so a list built from the back is as dense as it gets
+  struct cutil_ulist_node_t* node = list->end;
+  if (!node || node->count == CUTIL_ULIST_NODE_CAP)
+  {
+    node = ulist_node_new(list);
+    if (!node)
+      return 0;
+    ulist_link_after(list, list->end, node);
+  }
+
+  node->data[node->count++] = data;
+  list->length++;
+  return 1;
+}
+
+void* cutil_ulist_remove_back(struct cutil_ulist_t* list)
+{
+  if (!list || !list->end)
+    return NULL;
+
+  struct cutil_ulist_node_t* node = list->end;
+  void* data = node->data[--node->count];
+  list->length--;
+  if (node->count == 0)
+    ulist_unlink_free(list, node);
+  return data;
+}
+
+void** cutil_ulist_front(struct cutil_ulist_t* list)
+{
+  return (!list || !list->root) ? NULL : &list->root->data[0];
+}
+
+int cutil_ulist_insert_front(struct cutil_ulist_t* list, void* data)
+{
+  if (!list)
+    return 0;
+
+  struct cutil_ulist_node_t* node = list->root;
+  if (!node || node->count == CUTIL_ULIST_NODE_CAP)
+  {
+    node = ulist_node_new(list);
+    if (!node)
+      return 0;
+    ulist_link_after(list, NULL, node);
+  }
+
+  memmove(node->data + 1, node->data, node->count * sizeof(void*));
+  node->data[0] = data;
+  node->count++;
+  list->length++;
+  return 1;
+}
+
+void* cutil_ulist_remove_front(struct cutil_ulist_t* list)
+{
+  if (!list || !list->root)
+    return NULL;
+
+  struct cutil_ulist_node_t* node = list->root;
+  void* data = node->data[0];
+  node->count--;
+  memmove(node->data, node->data + 1, node->count * sizeof(void*));
+  list->length--;
+  if (node->count == 0)
+    ulist_unlink_free(list, node);
+  return data;
+}
+
+void cutil_ulist_iterator_init(struct cutil_ulist_iterator_t* iterator, struct cutil_ulist_t* list, ptrdiff_t pos)
+{
+  if (!iterator || !list)
+    return;
+
+  iterator->list = list;
+  iterator->node = NULL;
+  iterator->index = 0;
+
+  ptrdiff_t idx = (list->length) ? ulist_index(list, pos, 0) : -1;
+  if (idx >= 0)
+    iterator->node = ulist_find(list, (size_t) idx, &iterator->index);
+}
+
+void cutil_ulist_iterator_destroy(struct cutil_ulist_iterator_t* iterator)
+{
+  if (!iterator)
+    return;
+
+  iterator->list = NULL;
+  iterator->node = NULL;
+  iterator->index = 0;
+}
+
+void** cutil_ulist_iterator_get(struct cutil_ulist_iterator_t* iterator)
+{
+  return (iterator && iterator->list && iterator->node) ? &iterator->node->data[iterator->index] : NULL;
+}
+
+void** cutil_ulist_iterator_next(struct cutil_ulist_iterator_t* iterator)
+{
+  if (!iterator || !iterator->list || !iterator->node)
+    return NULL;
+
+  if (++iterator->index == iterator->node->count)
+  {
+    iterator->node = iterator->node->next;
+    iterator->index = 0;
+  }
+  return cutil_ulist_iterator_get(iterator);
+}
+
+void** cutil_ulist_iterator_back(struct cutil_ulist_iterator_t* iterator)
+{
+  if (!iterator || !iterator->list || !iterator->node)
+    return NULL;
+
+  if (iterator->index-- == 0)
+  {
+    iterator->node = iterator->node->prev;
+    iterator->index = (iterator->node) ? iterator->node->count - 1 : 0;
+  }
+  return cutil_ulist_iterator_get(iterator);
+}
+
+void** cutil_ulist_iterator_peek(struct cutil_ulist_iterator_t* iterator)
+{
+  if (!iterator || !iterator->list || !iterator->node)
+    return NULL;
+
+  struct cutil_ulist_node_t* node = iterator->node;
+  if (iterator->index + 1 < node->count)
+    return &node->data[iterator->index + 1];
+  return (node->next) ? &node->next->data[0] : NULL;
+}
+
+void** cutil_ulist_iterator_peek_back(struct cutil_ulist_iterator_t* iterator)
+{
+  if (!iterator || !iterator->list || !iterator->node)
+    return NULL;
+
+  struct cutil_ulist_node_t* node = iterator->node;
+  if (iterator->index > 0)
+    return &node->data[iterator->index - 1];
+  return (node->prev) ? &node->prev->data[node->prev->count - 1] : NULL;
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include "cache.h"
+
+#include <vector>
+
+static void cache_record_evict(void* ctx, struct cutil_hmap_tuple_t* entry)
+{
+  ((std::vector<size_t>*) ctx)->push_back(*(size_t*) entry->key.key);
+}
+
+TEST(cache, null_oops)
+{
+  EXPECT_TRUE(cutil_cache_get(NULL, cutil_hmap_key_t()) == NULL);
+  EXPECT_EQ(cutil_cache_put(NULL, cutil_hmap_tuple_t(), 1), 0);
+  EXPECT_EQ(cutil_cache_del(NULL, cutil_hmap_key_t()), 0);
+  EXPECT_EQ(cutil_cache_size(NULL), 0);
+  cutil_cache_destroy(NULL);
+}
+
+TEST(cache, lru)
+{
+  struct cutil_cache_t cache;
+  cutil_cache_init(&cache, CUTIL_CACHE_LRU, 3);
+  std::vector<size_t> evicted;
+  cutil_cache_set_evict(&cache, cache_record_evict, &evicted);
+
+  size_t keys[] = { 0, 1, 2, 3, 4 };
+  for (size_t i = 0; i < 3; i++)
+    EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[i], &keys[i]), 1));
+
+  // touching 0 makes 1 the least recently used
+  EXPECT_EQ(*cutil_cache_get(&cache, cutil_hmap_key(&keys[0])), &keys[0]);
+  EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[3], &keys[3]), 1));
+  ASSERT_EQ(evicted.size(), 1);
+  EXPECT_EQ(evicted[0], 1);
+  EXPECT_EQ(0, cutil_cache_probe_key(&cache, cutil_hmap_key(&keys[1])));
+  EXPECT_EQ(cutil_cache_size(&cache), 3);
+
+  // probing doesn't count as a use
+  EXPECT_EQ(1, cutil_cache_probe_key(&cache, cutil_hmap_key(&keys[2])));
+  EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[4], &keys[4]), 1));
+  EXPECT_EQ(evicted.back(), 2);
+
+  // replacing a key hands the old entry over
+  EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[0], &keys[1]), 1));
+  EXPECT_EQ(evicted.back(), 0);
+  EXPECT_EQ(*cutil_cache_get(&cache, cutil_hmap_key(&keys[0])), &keys[1]);
+
+  EXPECT_EQ(1, cutil_cache_del(&cache, cutil_hmap_key(&keys[3])));
+  EXPECT_EQ(0, cutil_cache_del(&cache, cutil_hmap_key(&keys[3])));
+  EXPECT_EQ(evicted.back(), 3);
+  EXPECT_EQ(cutil_cache_size(&cache), 2);
+
+  evicted.clear();
+  cutil_cache_destroy(&cache);
+  EXPECT_EQ(evicted.size(), 2);
+}
+
+TEST(cache, cost)
+{
+  struct cutil_cache_t cache;
+  cutil_cache_init(&cache, CUTIL_CACHE_LRU, 100);
+
+  size_t keys[] = { 0, 1, 2, 3 };
+  EXPECT_EQ(0, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[0], NULL), 101));
+  EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[0], NULL), 40));
+  EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[1], NULL), 40));
+  EXPECT_EQ(cutil_cache_cost(&cache), 80);
+
+  // a big entry evicts as many entries as it needs
+  EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[2], NULL), 90));
+  EXPECT_EQ(cutil_cache_size(&cache), 1);
+  EXPECT_EQ(cutil_cache_cost(&cache), 90);
+
+  cutil_cache_destroy(&cache);
+}
+
+TEST(cache, clock)
+{
+  struct cutil_cache_t cache;
+  cutil_cache_init(&cache, CUTIL_CACHE_CLOCK, 4);
+  std::vector<size_t> evicted;
+  cutil_cache_set_evict(&cache, cache_record_evict, &evicted);
+
+  std::vector<size_t> keys(100);
+  for (size_t i = 0; i < keys.size(); i++)
+    keys[i] = i;
+
+  // a hot entry used between every insert survives a scan over many cold ones
+  for (size_t i = 1; i < keys.size(); i++)
+  {
+    EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[i], NULL), 1));
+    if (i == 1)
+    {
+      EXPECT_EQ(1, cutil_cache_put(&cache, cutil_hmap_tuple(&keys[0], NULL), 1));
+    }
+    EXPECT_TRUE(cutil_cache_get(&cache, cutil_hmap_key(&keys[0])) != NULL);
+    EXPECT_LE(cutil_cache_size(&cache), 4);
+  }
+
+  EXPECT_EQ(cutil_cache_size(&cache), 4);
+  EXPECT_EQ(evicted.size(), keys.size() - 4);
+  for (size_t k : evicted)
+    EXPECT_NE(k, 0);
+
+  cutil_cache_destroy(&cache);
+}
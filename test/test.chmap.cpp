@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include "chmap.h"
+
+#include <thread>
+#include <vector>
+
+TEST(chmap, null_oops)
+{
+  EXPECT_EQ(cutil_chmap_insert(NULL, cutil_hmap_tuple_t()), 0);
+  EXPECT_EQ(cutil_chmap_get(NULL, cutil_hmap_key_t(), NULL), 0);
+  EXPECT_EQ(cutil_chmap_del(NULL, cutil_hmap_key_t()), 0);
+  EXPECT_EQ(cutil_chmap_size(NULL), 0);
+}
+
+TEST(chmap, basic0)
+{
+  struct cutil_chmap_t map;
+  cutil_chmap_init(&map, 5);
+  EXPECT_EQ(map.shardCount, 8);
+
+  size_t keys[] = { 1, 2, 3, 4, 5 };
+  for (size_t i = 0; i < 5; i++)
+  {
+    EXPECT_EQ(1, cutil_chmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+    EXPECT_EQ(0, cutil_chmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+  }
+  EXPECT_EQ(5, cutil_chmap_size(&map));
+
+  void* v = NULL;
+  EXPECT_EQ(1, cutil_chmap_get(&map, cutil_hmap_key(&keys[2]), &v));
+  EXPECT_EQ(v, &keys[2]);
+  EXPECT_EQ(1, cutil_chmap_del(&map, cutil_hmap_key(&keys[2])));
+  EXPECT_EQ(0, cutil_chmap_probe_key(&map, cutil_hmap_key(&keys[2])));
+  EXPECT_EQ(4, cutil_chmap_size(&map));
+
+  cutil_chmap_destroy(&map);
+}
+
+TEST(chmap, concurrent)
+{
+  struct cutil_chmap_t map;
+  cutil_chmap_init(&map, 16);
+
+  const size_t threads = 4;
+  const size_t per_thread = 5000;
+  std::vector<size_t> keys(threads * per_thread);
+  for (size_t i = 0; i < keys.size(); i++)
+    keys[i] = i;
+
+  // every thread inserts its own range, reads everyone's and deletes half of its own
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&, t]() {
+      for (size_t i = t * per_thread; i < (t + 1) * per_thread; i++)
+        cutil_chmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i]));
+      for (size_t i = 0; i < keys.size(); i++)
+      {
+        void* v = NULL;
+        if (cutil_chmap_get(&map, cutil_hmap_key(&keys[i]), &v))
+        {
+          EXPECT_EQ(v, &keys[i]);
+        }
+      }
+      for (size_t i = t * per_thread; i < (t + 1) * per_thread; i += 2)
+        EXPECT_EQ(1, cutil_chmap_del(&map, cutil_hmap_key(&keys[i])));
+    });
+  }
+  for (auto& w : workers)
+    w.join();
+
+  EXPECT_EQ(keys.size() / 2, cutil_chmap_size(&map));
+  for (size_t i = 0; i < keys.size(); i++)
+    EXPECT_EQ(i % 2, cutil_chmap_probe_key(&map, cutil_hmap_key(&keys[i])));
+
+  cutil_chmap_destroy(&map);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include "flatmap.h"
+
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+TEST(flatmap, null_oops)
+{
+  EXPECT_EQ(cutil_flatmap_insert(NULL, cutil_hmap_tuple_t()), 0);
+  EXPECT_TRUE(cutil_flatmap_get(NULL, cutil_hmap_key_t()) == NULL);
+  EXPECT_EQ(cutil_flatmap_del(NULL, cutil_hmap_key_t()), 0);
+  EXPECT_EQ(cutil_flatmap_size(NULL), 0);
+}
+
+TEST(flatmap, basic0)
+{
+  struct cutil_flatmap_t map;
+  cutil_flatmap_init(&map);
+
+  EXPECT_TRUE(map.slots != NULL);
+  EXPECT_EQ(map.capacity % CUTIL_FLATMAP_GROUP_WIDTH, 0);
+
+  const char* keys[] = { "test0", "test1", "test2" };
+  const char* vals[] = { "val0", "val1", "val2" };
+  size_t n = sizeof(keys) / sizeof(*keys);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    struct cutil_hmap_key_t k = cutil_hmap_make_key((void*) keys[i], strlen(keys[i]) + 1);
+    EXPECT_EQ(1, cutil_flatmap_insert(&map, cutil_hmap_make_tuple(k, (void*) vals[i])));
+    EXPECT_EQ(0, cutil_flatmap_insert(&map, cutil_hmap_make_tuple(k, (void*) vals[i])));
+    EXPECT_EQ(i + 1, cutil_flatmap_size(&map));
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    struct cutil_hmap_key_t k = cutil_hmap_make_key((void*) keys[i], strlen(keys[i]) + 1);
+    EXPECT_EQ(1, cutil_flatmap_probe_key(&map, k));
+    EXPECT_EQ(1, cutil_flatmap_probe_hashfn(&map, k));
+    void** v = cutil_flatmap_get(&map, k);
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*v, (void*) vals[i]);
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    struct cutil_hmap_key_t k = cutil_hmap_make_key((void*) keys[i], strlen(keys[i]) + 1);
+    EXPECT_EQ(1, cutil_flatmap_del(&map, k));
+    EXPECT_EQ(0, cutil_flatmap_del(&map, k));
+    EXPECT_EQ(0, cutil_flatmap_probe_key(&map, k));
+    EXPECT_EQ(n - i - 1, cutil_flatmap_size(&map));
+  }
+
+  cutil_flatmap_destroy(&map);
+}
+
+static size_t destroyed = 0;
+static void count_destructor(struct cutil_hmap_tuple_t* t)
+{
+  (void) t;
+  destroyed++;
+}
+
+TEST(flatmap, churn_matches_reference)
+{
+  struct cutil_flatmap_t map;
+  cutil_flatmap_init(&map);
+  cutil_flatmap_set_destructor(&map, (cutil_destructor_func_t) count_destructor);
+  destroyed = 0;
+
+  const size_t n = 20000;
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+    keys[i] = i * 2654435761u;
+
+  std::unordered_map<size_t, size_t> ref;
+  // interleave inserts and deletes so that tombstones get reused and purged
+  for (size_t round = 0; round < 3; round++)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      int inserted = cutil_flatmap_insert(&map, cutil_hmap_tuple(&keys[i], i));
+      EXPECT_EQ(inserted, ref.emplace(keys[i], i).second ? 1 : 0);
+    }
+    for (size_t i = round; i < n; i += 2)
+    {
+      int deleted = cutil_flatmap_del(&map, cutil_hmap_key(&keys[i]));
+      EXPECT_EQ((size_t) deleted, ref.erase(keys[i]));
+    }
+    ASSERT_EQ(ref.size(), cutil_flatmap_size(&map));
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    void** v = cutil_flatmap_get(&map, cutil_hmap_key(&keys[i]));
+    auto it = ref.find(keys[i]);
+    if (it == ref.end())
+    {
+      EXPECT_TRUE(v == NULL);
+    }
+    else
+    {
+      ASSERT_TRUE(v != NULL);
+      EXPECT_EQ((size_t) *v, it->second);
+    }
+  }
+
+  size_t before = destroyed;
+  cutil_flatmap_destroy(&map);
+  EXPECT_EQ(destroyed - before, ref.size());
+}
+
+static size_t equal_calls = 0;
+static int counting_equal(void* a, void* b, size_t alen, size_t blen)
+{
+  equal_calls++;
+  return cutil_equal_bytes(a, b, alen, blen);
+}
+
+TEST(flatmap, equalfn)
+{
+  struct cutil_flatmap_t map;
+  cutil_flatmap_init(&map);
+  EXPECT_TRUE(map.equalFn == cutil_equal_bytes);
+
+  cutil_flatmap_set_equalfn(&map, counting_equal);
+  size_t a = 7, b = 7;
+  EXPECT_EQ(1, cutil_flatmap_insert(&map, cutil_hmap_tuple(&a, &a)));
+  equal_calls = 0;
+  EXPECT_TRUE(cutil_flatmap_get(&map, cutil_hmap_key(&b)) != NULL);
+  EXPECT_GE(equal_calls, 1);
+
+  // the functions only change while the map is empty
+  cutil_flatmap_set_comparefn(&map, cutil_compare_lex);
+  EXPECT_TRUE(map.equalFn == counting_equal);
+  EXPECT_EQ(1, cutil_flatmap_del(&map, cutil_hmap_key(&b)));
+
+  // a comparison function takes over from the equality function
+  cutil_flatmap_set_comparefn(&map, cutil_compare_lex);
+  EXPECT_TRUE(map.equalFn == NULL);
+  EXPECT_EQ(1, cutil_flatmap_insert(&map, cutil_hmap_tuple(&a, &a)));
+  equal_calls = 0;
+  EXPECT_TRUE(cutil_flatmap_get(&map, cutil_hmap_key(&b)) != NULL);
+  EXPECT_EQ(equal_calls, 0);
+
+  cutil_flatmap_destroy(&map);
+}
@@ -4,6 +4,9 @@
 #include "hash.h"
 
 #include <iostream>
+#include <set>
+#include <string.h>
+#include <vector>
 
 TEST(arb_add_chained, test_basic)
 {
@@ -21,6 +24,217 @@ TEST(arb_xor_chained, test_basic)
   EXPECT_TRUE(expected == hash);
 }
 
+TEST(arb_xor_chained, tail_bytes)
+{
+  // bytes above 0x7F past the last word must not sign extend into the upper bits
+  unsigned char data[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0x80, 0xFF };
+  EXPECT_EQ(cutil_hash_arb_xor_chained(data, sizeof(data)), (size_t) 0xFF80);
+  EXPECT_EQ(cutil_hash_arb_add_chained(data, sizeof(data)), (size_t) 0xFF80);
+}
+
+static std::vector<unsigned char> hash_test_bytes(size_t n, unsigned seed)
+{
+  std::vector<unsigned char> v(n);
+  uint64_t x = 0x9E3779B97F4A7C15ull * (seed + 1);
+  for (size_t i = 0; i < n; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    v[i] = (unsigned char) x;
+  }
+  return v;
+}
+
+static void hash_check_sensitivity(cutil_hash_func_t fn)
+{
+  const size_t lengths[] = { 0, 1, 3, 4, 7, 8, 9, 16, 17, 47, 48, 49, 64, 100, 255, 256, 1023, 1024, 1500, 4096 };
+  std::set<size_t> seen;
+
+  for (size_t len : lengths)
+  {
+    std::vector<unsigned char> v = hash_test_bytes(len, 1);
+    size_t h = fn(v.data(), len);
+    EXPECT_EQ(h, fn(v.data(), len));
+    EXPECT_TRUE(seen.insert(h).second) << "length " << len;
+
+    // every single bit flip changes the hash
+    for (size_t i = 0; i < len * 8; i += (len > 64) ? 61 : 1)
+    {
+      v[i / 8] ^= (unsigned char) (1u << (i % 8));
+      EXPECT_NE(h, fn(v.data(), len)) << "length " << len << " bit " << i;
+      v[i / 8] ^= (unsigned char) (1u << (i % 8));
+    }
+
+    // swapping two differing words changes the hash
+    if (len >= 16 && memcmp(v.data(), v.data() + 8, 8) != 0)
+    {
+      std::vector<unsigned char> w = v;
+      memcpy(w.data(), v.data() + 8, 8);
+      memcpy(w.data() + 8, v.data(), 8);
+      EXPECT_NE(h, fn(w.data(), len)) << "length " << len;
+    }
+  }
+
+  // trailing zeros count
+  unsigned char zeros[32] = { 0 };
+  for (size_t len = 0; len < sizeof(zeros); len++)
+    EXPECT_TRUE(seen.insert(fn(zeros, len)).second || len == 0) << "zeros " << len;
+}
+
+static void hash_check_alignment(cutil_hash_func_t fn)
+{
+  for (size_t len : { 5, 31, 100, 300, 2000 })
+  {
+    std::vector<unsigned char> v = hash_test_bytes(len, 2);
+    std::vector<unsigned char> buf(len + 16);
+    size_t h = fn(v.data(), len);
+    for (size_t off = 1; off < 16; off++)
+    {
+      memcpy(buf.data() + off, v.data(), len);
+      EXPECT_EQ(h, fn(buf.data() + off, len)) << "length " << len << " offset " << off;
+    }
+  }
+}
+
+// Sequential integer keys must spread evenly over the low bits, which is all a power of two table looks at
+static void hash_check_distribution(cutil_hash_func_t fn)
+{
+  const size_t keys = 1 << 16, buckets = 1 << 10;
+  std::vector<size_t> count(buckets);
+  for (size_t i = 0; i < keys; i++)
+    count[fn(&i, sizeof(i)) & (buckets - 1)]++;
+
+  double expected = (double) keys / buckets, chi = 0;
+  for (size_t c : count)
+    chi += (c - expected) * (c - expected) / expected;
+
+  // the chi-squared statistic of a uniform hash stays near the degrees of freedom
+  EXPECT_LT(chi, buckets * 1.3);
+}
+
+TEST(hash_wy, sensitivity)
+{
+  hash_check_sensitivity(cutil_hash_wy);
+}
+
+TEST(hash_wy, alignment)
+{
+  hash_check_alignment(cutil_hash_wy);
+}
+
+TEST(hash_wy, distribution)
+{
+  hash_check_distribution(cutil_hash_wy);
+}
+
+TEST(hash_stripe, sensitivity)
+{
+  hash_check_sensitivity(cutil_hash_stripe);
+}
+
+TEST(hash_stripe, alignment)
+{
+  hash_check_alignment(cutil_hash_stripe);
+}
+
+TEST(hash_stripe, distribution)
+{
+  hash_check_distribution(cutil_hash_stripe);
+}
+
+TEST(hash_stripe, implementations_agree)
+{
+  // every implementation built in and supported by this CPU must give what cutil_hash_stripe() gives
+  std::vector<int> isas;
+  for (int isa : { CUTIL_HASH_ISA_SCALAR, CUTIL_HASH_ISA_SSE2, CUTIL_HASH_ISA_AVX2 })
+  {
+    size_t h;
+    if (cutil_hash_stripe_isa(NULL, 0, isa, &h))
+      isas.push_back(isa);
+  }
+  ASSERT_FALSE(isas.empty());
+  EXPECT_EQ(0, cutil_hash_stripe_isa(NULL, 0, -1, NULL));
+
+  std::vector<unsigned char> v = hash_test_bytes(1024 + 16, 5);
+  for (size_t offset = 0; offset < 16; offset += 3)
+  {
+    for (size_t len = 0; len <= 1024; len++)
+    {
+      size_t expected = cutil_hash_stripe(v.data() + offset, len);
+      for (int isa : isas)
+      {
+        size_t h = 0;
+        ASSERT_EQ(1, cutil_hash_stripe_isa(v.data() + offset, len, isa, &h));
+        ASSERT_EQ(h, expected) << "isa " << isa << " len " << len << " offset " << offset;
+      }
+    }
+  }
+
+  // pinned, so that builds with another set of implementations are held to the same values
+  if (sizeof(size_t) == 8)
+  {
+    unsigned char b[1024];
+    for (size_t i = 0; i < sizeof(b); i++)
+      b[i] = (unsigned char) (i * 31 + 7);
+    EXPECT_EQ(cutil_hash_stripe(b, 0), (size_t) 0x2fd94572dac12ce5ull);
+    EXPECT_EQ(cutil_hash_stripe(b, 63), (size_t) 0x8d33f03fd9b67477ull);
+    EXPECT_EQ(cutil_hash_stripe(b, 64), (size_t) 0x46f98db0b7360e37ull);
+    EXPECT_EQ(cutil_hash_stripe(b, 1024), (size_t) 0xb8acd1d41a166554ull);
+  }
+}
+
+TEST(hash_default, dispatch)
+{
+  std::vector<unsigned char> v = hash_test_bytes(4 * CUTIL_HASH_LONG_KEY, 3);
+  EXPECT_EQ(cutil_hash_default(v.data(), CUTIL_HASH_LONG_KEY - 1), cutil_hash_wy(v.data(), CUTIL_HASH_LONG_KEY - 1));
+  EXPECT_EQ(cutil_hash_default(v.data(), CUTIL_HASH_LONG_KEY), cutil_hash_stripe(v.data(), CUTIL_HASH_LONG_KEY));
+  EXPECT_EQ(cutil_hash_default(v.data(), v.size()), cutil_hash_stripe(v.data(), v.size()));
+  hash_check_distribution(cutil_hash_default);
+}
+
+TEST(hash_siphash, reference_vectors)
+{
+  // from the SipHash paper: key 00 01 .. 0f, message 00 01 .. len-1
+  struct cutil_hash_seed_t seed = { 0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull };
+  unsigned char msg[64];
+  for (size_t i = 0; i < sizeof(msg); i++)
+    msg[i] = (unsigned char) i;
+
+  EXPECT_EQ(cutil_hash_siphash(msg, 0, &seed), (size_t) 0x726fdb47dd0e0e31ull);
+  EXPECT_EQ(cutil_hash_siphash(msg, 1, &seed), (size_t) 0x74f839c593dc67fdull);
+  EXPECT_EQ(cutil_hash_siphash(msg, 8, &seed), (size_t) 0x93f5f5799a932462ull);
+  EXPECT_EQ(cutil_hash_siphash(msg, 15, &seed), (size_t) 0xa129ca6149be45e5ull);
+  EXPECT_EQ(cutil_hash_siphash(msg, 63, &seed), (size_t) 0x958a324ceb064572ull);
+}
+
+TEST(hash_siphash, seeded)
+{
+  struct cutil_hash_seed_t a, b;
+  ASSERT_EQ(1, cutil_hash_seed_random(&a));
+  ASSERT_EQ(1, cutil_hash_seed_random(&b));
+  EXPECT_EQ(0, cutil_hash_seed_random(NULL));
+  EXPECT_FALSE(a.k0 == b.k0 && a.k1 == b.k1);
+
+  // the seed changes every hash
+  std::vector<unsigned char> v = hash_test_bytes(100, 4);
+  for (size_t len : { 0, 3, 8, 21, 100 })
+  {
+    EXPECT_NE(cutil_hash_siphash(v.data(), len, &a), cutil_hash_siphash(v.data(), len, &b));
+    EXPECT_NE(cutil_hash_siphash13(v.data(), len, &a), cutil_hash_siphash13(v.data(), len, &b));
+    EXPECT_NE(cutil_hash_siphash(v.data(), len, &a), cutil_hash_siphash13(v.data(), len, &a));
+  }
+
+  // every single bit flip changes the hash
+  size_t h = cutil_hash_siphash13(v.data(), v.size(), &a);
+  for (size_t i = 0; i < v.size() * 8; i++)
+  {
+    v[i / 8] ^= (unsigned char) (1u << (i % 8));
+    EXPECT_NE(h, cutil_hash_siphash13(v.data(), v.size(), &a)) << "bit " << i;
+    v[i / 8] ^= (unsigned char) (1u << (i % 8));
+  }
+}
+
 TEST(compare_lex, lt)
 {
   const char* a = "abcdefg";
@@ -54,3 +268,32 @@ TEST(compare_lex, eq)
   EXPECT_EQ(cutil_compare_lex(NULL, NULL, 0, 0), CUTIL_EQ);
 }
 
+TEST(equal_bytes, lengths_and_positions)
+{
+  std::vector<unsigned char> a = hash_test_bytes(100, 5);
+  std::vector<unsigned char> b(a.begin(), a.end());
+  std::vector<unsigned char> buf(a.size() + 16);
+
+  for (size_t len = 0; len <= a.size(); len++)
+  {
+    EXPECT_EQ(1, cutil_equal_bytes(a.data(), b.data(), len, len)) << "length " << len;
+    EXPECT_EQ(1, cutil_equal_bytes(a.data(), a.data(), len, len));
+
+    // unaligned copies are still equal
+    memcpy(buf.data() + 3, a.data(), len);
+    EXPECT_EQ(1, cutil_equal_bytes(a.data(), buf.data() + 3, len, len)) << "length " << len;
+
+    // a difference anywhere, down to the top bit of a byte, is found
+    for (size_t i = 0; i < len; i++)
+    {
+      b[i] ^= 0x80;
+      EXPECT_EQ(0, cutil_equal_bytes(a.data(), b.data(), len, len)) << "length " << len << " byte " << i;
+      b[i] ^= 0x80;
+    }
+  }
+
+  // keys of different lengths differ, even when one is a prefix of the other
+  EXPECT_EQ(0, cutil_equal_bytes(a.data(), b.data(), 10, 11));
+  EXPECT_EQ(0, cutil_equal_bytes(a.data(), a.data(), 10, 11));
+  EXPECT_EQ(1, cutil_equal_bytes(NULL, NULL, 0, 0));
+}
@@ -3,6 +3,8 @@
 #include "hmap.h"
 
 #include <string.h>
+#include <string>
+#include <vector>
 
 TEST(hmap_other, make_key)
 {
@@ -142,3 +144,668 @@ TEST(hmap, resize_buckets)
     //   EXPECT_LT(lf, map.loadFactorMax);
   }
 }
+
+TEST(hmap, incremental_resize)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  cutil_hmap_set_incremental(&map, 2);
+
+  const size_t n = 4096;
+  std::vector<size_t> keys(n);
+  bool migrated = false;
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+    EXPECT_EQ(0, cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+    migrated |= map.oldData != NULL;
+
+    // entries stay reachable whichever bucket array they currently live in
+    void** v = cutil_hmap_get(&map, cutil_hmap_key(&keys[i / 2]));
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*v, &keys[i / 2]);
+  }
+  EXPECT_TRUE(migrated);
+  EXPECT_EQ(n, cutil_hmap_size(&map));
+
+  for (size_t i = 0; i < n; i += 2)
+    EXPECT_EQ(1, cutil_hmap_del(&map, cutil_hmap_key(&keys[i])));
+  for (size_t i = 0; i < n; i++)
+    EXPECT_EQ(i % 2, cutil_hmap_probe_key(&map, cutil_hmap_key(&keys[i])));
+
+  // switching back to one-shot resizing completes the migration
+  cutil_hmap_set_incremental(&map, 0);
+  EXPECT_TRUE(map.oldData == NULL);
+  EXPECT_EQ(n / 2, cutil_hmap_size(&map));
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, node_region)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  const size_t n = 64;
+  std::vector<char> region(cutil_hmap_node_size(&map) * n + 16);
+  EXPECT_GE(cutil_hmap_set_node_region(&map, region.data(), region.size()), n);
+  cutil_hmap_set_pool_fixed(&map, 1);
+
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+  }
+  EXPECT_TRUE(map.nodePool.chunks == NULL);
+
+  // deleted entries are recycled through the pool
+  for (size_t i = 0; i < n; i += 2)
+    EXPECT_EQ(1, cutil_hmap_del(&map, cutil_hmap_key(&keys[i])));
+  for (size_t i = 0; i < n; i += 2)
+    EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+  EXPECT_TRUE(map.nodePool.chunks == NULL);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    void** v = cutil_hmap_get(&map, cutil_hmap_key(&keys[i]));
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*v, &keys[i]);
+  }
+
+  // a full fixed pool fails the insert, and grows again once it may
+  std::vector<size_t> extra(n);
+  size_t fitted = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    extra[i] = n + i;
+    fitted += cutil_hmap_insert(&map, cutil_hmap_tuple(&extra[i], &extra[i]));
+  }
+  EXPECT_LT(fitted, n);
+  EXPECT_EQ(cutil_hmap_size(&map), n + fitted);
+  EXPECT_TRUE(map.nodePool.chunks == NULL);
+  cutil_hmap_set_pool_fixed(&map, 0);
+  EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_tuple(&extra[n - 1], &extra[n - 1])));
+  EXPECT_TRUE(map.nodePool.chunks != NULL);
+  cutil_hmap_set_pool_fixed(NULL, 1);
+
+  cutil_hmap_destroy(&map);
+}
+
+static size_t hash_calls = 0;
+static size_t counting_hashfn(void* data, size_t len)
+{
+  (void) len;
+  hash_calls++;
+  return *(size_t*) data;
+}
+
+static size_t compare_calls = 0;
+static int counting_comparefn(void* d0, void* d1, size_t l0, size_t l1)
+{
+  compare_calls++;
+  return cutil_compare_lex(d0, d1, l0, l1);
+}
+
+TEST(hmap, cached_hash)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  cutil_hmap_set_hashfn(&map, counting_hashfn);
+  cutil_hmap_set_comparefn(&map, counting_comparefn);
+
+  const size_t n = 2048;
+  std::vector<size_t> keys(n);
+  hash_calls = 0;
+  compare_calls = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+  }
+
+  // resizes move nodes without hashing again, and distinct hashes are never byte compared
+  EXPECT_EQ(hash_calls, n);
+  EXPECT_EQ(compare_calls, 0);
+
+  for (size_t i = 0; i < n; i++)
+    EXPECT_TRUE(cutil_hmap_get(&map, cutil_hmap_key(&keys[i])) != NULL);
+  EXPECT_EQ(compare_calls, n);
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, batch)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  cutil_hmap_set_incremental(&map, 1);
+
+  const size_t n = 1000;
+  std::vector<size_t> keys(2 * n);
+  std::vector<struct cutil_hmap_tuple_t> tuples(n);
+  std::vector<struct cutil_hmap_key_t> lookups(2 * n);
+  for (size_t i = 0; i < 2 * n; i++)
+  {
+    keys[i] = i * 7919;
+    lookups[i] = cutil_hmap_key(&keys[i]);
+    if (i < n)
+      tuples[i] = cutil_hmap_tuple(&keys[i], &keys[i]);
+  }
+
+  EXPECT_EQ(n, cutil_hmap_insert_many(&map, tuples.data(), n));
+  EXPECT_EQ(0, cutil_hmap_insert_many(&map, tuples.data(), n));
+  EXPECT_EQ(n, cutil_hmap_size(&map));
+
+  // half of the lookups miss
+  std::vector<void**> values(2 * n);
+  EXPECT_EQ(n, cutil_hmap_get_many(&map, lookups.data(), 2 * n, values.data()));
+  for (size_t i = 0; i < 2 * n; i++)
+  {
+    if (i < n)
+    {
+      ASSERT_TRUE(values[i] != NULL);
+      EXPECT_EQ(*values[i], &keys[i]);
+    }
+    else
+    {
+      EXPECT_TRUE(values[i] == NULL);
+    }
+  }
+
+  EXPECT_EQ(n / 2, cutil_hmap_del_many(&map, lookups.data(), n / 2));
+  EXPECT_EQ(n / 2, cutil_hmap_del_many(&map, lookups.data(), 2 * n));
+  EXPECT_EQ(0, cutil_hmap_size(&map));
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, owned_keys)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  EXPECT_EQ(1, cutil_hmap_set_owned_keys(&map, 1));
+  EXPECT_GE(cutil_hmap_node_size(&map), CUTIL_HMAP_INLINE_KEY);
+
+  // short keys stay inline, long ones share an allocation with their entry
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < 200; i++)
+    keys.push_back(std::string(i % 40 + 1, 'a' + (char) (i % 26)) + std::to_string(i));
+
+  for (size_t i = 0; i < keys.size(); i++)
+  {
+    std::string tmp = keys[i];
+    EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_make_tuple(cutil_hmap_make_key(&tmp[0], tmp.size()), (void*) i)));
+    // the caller's copy can go away right after the insert
+    tmp.assign(tmp.size(), '?');
+  }
+  EXPECT_EQ(0, cutil_hmap_set_owned_keys(&map, 0));
+
+  for (size_t i = 0; i < keys.size(); i++)
+  {
+    void** v = cutil_hmap_get(&map, cutil_hmap_make_key(&keys[i][0], keys[i].size()));
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ((size_t) *v, i);
+  }
+
+  for (size_t i = 0; i < keys.size(); i += 2)
+    EXPECT_EQ(1, cutil_hmap_del(&map, cutil_hmap_make_key(&keys[i][0], keys[i].size())));
+  EXPECT_EQ(keys.size() / 2, cutil_hmap_size(&map));
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, iterator)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  struct cutil_hmap_iterator_t empty = cutil_hmap_iterator_create(&map);
+  EXPECT_TRUE(cutil_hmap_iterator_peek(&empty) == NULL);
+  EXPECT_TRUE(cutil_hmap_iterator_next(&empty) == NULL);
+
+  const size_t n = 3000;
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i]));
+  }
+  for (size_t i = 0; i < n; i += 3)
+    cutil_hmap_del(&map, cutil_hmap_key(&keys[i]));
+
+  std::vector<int> seen(n, 0);
+  struct cutil_hmap_iterator_t it = cutil_hmap_iterator_create(&map);
+  for (struct cutil_hmap_tuple_t* t = cutil_hmap_iterator_peek(&it); t; t = cutil_hmap_iterator_next(&it))
+  {
+    EXPECT_EQ(t->value, t->key.key);
+    seen[*(size_t*) t->key.key]++;
+  }
+  for (size_t i = 0; i < n; i++)
+    EXPECT_EQ(seen[i], (i % 3) ? 1 : 0);
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, iterator_partition)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  cutil_hmap_set_incremental(&map, 1);
+
+  const size_t n = 5000;
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i * 31;
+    cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], (void*) i));
+  }
+
+  // partitions are disjoint and cover the map, even when cut during an incremental resize
+  const size_t k = 7;
+  struct cutil_hmap_iterator_t parts[k];
+  EXPECT_EQ(k, cutil_hmap_iterator_partition(&map, parts, k));
+  EXPECT_TRUE(map.oldData == NULL);
+
+  std::vector<int> seen(n, 0);
+  for (size_t p = 0; p < k; p++)
+    for (struct cutil_hmap_tuple_t* t = cutil_hmap_iterator_peek(&parts[p]); t; t = cutil_hmap_iterator_next(&parts[p]))
+      seen[(size_t) t->value]++;
+  for (size_t i = 0; i < n; i++)
+    EXPECT_EQ(seen[i], 1);
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, reserve_and_growth)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  const size_t n = 10000;
+  std::vector<size_t> keys(n);
+  EXPECT_EQ(1, cutil_hmap_reserve(&map, n));
+  size_t reserved = map.buckets;
+  EXPECT_EQ(reserved & (reserved - 1), 0);
+  EXPECT_LE((float) n, reserved * map.loadFactorMax);
+
+  // a bulk load of the reserved size never resizes
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i]));
+    EXPECT_EQ(reserved, map.buckets);
+  }
+
+  // deleting most entries shrinks, leaving the load factor between min and max
+  for (size_t i = 0; i < n - 100; i++)
+    cutil_hmap_del(&map, cutil_hmap_key(&keys[i]));
+  EXPECT_LT(map.buckets, reserved);
+  EXPECT_EQ(map.buckets & (map.buckets - 1), 0);
+
+  EXPECT_EQ(1, cutil_hmap_shrink_to_fit(&map));
+  EXPECT_EQ(map.buckets, 256);
+  for (size_t i = n - 100; i < n; i++)
+    EXPECT_EQ(1, cutil_hmap_probe_key(&map, cutil_hmap_key(&keys[i])));
+
+  cutil_hmap_set_min_buckets(&map, 100);
+  EXPECT_EQ(map.minBuckets, 128);
+
+  // sizes no power of two of buckets holds fail instead of looping
+  EXPECT_EQ(0, cutil_hmap_reserve(&map, SIZE_MAX));
+  EXPECT_EQ(0, cutil_hmap_reserve(&map, SIZE_MAX / 4));
+  EXPECT_EQ(map.buckets, 256);
+
+  // so do load factors which no bucket count satisfies
+  cutil_hmap_set_loadfactor(&map, -1.f, 0.f);
+  cutil_hmap_set_loadfactor(&map, 0.5f, 0.25f);
+  EXPECT_FLOAT_EQ(map.loadFactorMin, 0.25f);
+  EXPECT_FLOAT_EQ(map.loadFactorMax, 0.75f);
+  cutil_hmap_set_loadfactor(&map, 0.f, 0.5f);
+  EXPECT_FLOAT_EQ(map.loadFactorMax, 0.5f);
+  for (size_t i = n - 100; i < n; i++)
+    EXPECT_EQ(1, cutil_hmap_probe_key(&map, cutil_hmap_key(&keys[i])));
+
+  cutil_hmap_destroy(&map);
+}
+
+TEST(hmap, stats)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  struct cutil_hmap_stats_t stats;
+  EXPECT_EQ(0, cutil_hmap_stats(NULL, &stats));
+  EXPECT_EQ(0, cutil_hmap_stats(&map, NULL));
+
+  const size_t n = 1000;
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i]));
+  }
+
+  ASSERT_EQ(1, cutil_hmap_stats(&map, &stats));
+  EXPECT_EQ(stats.size, n);
+  EXPECT_EQ(stats.buckets, map.buckets);
+
+  // the histogram covers every bucket and every entry
+  size_t buckets = 0;
+  size_t entries = 0;
+  for (size_t i = 0; i < CUTIL_HMAP_STATS_CHAINS; i++)
+  {
+    buckets += stats.chains[i];
+    entries += stats.chains[i] * i;
+  }
+  EXPECT_EQ(buckets, stats.buckets);
+  EXPECT_EQ(entries, n);
+  EXPECT_GE(stats.maxChain, 1);
+  EXPECT_GE(stats.bucketBytes, stats.buckets * sizeof(void*));
+  EXPECT_GE(stats.nodeBytes, n * cutil_hmap_node_size(&map));
+
+#ifdef CUTIL_HMAP_STATS
+  EXPECT_GT(stats.counters.resizes, 0);
+  EXPECT_EQ(stats.counters.misses, n);
+
+  cutil_hmap_stats_reset(&map);
+  size_t missing = n;
+  EXPECT_TRUE(cutil_hmap_get(&map, cutil_hmap_key(&keys[0])) != NULL);
+  EXPECT_TRUE(cutil_hmap_get(&map, cutil_hmap_key(&missing)) == NULL);
+  cutil_hmap_stats(&map, &stats);
+  EXPECT_EQ(stats.counters.hits, 1);
+  EXPECT_EQ(stats.counters.misses, 1);
+  EXPECT_GE(stats.counters.compares, 1);
+  EXPECT_EQ(stats.counters.resizes, 0);
+#else
+  EXPECT_EQ(stats.counters.hits, 0);
+  EXPECT_EQ(stats.counters.resizes, 0);
+#endif
+
+  cutil_hmap_destroy(&map);
+}
+
+static size_t hmap_destroyed = 0;
+static void hmap_count_destructor(void* t)
+{
+  (void) t;
+  hmap_destroyed++;
+}
+
+TEST(hmap, upsert_get_or_insert_take)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  cutil_hmap_set_destructor(&map, hmap_count_destructor);
+  hmap_destroyed = 0;
+
+  // counting words with a single probe per occurrence
+  const char* words[] = { "a", "b", "a", "c", "a", "b" };
+  for (size_t i = 0; i < 6; i++)
+  {
+    int inserted = -1;
+    void** slot = cutil_hmap_get_or_insert(&map, cutil_hmap_make_tuple(cutil_hmap_make_key((void*) words[i], 1), (void*) 0), &inserted);
+    ASSERT_TRUE(slot != NULL);
+    EXPECT_EQ(inserted, (*slot == NULL) ? 1 : 0);
+    *slot = (void*) ((uintptr_t) *slot + 1);
+  }
+  EXPECT_EQ(cutil_hmap_size(&map), 3);
+  EXPECT_EQ((uintptr_t) *cutil_hmap_get(&map, cutil_hmap_make_key((void*) "a", 1)), 3);
+  EXPECT_EQ((uintptr_t) *cutil_hmap_get(&map, cutil_hmap_make_key((void*) "b", 1)), 2);
+
+  // upsert overwrites and hands back the old value instead of destroying it
+  size_t k = 7, v0 = 1, v1 = 2;
+  void* previous = &v1;
+  void** slot = cutil_hmap_upsert(&map, cutil_hmap_tuple(&k, &v0), &previous);
+  EXPECT_TRUE(previous == NULL);
+  EXPECT_EQ(*slot, &v0);
+  slot = cutil_hmap_upsert(&map, cutil_hmap_tuple(&k, &v1), &previous);
+  EXPECT_EQ(previous, &v0);
+  EXPECT_EQ(*slot, &v1);
+  EXPECT_EQ(*cutil_hmap_get(&map, cutil_hmap_key(&k)), &v1);
+  EXPECT_EQ(hmap_destroyed, 0);
+
+  // take removes without the destructor
+  struct cutil_hmap_tuple_t out;
+  EXPECT_EQ(1, cutil_hmap_take(&map, cutil_hmap_key(&k), &out));
+  EXPECT_EQ(out.value, &v1);
+  EXPECT_EQ(out.key.key, &k);
+  EXPECT_EQ(0, cutil_hmap_take(&map, cutil_hmap_key(&k), &out));
+  EXPECT_EQ(hmap_destroyed, 0);
+  EXPECT_EQ(cutil_hmap_size(&map), 3);
+
+  EXPECT_EQ(1, cutil_hmap_del(&map, cutil_hmap_make_key((void*) "c", 1)));
+  EXPECT_EQ(hmap_destroyed, 1);
+
+  EXPECT_TRUE(cutil_hmap_upsert(NULL, out, NULL) == NULL);
+  EXPECT_TRUE(cutil_hmap_get_or_insert(NULL, out, NULL) == NULL);
+  EXPECT_EQ(0, cutil_hmap_take(NULL, out.key, &out));
+
+  cutil_hmap_destroy(&map);
+}
+
+static size_t hmap_hash_calls = 0;
+static size_t hmap_counting_hash(void* data, size_t len)
+{
+  hmap_hash_calls++;
+  return cutil_hash_arb_xor_chained(data, len);
+}
+
+TEST(hmap, precomputed_hash)
+{
+  struct cutil_hmap_t a, b;
+  cutil_hmap_init(&a);
+  cutil_hmap_init(&b);
+  cutil_hmap_set_hashfn(&a, hmap_counting_hash);
+  cutil_hmap_set_hashfn(&b, hmap_counting_hash);
+
+  std::string key(200, 'k');
+  size_t v = 1;
+  struct cutil_hmap_key_t k = cutil_hmap_make_key((void*) key.data(), key.size());
+  hmap_hash_calls = 0;
+  size_t hash = cutil_hmap_hash(&a, k);
+  EXPECT_EQ(hmap_hash_calls, 1);
+  EXPECT_NE(hash, 0);
+  EXPECT_EQ(hash, cutil_hmap_key_hash(k, hmap_counting_hash));
+  hmap_hash_calls = 0;
+
+  // every operation on both maps reuses the hash
+  EXPECT_EQ(1, cutil_hmap_insert_hashed(&a, cutil_hmap_make_tuple(k, &v), hash));
+  EXPECT_EQ(1, cutil_hmap_insert_hashed(&b, cutil_hmap_make_tuple(k, &v), hash));
+  EXPECT_EQ(0, cutil_hmap_insert_hashed(&b, cutil_hmap_make_tuple(k, &v), hash));
+  EXPECT_EQ(1, cutil_hmap_probe_key_hashed(&a, k, hash));
+  EXPECT_TRUE(cutil_hmap_get_hashed(&b, k, hash) != NULL);
+  int inserted = 1;
+  EXPECT_TRUE(cutil_hmap_get_or_insert_hashed(&a, cutil_hmap_make_tuple(k, &v), hash, &inserted) != NULL);
+  EXPECT_EQ(inserted, 0);
+  EXPECT_EQ(1, cutil_hmap_del_hashed(&a, k, hash));
+  EXPECT_EQ(0, cutil_hmap_probe_key_hashed(&a, k, hash));
+
+  size_t w = 2;
+  void* previous = &w;
+  EXPECT_TRUE(cutil_hmap_upsert_hashed(&a, cutil_hmap_make_tuple(k, &v), hash, &previous) != NULL);
+  EXPECT_TRUE(previous == NULL);
+  EXPECT_TRUE(*cutil_hmap_upsert_hashed(&a, cutil_hmap_make_tuple(k, &w), hash, &previous) == &w);
+  EXPECT_TRUE(previous == &v);
+  struct cutil_hmap_tuple_t taken;
+  EXPECT_EQ(1, cutil_hmap_take_hashed(&a, k, hash, &taken));
+  EXPECT_TRUE(taken.value == &w);
+  EXPECT_EQ(0, cutil_hmap_take_hashed(&a, k, hash, &taken));
+
+  // and so do the batches, a hash per key
+  struct cutil_hmap_tuple_t tuples[2] = { cutil_hmap_make_tuple(k, &v), cutil_hmap_make_tuple(k, &w) };
+  struct cutil_hmap_key_t batch[2] = { k, k };
+  size_t hashes[2] = { hash, hash };
+  void** values[2];
+  EXPECT_EQ(1, cutil_hmap_insert_many_hashed(&a, tuples, hashes, 2));
+  EXPECT_EQ(2, cutil_hmap_get_many_hashed(&a, batch, hashes, 2, values));
+  EXPECT_TRUE(*values[0] == &v && *values[1] == &v);
+  EXPECT_EQ(1, cutil_hmap_del_many_hashed(&a, batch, hashes, 2));
+  EXPECT_EQ(0, cutil_hmap_get_many_hashed(&a, batch, hashes, 2, values));
+  EXPECT_EQ(hmap_hash_calls, 0);
+
+  // the plain operations find the same entry
+  EXPECT_EQ(1, cutil_hmap_probe_key(&b, k));
+  EXPECT_EQ(hmap_hash_calls, 1);
+
+  // entries keep their hash across resizes
+  std::vector<size_t> keys(1000);
+  for (size_t i = 0; i < keys.size(); i++)
+  {
+    keys[i] = i;
+    cutil_hmap_insert(&b, cutil_hmap_tuple(&keys[i], NULL));
+  }
+  EXPECT_EQ(hmap_hash_calls, 1 + keys.size());
+  EXPECT_TRUE(cutil_hmap_get_hashed(&b, k, hash) != NULL);
+  EXPECT_EQ(hmap_hash_calls, 1 + keys.size());
+
+  EXPECT_EQ(0, cutil_hmap_hash(NULL, k));
+  EXPECT_TRUE(cutil_hmap_get_hashed(NULL, k, hash) == NULL);
+  EXPECT_EQ(0, cutil_hmap_del_hashed(NULL, k, hash));
+  EXPECT_TRUE(cutil_hmap_upsert_hashed(NULL, cutil_hmap_make_tuple(k, &v), hash, NULL) == NULL);
+  EXPECT_EQ(0, cutil_hmap_take_hashed(NULL, k, hash, &taken));
+  EXPECT_EQ(0, cutil_hmap_get_many_hashed(&b, batch, NULL, 2, values));
+
+  cutil_hmap_destroy(&a);
+  cutil_hmap_destroy(&b);
+}
+
+TEST(hmap, hand_built_key)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  size_t keys[64];
+  for (size_t i = 0; i < 64; i++)
+  {
+    keys[i] = i * 7919;
+    ASSERT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+  }
+
+  // callers may fill the fields themselves rather than go through cutil_hmap_make_key()
+  for (size_t i = 0; i < 64; i++)
+  {
+    struct cutil_hmap_key_t k;
+    memset(&k, 0xA5, sizeof(k));
+    size_t probe = i * 7919;
+    k.key = &probe;
+    k.len = sizeof(probe);
+
+    EXPECT_EQ(1, cutil_hmap_probe_key(&map, k));
+    void** v = cutil_hmap_get(&map, k);
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*v, &keys[i]);
+    if (i % 2)
+    {
+      EXPECT_EQ(1, cutil_hmap_del(&map, k));
+    }
+  }
+  EXPECT_EQ(cutil_hmap_size(&map), 32);
+
+  cutil_hmap_destroy(&map);
+}
+
+// Stands in for an attacker who knows the hash function: every key collides
+static size_t hmap_constant_hash(void* data, size_t len)
+{
+  (void) data;
+  (void) len;
+  return 42;
+}
+
+TEST(hmap, keyed_hash)
+{
+  EXPECT_EQ(0, cutil_hmap_set_keyed_hashfn(NULL, cutil_hash_siphash13, NULL));
+  EXPECT_EQ(0, cutil_hmap_hash(NULL, cutil_hmap_make_key(NULL, 0)));
+
+  struct cutil_hmap_t a, b;
+  cutil_hmap_init(&a);
+  cutil_hmap_init(&b);
+  cutil_hmap_set_hashfn(&a, hmap_constant_hash);
+  cutil_hmap_set_hashfn(&b, hmap_constant_hash);
+  ASSERT_EQ(1, cutil_hmap_set_keyed_hashfn(&a, cutil_hash_siphash13, NULL));
+  ASSERT_EQ(1, cutil_hmap_set_keyed_hashfn(&b, cutil_hash_siphash13, NULL));
+
+  // every map draws its own seed
+  size_t probe = 7;
+  EXPECT_NE(cutil_hmap_hash(&a, cutil_hmap_key(&probe)), cutil_hmap_hash(&b, cutil_hmap_key(&probe)));
+
+  // keys that collide under the plain hash still spread over the buckets
+  const size_t n = 4096;
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    ASSERT_EQ(1, cutil_hmap_insert(&a, cutil_hmap_tuple(&keys[i], &keys[i])));
+  }
+  EXPECT_EQ(0, cutil_hmap_set_keyed_hashfn(&a, cutil_hash_siphash, NULL));
+
+  struct cutil_hmap_stats_t stats;
+  ASSERT_EQ(1, cutil_hmap_stats(&a, &stats));
+  EXPECT_LT(stats.maxChain, 16);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t k = i;
+    void** v = cutil_hmap_get(&a, cutil_hmap_key(&k));
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*(size_t*) *v, i);
+  }
+
+  // precomputed hashes use the seed of their map
+  size_t hash = cutil_hmap_hash(&a, cutil_hmap_key(&keys[5]));
+  EXPECT_EQ(hash, cutil_hash_siphash13(&keys[5], sizeof(size_t), &a.seed));
+  EXPECT_EQ(1, cutil_hmap_del_hashed(&a, cutil_hmap_key(&keys[5]), hash));
+  EXPECT_EQ(cutil_hmap_size(&a), n - 1);
+
+  // a fixed seed gives reproducible hashes, and the plain hash function comes back with set_hashfn
+  struct cutil_hash_seed_t seed = { 1, 2 };
+  ASSERT_EQ(1, cutil_hmap_set_keyed_hashfn(&b, cutil_hash_siphash, &seed));
+  EXPECT_EQ(cutil_hmap_hash(&b, cutil_hmap_key(&probe)), cutil_hash_siphash(&probe, sizeof(probe), &seed));
+  cutil_hmap_set_hashfn(&b, hmap_constant_hash);
+  EXPECT_EQ(cutil_hmap_hash(&b, cutil_hmap_key(&probe)), cutil_hash_mix(42));
+
+  cutil_hmap_destroy(&a);
+  cutil_hmap_destroy(&b);
+}
+
+static size_t hmap_equal_calls = 0;
+static int hmap_counting_equal(void* d0, void* d1, size_t l0, size_t l1)
+{
+  hmap_equal_calls++;
+  return cutil_equal_bytes(d0, d1, l0, l1);
+}
+
+TEST(hmap, equalfn)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  EXPECT_TRUE(map.equalFn == cutil_equal_bytes);
+
+  cutil_hmap_set_equalfn(&map, hmap_counting_equal);
+  std::string a = "some key", b = "some key", c = "some kez";
+  size_t v = 1;
+  EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_make_tuple(cutil_hmap_make_key((void*) a.data(), a.size()), &v)));
+  hmap_equal_calls = 0;
+  EXPECT_TRUE(cutil_hmap_get(&map, cutil_hmap_make_key((void*) b.data(), b.size())) != NULL);
+  EXPECT_EQ(0, cutil_hmap_probe_key(&map, cutil_hmap_make_key((void*) c.data(), c.size())));
+  EXPECT_EQ(0, cutil_hmap_probe_key(&map, cutil_hmap_make_key((void*) b.data(), b.size() - 1)));
+  EXPECT_GE(hmap_equal_calls, 1);
+
+  // the functions only change while the map is empty
+  cutil_hmap_set_comparefn(&map, cutil_compare_lex);
+  EXPECT_TRUE(map.equalFn == hmap_counting_equal);
+  EXPECT_EQ(1, cutil_hmap_del(&map, cutil_hmap_make_key((void*) b.data(), b.size())));
+
+  // a comparison function takes over from the equality function
+  cutil_hmap_set_comparefn(&map, cutil_compare_lex);
+  EXPECT_TRUE(map.equalFn == NULL);
+  EXPECT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_make_tuple(cutil_hmap_make_key((void*) a.data(), a.size()), &v)));
+  hmap_equal_calls = 0;
+  EXPECT_TRUE(cutil_hmap_get(&map, cutil_hmap_make_key((void*) b.data(), b.size())) != NULL);
+  EXPECT_EQ(0, cutil_hmap_probe_key(&map, cutil_hmap_make_key((void*) c.data(), c.size())));
+  EXPECT_EQ(hmap_equal_calls, 0);
+
+  cutil_hmap_destroy(&map);
+}
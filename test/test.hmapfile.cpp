@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include "hmapfile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string hmapfile_path(const char* name)
+{
+  return testing::TempDir() + name;
+}
+
+TEST(hmapfile, null_oops)
+{
+  struct cutil_hmapfile_t img;
+  EXPECT_EQ(cutil_hmapfile_write(NULL, "x", 0), 0);
+  EXPECT_EQ(cutil_hmapfile_open(NULL, "x"), 0);
+  EXPECT_EQ(cutil_hmapfile_open(&img, NULL), 0);
+  EXPECT_TRUE(cutil_hmapfile_get(NULL, cutil_hmap_key_t()) == NULL);
+  EXPECT_EQ(cutil_hmapfile_size(NULL), 0);
+  cutil_hmapfile_close(NULL);
+}
+
+TEST(hmapfile, roundtrip)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+  cutil_hmap_set_owned_keys(&map, 1);
+
+  const size_t n = 5000;
+  std::vector<std::string> keys(n);
+  std::vector<size_t> values(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = "key-" + std::to_string(i) + std::string(i % 40, 'x');
+    values[i] = i * 3;
+    struct cutil_hmap_key_t k = cutil_hmap_make_key((void*) keys[i].data(), keys[i].size());
+    ASSERT_EQ(1, cutil_hmap_insert(&map, cutil_hmap_make_tuple(k, &values[i])));
+  }
+
+  std::string path = hmapfile_path("cutil_hmapfile_roundtrip");
+  ASSERT_EQ(1, cutil_hmapfile_write(&map, path.c_str(), sizeof(size_t)));
+  cutil_hmap_destroy(&map);
+
+  struct cutil_hmapfile_t img;
+  ASSERT_EQ(1, cutil_hmapfile_open(&img, path.c_str()));
+  EXPECT_EQ(cutil_hmapfile_size(&img), n);
+  EXPECT_EQ(img.valueSize, sizeof(size_t));
+
+  for (size_t i = 0; i < n; i++)
+  {
+    struct cutil_hmap_key_t k = cutil_hmap_make_key((void*) keys[i].data(), keys[i].size());
+    const void* v = cutil_hmapfile_get(&img, k);
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ((uintptr_t) v % 16, 0);
+
+    size_t value;
+    memcpy(&value, v, sizeof(value));
+    EXPECT_EQ(value, i * 3);
+  }
+
+  std::string missing = "key-missing";
+  EXPECT_EQ(0, cutil_hmapfile_probe_key(&img, cutil_hmap_make_key((void*) missing.data(), missing.size())));
+
+  cutil_hmapfile_close(&img);
+  EXPECT_TRUE(img.base == NULL);
+  remove(path.c_str());
+}
+
+TEST(hmapfile, keys_only)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  size_t keys[] = { 1, 2, 3, 4, 5 };
+  for (size_t i = 0; i < 5; i++)
+    cutil_hmap_insert(&map, cutil_hmap_tuple(&keys[i], NULL));
+
+  std::string path = hmapfile_path("cutil_hmapfile_keys");
+  ASSERT_EQ(1, cutil_hmapfile_write(&map, path.c_str(), 0));
+  cutil_hmap_destroy(&map);
+
+  struct cutil_hmapfile_t img;
+  ASSERT_EQ(1, cutil_hmapfile_open(&img, path.c_str()));
+  for (size_t i = 0; i < 5; i++)
+    EXPECT_EQ(1, cutil_hmapfile_probe_key(&img, cutil_hmap_key(&keys[i])));
+
+  size_t missing = 6;
+  EXPECT_EQ(0, cutil_hmapfile_probe_key(&img, cutil_hmap_key(&missing)));
+
+  cutil_hmapfile_close(&img);
+  remove(path.c_str());
+}
+
+TEST(hmapfile, empty_and_invalid)
+{
+  struct cutil_hmap_t map;
+  cutil_hmap_init(&map);
+
+  std::string path = hmapfile_path("cutil_hmapfile_empty");
+  ASSERT_EQ(1, cutil_hmapfile_write(&map, path.c_str(), 8));
+  cutil_hmap_destroy(&map);
+
+  struct cutil_hmapfile_t img;
+  ASSERT_EQ(1, cutil_hmapfile_open(&img, path.c_str()));
+  EXPECT_EQ(cutil_hmapfile_size(&img), 0);
+  size_t k = 1;
+  EXPECT_TRUE(cutil_hmapfile_get(&img, cutil_hmap_key(&k)) == NULL);
+  cutil_hmapfile_close(&img);
+
+  // anything that isn't an image is rejected
+  FILE* f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f != NULL);
+  fputs("definitely not a hash map image, but long enough for a header", f);
+  fclose(f);
+  EXPECT_EQ(0, cutil_hmapfile_open(&img, path.c_str()));
+  EXPECT_TRUE(cutil_hmapfile_get(&img, cutil_hmap_key(&k)) == NULL);
+
+  remove(path.c_str());
+  EXPECT_EQ(0, cutil_hmapfile_open(&img, path.c_str()));
+}
+
+TEST(hmapfile, concurrent_writers)
+{
+  const int writers = 4;
+  std::vector<size_t> keys(64);
+  for (size_t i = 0; i < keys.size(); i++)
+    keys[i] = i;
+
+  // writer w saves the first 8 * (w + 1) keys
+  std::vector<struct cutil_hmap_t> maps(writers);
+  for (int w = 0; w < writers; w++)
+  {
+    cutil_hmap_init(&maps[w]);
+    for (size_t i = 0; i < 8 * (size_t) (w + 1); i++)
+      cutil_hmap_insert(&maps[w], cutil_hmap_tuple(&keys[i], &keys[i]));
+  }
+
+  // a file named like the old fixed temporary file is left alone
+  std::string path = hmapfile_path("cutil_hmapfile_concurrent");
+  std::string stale = path + ".tmp";
+  FILE* f = fopen(stale.c_str(), "wb");
+  ASSERT_TRUE(f != NULL);
+  fputs("not ours", f);
+  fclose(f);
+
+  std::vector<int> failures(writers, 0);
+  std::vector<std::thread> threads;
+  for (int w = 0; w < writers; w++)
+  {
+    threads.emplace_back([&, w]() {
+      for (int round = 0; round < 20; round++)
+        failures[w] += !cutil_hmapfile_write(&maps[w], path.c_str(), sizeof(size_t));
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  // whichever writer renamed last, the image is one of theirs and complete
+  struct cutil_hmapfile_t img;
+  ASSERT_EQ(1, cutil_hmapfile_open(&img, path.c_str()));
+  size_t n = cutil_hmapfile_size(&img);
+  EXPECT_TRUE(n % 8 == 0 && n >= 8 && n <= 8 * writers);
+  for (size_t i = 0; i < n; i++)
+  {
+    const void* v = cutil_hmapfile_get(&img, cutil_hmap_key(&keys[i]));
+    ASSERT_TRUE(v != NULL);
+    size_t value;
+    memcpy(&value, v, sizeof(value));
+    EXPECT_EQ(value, i);
+  }
+  cutil_hmapfile_close(&img);
+
+  f = fopen(stale.c_str(), "rb");
+  ASSERT_TRUE(f != NULL);
+  char buf[16] = { 0 };
+  EXPECT_TRUE(fgets(buf, sizeof(buf), f) != NULL);
+  EXPECT_STREQ(buf, "not ours");
+  fclose(f);
+
+  for (int w = 0; w < writers; w++)
+  {
+    EXPECT_EQ(failures[w], 0);
+    cutil_hmap_destroy(&maps[w]);
+  }
+  remove(stale.c_str());
+  remove(path.c_str());
+}
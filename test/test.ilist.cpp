@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "ilist.h"
+
+#include <vector>
+
+struct ilist_task
+{
+  int id;
+  struct cutil_ilist_link_t run;    // link in a run queue
+  struct cutil_ilist_link_t all;    // link in the list of every task
+};
+
+static std::vector<int> ilist_ids(struct cutil_ilist_t* list)
+{
+  std::vector<int> ids;
+  cutil_ilist_foreach(list, link)
+    ids.push_back(cutil_ilist_entry(link, struct ilist_task, run)->id);
+
+  // walking backwards gives the same order reversed
+  std::vector<int> back;
+  for (struct cutil_ilist_link_t* l = cutil_ilist_back(list); l; l = cutil_ilist_prev(list, l))
+    back.insert(back.begin(), cutil_ilist_entry(l, struct ilist_task, run)->id);
+  EXPECT_EQ(ids, back);
+  EXPECT_EQ(ids.size(), cutil_ilist_size(list));
+  return ids;
+}
+
+TEST(ilist, container_of)
+{
+  struct ilist_task t;
+  t.id = 7;
+  EXPECT_EQ(cutil_container_of(&t.all, struct ilist_task, all), &t);
+  EXPECT_EQ(cutil_ilist_entry(&t.run, struct ilist_task, run)->id, 7);
+}
+
+TEST(ilist, insert_remove)
+{
+  struct cutil_ilist_t list;
+  cutil_ilist_init(&list);
+  EXPECT_TRUE(cutil_ilist_empty(&list));
+  EXPECT_TRUE(cutil_ilist_front(&list) == NULL);
+  EXPECT_TRUE(cutil_ilist_back(&list) == NULL);
+  EXPECT_TRUE(cutil_ilist_remove_front(&list) == NULL);
+  EXPECT_TRUE(cutil_ilist_remove_back(&list) == NULL);
+
+  struct ilist_task tasks[6];
+  for (int i = 0; i < 6; i++)
+  {
+    tasks[i].id = i;
+    cutil_ilist_link_init(&tasks[i].run);
+    EXPECT_FALSE(cutil_ilist_link_linked(&tasks[i].run));
+  }
+
+  cutil_ilist_insert_back(&list, &tasks[1].run);
+  cutil_ilist_insert_back(&list, &tasks[3].run);
+  cutil_ilist_insert_front(&list, &tasks[0].run);
+  cutil_ilist_insert_before(&list, &tasks[3].run, &tasks[2].run);
+  cutil_ilist_insert_after(&list, &tasks[3].run, &tasks[5].run);
+  cutil_ilist_insert_after(&list, &tasks[3].run, &tasks[4].run);
+  EXPECT_EQ(ilist_ids(&list), std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+  EXPECT_TRUE(cutil_ilist_link_linked(&tasks[3].run));
+
+  // removing by link needs no search
+  cutil_ilist_remove(&list, &tasks[3].run);
+  EXPECT_FALSE(cutil_ilist_link_linked(&tasks[3].run));
+  EXPECT_EQ(ilist_ids(&list), std::vector<int>({ 0, 1, 2, 4, 5 }));
+
+  EXPECT_EQ(cutil_ilist_remove_front(&list), &tasks[0].run);
+  EXPECT_EQ(cutil_ilist_remove_back(&list), &tasks[5].run);
+  EXPECT_EQ(ilist_ids(&list), std::vector<int>({ 1, 2, 4 }));
+  EXPECT_EQ(cutil_ilist_next(&list, &tasks[4].run), (struct cutil_ilist_link_t*) NULL);
+  EXPECT_EQ(cutil_ilist_prev(&list, &tasks[1].run), (struct cutil_ilist_link_t*) NULL);
+
+  while (cutil_ilist_remove_front(&list))
+    ;
+  EXPECT_TRUE(cutil_ilist_empty(&list));
+  EXPECT_EQ(cutil_ilist_size(&list), 0);
+}
+
+TEST(ilist, two_lists_and_splice)
+{
+  struct cutil_ilist_t all, a, b;
+  cutil_ilist_init(&all);
+  cutil_ilist_init(&a);
+  cutil_ilist_init(&b);
+
+  struct ilist_task tasks[8];
+  for (int i = 0; i < 8; i++)
+  {
+    tasks[i].id = i;
+    cutil_ilist_insert_back(&all, &tasks[i].all);
+    cutil_ilist_insert_back((i < 4) ? &a : &b, &tasks[i].run);
+  }
+
+  // splicing into the middle, then appending an empty list, keeps both orders intact
+  cutil_ilist_splice(&a, &tasks[2].run, &b);
+  EXPECT_TRUE(cutil_ilist_empty(&b));
+  EXPECT_EQ(ilist_ids(&a), std::vector<int>({ 0, 1, 4, 5, 6, 7, 2, 3 }));
+  cutil_ilist_splice(&a, &a.head, &b);
+  EXPECT_EQ(cutil_ilist_size(&a), 8);
+
+  cutil_ilist_splice(&b, &b.head, &a);
+  EXPECT_EQ(ilist_ids(&b), std::vector<int>({ 0, 1, 4, 5, 6, 7, 2, 3 }));
+  EXPECT_EQ(cutil_ilist_size(&a), 0);
+
+  // the other list is untouched
+  int expected = 0;
+  cutil_ilist_foreach(&all, link)
+    EXPECT_EQ(cutil_ilist_entry(link, struct ilist_task, all)->id, expected++);
+  EXPECT_EQ(expected, 8);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include "cutil.h"
 #include "list.h"
 
 #include <vector>
@@ -84,3 +85,277 @@ TEST(list, insert_test_0)
   EXPECT_TRUE(list.end == NULL);
   EXPECT_TRUE(list.length == 0);
 }
+
+// Reads the elements front to back, checking the back links and the length on the way
+static std::vector<int> list_values(struct cutil_list_t* list)
+{
+  std::vector<int> out;
+  struct cutil_list_node_t* prev = NULL;
+  for (struct cutil_list_node_t* it = list->root; it; it = it->next)
+  {
+    EXPECT_EQ(it->prev, prev);
+    out.push_back(*(int*) it->data);
+    prev = it;
+  }
+  EXPECT_EQ(list->end, prev);
+  EXPECT_EQ(list->length, out.size());
+  return out;
+}
+
+TEST(list, positions)
+{
+  struct cutil_list_t list;
+  cutil_list_init(&list);
+
+  int v[] = { 0, 1, 2, 3, 4, 5 };
+  EXPECT_TRUE(cutil_list_insert(&list, &v[1], 0));
+  EXPECT_TRUE(cutil_list_insert(&list, &v[4], -1));
+  EXPECT_TRUE(cutil_list_insert(&list, &v[2], 1));
+  EXPECT_TRUE(cutil_list_insert(&list, &v[3], -2));
+  EXPECT_TRUE(cutil_list_insert(&list, &v[0], CUTIL_BEG));
+  EXPECT_TRUE(cutil_list_insert(&list, &v[5], CUTIL_END));
+  EXPECT_FALSE(cutil_list_insert(&list, &v[0], 8));
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+
+  for (int i = 0; i < 6; i++)
+  {
+    EXPECT_EQ(*(int*) *cutil_list_node_data(cutil_list_get(&list, i)), i);
+    EXPECT_EQ(*(int*) cutil_list_get(&list, i - 6)->data, i);
+  }
+  EXPECT_TRUE(cutil_list_get(&list, 6) == NULL);
+  EXPECT_TRUE(cutil_list_get(&list, -7) == NULL);
+
+  EXPECT_EQ(*(int*) cutil_list_remove(&list, -2), 4);
+  EXPECT_EQ(*(int*) cutil_list_remove(&list, 2), 2);
+  EXPECT_EQ(*(int*) cutil_list_remove_front(&list), 0);
+  EXPECT_EQ(*(int*) cutil_list_remove_back(&list), 5);
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 1, 3 }));
+  EXPECT_EQ(*(int*) cutil_list_remove_front(&list), 1);
+  EXPECT_EQ(*(int*) cutil_list_remove_front(&list), 3);
+  EXPECT_TRUE(cutil_list_remove_front(&list) == NULL);
+  EXPECT_TRUE(list.root == NULL && list.end == NULL && list.length == 0);
+
+  cutil_list_destroy(&list, NULL);
+}
+
+TEST(list, insert_array)
+{
+  struct cutil_list_t list;
+  cutil_list_init(&list);
+
+  int v[8];
+  void* ptrs[8];
+  for (int i = 0; i < 8; i++)
+  {
+    v[i] = i;
+    ptrs[i] = &v[i];
+  }
+
+  EXPECT_TRUE(cutil_list_insert_array(&list, ptrs, 2, 0));
+  EXPECT_TRUE(cutil_list_insert_array(&list, ptrs + 5, 3, -1));
+  EXPECT_TRUE(cutil_list_insert_array(&list, ptrs + 2, 3, 2));
+  EXPECT_TRUE(cutil_list_insert_array(&list, ptrs, 0, 0));
+  EXPECT_FALSE(cutil_list_insert_array(&list, ptrs, 1, 10));
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7 }));
+
+  // batches don't widen the nodes, and their nodes can be removed one by one
+  EXPECT_EQ(sizeof(struct cutil_list_node_t), 3 * sizeof(void*));
+  EXPECT_EQ(*(int*) cutil_list_remove(&list, 3), 3);
+  EXPECT_EQ(*(int*) cutil_list_remove(&list, 2), 2);
+  EXPECT_TRUE(cutil_list_insert(&list, &v[2], 2));
+  EXPECT_EQ(*(int*) cutil_list_remove(&list, 3), 4);
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 0, 1, 2, 5, 6, 7 }));
+
+  cutil_list_destroy(&list, NULL);
+  EXPECT_TRUE(list.root == NULL && list.end == NULL && list.length == 0);
+}
+
+TEST(list, splice_split_concat)
+{
+  struct cutil_list_t a, b;
+  cutil_list_init(&a);
+  cutil_list_init(&b);
+
+  int v[10];
+  void* ptrs[10];
+  for (int i = 0; i < 10; i++)
+  {
+    v[i] = i;
+    ptrs[i] = &v[i];
+  }
+  cutil_list_insert_array(&a, ptrs, 5, 0);
+  cutil_list_insert_array(&b, ptrs + 5, 5, 0);
+
+  // 6..8 in front of 2, with and without the count
+  EXPECT_TRUE(cutil_list_splice(&a, cutil_list_get(&a, 2), &b, cutil_list_get(&b, 1), cutil_list_get(&b, 3), 3));
+  EXPECT_EQ(list_values(&a), std::vector<int>({ 0, 1, 6, 7, 8, 2, 3, 4 }));
+  EXPECT_EQ(list_values(&b), std::vector<int>({ 5, 9 }));
+  EXPECT_TRUE(cutil_list_splice(&a, NULL, &b, b.root, b.end, 0));
+  EXPECT_EQ(list_values(&a), std::vector<int>({ 0, 1, 6, 7, 8, 2, 3, 4, 5, 9 }));
+  EXPECT_EQ(list_values(&b), std::vector<int>());
+
+  // within the same list
+  EXPECT_TRUE(cutil_list_splice(&a, a.root, &a, cutil_list_get(&a, 5), cutil_list_get(&a, 7), 3));
+  EXPECT_EQ(list_values(&a), std::vector<int>({ 2, 3, 4, 0, 1, 6, 7, 8, 5, 9 }));
+
+  EXPECT_TRUE(cutil_list_split_at(&a, 6, &b));
+  EXPECT_EQ(list_values(&a), std::vector<int>({ 2, 3, 4, 0, 1, 6 }));
+  EXPECT_EQ(list_values(&b), std::vector<int>({ 7, 8, 5, 9 }));
+  EXPECT_TRUE(cutil_list_split_at(&a, -1, &b));
+  EXPECT_FALSE(cutil_list_split_at(&a, 7, &b));
+  EXPECT_EQ(a.length, 6);
+
+  EXPECT_TRUE(cutil_list_concat(&b, &a));
+  EXPECT_EQ(list_values(&b), std::vector<int>({ 7, 8, 5, 9, 2, 3, 4, 0, 1, 6 }));
+  EXPECT_EQ(list_values(&a), std::vector<int>());
+  EXPECT_TRUE(cutil_list_concat(&b, &a));
+  EXPECT_TRUE(cutil_list_concat(&a, &b));
+  EXPECT_EQ(list_values(&a).size(), 10);
+  EXPECT_FALSE(cutil_list_concat(&a, &a));
+
+  cutil_list_destroy(&a, NULL);
+  cutil_list_destroy(&b, NULL);
+}
+
+TEST(list, batch_ownership)
+{
+  int v[12];
+  void* ptrs[12];
+  for (int i = 0; i < 12; i++)
+  {
+    v[i] = i;
+    ptrs[i] = &v[i];
+  }
+
+  // nodes of a batch spread over two lists, in both destruction orders
+  for (int order = 0; order < 2; order++)
+  {
+    struct cutil_list_t a, b, c;
+    cutil_list_init(&a);
+    cutil_list_init(&b);
+    cutil_list_init(&c);
+
+    for (int i = 0; i < 4; i++)
+      ASSERT_TRUE(cutil_list_insert_array(&a, ptrs + 3 * i, 3, -1));
+    ASSERT_TRUE(cutil_list_insert_back(&a, &v[0]));
+    ASSERT_TRUE(cutil_list_split_at(&a, 5, &b));
+    ASSERT_TRUE(cutil_list_splice(&c, NULL, &b, cutil_list_get(&b, 2), cutil_list_get(&b, 3), 2));
+    EXPECT_EQ(list_values(&a), std::vector<int>({ 0, 1, 2, 3, 4 }));
+    EXPECT_EQ(list_values(&b), std::vector<int>({ 5, 6, 9, 10, 11, 0 }));
+    EXPECT_EQ(list_values(&c), std::vector<int>({ 7, 8 }));
+
+    // removes take nodes of batches and single nodes alike
+    EXPECT_EQ(*(int*) cutil_list_remove_back(&b), 0);
+    EXPECT_EQ(*(int*) cutil_list_remove_front(&b), 5);
+    EXPECT_EQ(*(int*) cutil_list_remove(&a, 2), 2);
+    EXPECT_TRUE(cutil_list_insert_front(&c, &v[6]));
+    EXPECT_TRUE(cutil_list_concat(&a, &c));
+    EXPECT_EQ(list_values(&a), std::vector<int>({ 0, 1, 3, 4, 6, 7, 8 }));
+
+    if (order == 0)
+    {
+      cutil_list_destroy(&a, NULL);
+      EXPECT_EQ(list_values(&b), std::vector<int>({ 6, 9, 10, 11 }));
+      cutil_list_destroy(&b, NULL);
+    }
+    else
+    {
+      cutil_list_destroy(&b, NULL);
+      EXPECT_EQ(list_values(&a), std::vector<int>({ 0, 1, 3, 4, 6, 7, 8 }));
+      cutil_list_destroy(&a, NULL);
+    }
+    cutil_list_destroy(&c, NULL);
+    EXPECT_TRUE(a.blocks == NULL && b.blocks == NULL && c.blocks == NULL);
+  }
+}
+
+TEST(list, batch_release)
+{
+  int v[10];
+  void* ptrs[10];
+  for (int i = 0; i < 10; i++)
+  {
+    v[i] = i;
+    ptrs[i] = &v[i];
+  }
+
+  // a pipeline feeding batches in and draining them gives each batch back with its last node
+  struct cutil_list_t a, b;
+  cutil_list_init(&a);
+  cutil_list_init(&b);
+  for (int round = 0; round < 100; round++)
+  {
+    ASSERT_TRUE(cutil_list_insert_array(&a, ptrs, 8, -1));
+    for (int i = 0; i < 8; i++)
+      EXPECT_EQ(*(int*) cutil_list_remove_front(&a), i);
+    EXPECT_TRUE(a.blocks == NULL);
+  }
+
+  // only the batch of the moved nodes is shared
+  ASSERT_TRUE(cutil_list_insert_array(&a, ptrs, 4, -1));
+  ASSERT_TRUE(cutil_list_insert_array(&a, ptrs + 4, 4, -1));
+  ASSERT_TRUE(cutil_list_splice(&b, NULL, &a, cutil_list_get(&a, 1), cutil_list_get(&a, 2), 2));
+  EXPECT_EQ(list_values(&b), std::vector<int>({ 1, 2 }));
+  cutil_list_remove_front(&b);
+  cutil_list_remove_front(&b);
+  EXPECT_TRUE(b.blocks != NULL);
+
+  // the first batch is released through a, and b lets go of it once it adds a batch
+  cutil_list_remove_front(&a);
+  cutil_list_remove_front(&a);
+  EXPECT_EQ(list_values(&a), std::vector<int>({ 4, 5, 6, 7 }));
+  ASSERT_TRUE(cutil_list_insert_array(&b, ptrs + 8, 2, 0));
+  cutil_list_remove_front(&b);
+  cutil_list_remove_front(&b);
+  EXPECT_TRUE(b.blocks == NULL);
+
+  cutil_list_destroy(&a, NULL);
+  cutil_list_destroy(&b, NULL);
+  EXPECT_TRUE(a.blocks == NULL && b.blocks == NULL);
+}
+
+// Behaviour that changed when the positional operations were fixed, each against what the old code did
+TEST(list, contract_regressions)
+{
+  struct cutil_list_t list;
+  cutil_list_init(&list);
+  int v[] = { 0, 1, 2, 3 };
+
+  // cutil_list_front was declared without a definition
+  EXPECT_TRUE(cutil_list_front(&list) == NULL);
+  EXPECT_TRUE(cutil_list_front(NULL) == NULL);
+
+  // insert returned 0 on an empty list whatever the position
+  EXPECT_TRUE(cutil_list_insert(&list, &v[1], 0));
+  EXPECT_EQ(list.length, 1);
+  EXPECT_TRUE(cutil_list_front(&list) == list.root);
+  EXPECT_TRUE(cutil_list_insert(&list, &v[3], -1));
+  EXPECT_TRUE(cutil_list_insert_front(&list, &v[0]));
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 0, 1, 3 }));
+
+  // negative positions were off by one: insert at -2 appended, get(1) and get(-2) gave the ends
+  EXPECT_TRUE(cutil_list_insert(&list, &v[2], -2));
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 0, 1, 2, 3 }));
+  EXPECT_EQ(*(int*) cutil_list_get(&list, 1)->data, 1);
+  EXPECT_EQ(*(int*) cutil_list_get(&list, -2)->data, 2);
+
+  // node_data gave the element instead of its slot, so the element couldn't be replaced through it
+  struct cutil_list_node_t* node = cutil_list_get(&list, 3);
+  EXPECT_TRUE(cutil_list_node_data(node) == &node->data);
+  *cutil_list_node_data(node) = &v[0];
+  EXPECT_EQ(*(int*) cutil_list_get(&list, 3)->data, 0);
+  *cutil_list_node_data(node) = &v[3];
+
+  // remove pointed the previous node at itself, losing everything after it
+  EXPECT_EQ(*(int*) cutil_list_remove(&list, 1), 1);
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 0, 2, 3 }));
+  EXPECT_TRUE(list.root->next->prev == list.root);
+
+  // remove_front left the length and the end alone
+  EXPECT_EQ(*(int*) cutil_list_remove_front(&list), 0);
+  EXPECT_EQ(list.length, 2);
+  EXPECT_EQ(*(int*) list.end->data, 3);
+  EXPECT_EQ(list_values(&list), std::vector<int>({ 2, 3 }));
+
+  cutil_list_destroy(&list, NULL);
+}
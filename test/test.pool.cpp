@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include "pool.h"
+
+#include <set>
+#include <stdint.h>
+
+TEST(pool, null_oops)
+{
+  EXPECT_TRUE(cutil_pool_alloc(NULL) == NULL);
+  EXPECT_EQ(cutil_pool_add_region(NULL, NULL, 0), 0);
+  EXPECT_EQ(cutil_pool_heap_bytes(NULL), 0);
+  cutil_pool_free(NULL, NULL);
+  cutil_pool_destroy(NULL);
+}
+
+TEST(pool, reuse_freed)
+{
+  struct cutil_pool_t pool;
+  cutil_pool_init(&pool, 24, 4);
+  EXPECT_EQ(pool.objSize % sizeof(void*), 0);
+  EXPECT_GE(pool.objSize, 24);
+
+  std::set<void*> seen;
+  void* objs[10];
+  for (size_t i = 0; i < 10; i++)
+  {
+    objs[i] = cutil_pool_alloc(&pool);
+    ASSERT_TRUE(objs[i] != NULL);
+    EXPECT_TRUE(seen.insert(objs[i]).second);
+    EXPECT_EQ((uintptr_t) objs[i] % sizeof(void*), 0);
+  }
+
+  // released objects come back before anything new is carved
+  cutil_pool_free(&pool, objs[3]);
+  EXPECT_EQ(cutil_pool_alloc(&pool), objs[3]);
+
+  // 10 objects took 3 chunks of 4
+  EXPECT_GE(cutil_pool_heap_bytes(&pool), 3 * 4 * pool.objSize);
+
+  cutil_pool_destroy(&pool);
+  EXPECT_TRUE(pool.chunks == NULL);
+}
+
+TEST(pool, region_only)
+{
+  alignas(16) char region[256];
+  struct cutil_pool_t pool;
+  cutil_pool_init(&pool, 32, 0);
+
+  size_t n = cutil_pool_add_region(&pool, region, sizeof(region));
+  EXPECT_EQ(n, sizeof(region) / pool.objSize);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    char* obj = (char*) cutil_pool_alloc(&pool);
+    ASSERT_TRUE(obj != NULL);
+    EXPECT_TRUE(obj >= region && obj + pool.objSize <= region + sizeof(region));
+  }
+
+  // the heap is never touched when there are no chunks
+  EXPECT_TRUE(cutil_pool_alloc(&pool) == NULL);
+  EXPECT_TRUE(pool.chunks == NULL);
+  EXPECT_EQ(cutil_pool_heap_bytes(&pool), 0);
+
+  cutil_pool_destroy(&pool);
+}
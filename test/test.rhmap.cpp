@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include "epoch.h"
+#include "rhmap.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static void count_free(void* ctx, void* ptr)
+{
+  (void) ptr;
+  (*(size_t*) ctx)++;
+}
+
+TEST(epoch, retire_waits_for_readers)
+{
+  struct cutil_epoch_t epoch;
+  ASSERT_EQ(1, cutil_epoch_init(&epoch));
+
+  size_t freed = 0;
+  int obj;
+  cutil_epoch_enter(&epoch);
+  std::thread writer([&]() {
+    cutil_epoch_retire(&epoch, &obj, count_free, &freed);
+    for (int i = 0; i < 8; i++)
+      cutil_epoch_reclaim(&epoch);
+  });
+  writer.join();
+
+  // the reader on this thread is still inside its critical section
+  EXPECT_EQ(freed, 0);
+  cutil_epoch_exit(&epoch);
+
+  for (int i = 0; i < 4; i++)
+    cutil_epoch_reclaim(&epoch);
+  EXPECT_EQ(freed, 1);
+
+  cutil_epoch_destroy(&epoch);
+}
+
+static std::atomic<size_t> destroyed(0);
+static void count_destructor(struct cutil_hmap_tuple_t* t)
+{
+  (void) t;
+  destroyed++;
+}
+
+TEST(rhmap, basic0)
+{
+  struct cutil_rhmap_t map;
+  ASSERT_EQ(1, cutil_rhmap_init(&map));
+  cutil_rhmap_set_destructor(&map, (cutil_destructor_func_t) count_destructor);
+  destroyed = 0;
+
+  const size_t n = 1000;
+  std::vector<size_t> keys(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = i;
+    EXPECT_EQ(1, cutil_rhmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+    EXPECT_EQ(0, cutil_rhmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i])));
+  }
+  EXPECT_EQ(n, cutil_rhmap_size(&map));
+
+  for (size_t i = 0; i < n; i++)
+  {
+    void* v = NULL;
+    EXPECT_EQ(1, cutil_rhmap_get(&map, cutil_hmap_key(&keys[i]), &v));
+    EXPECT_EQ(v, &keys[i]);
+  }
+
+  for (size_t i = 0; i < n; i += 2)
+    EXPECT_EQ(1, cutil_rhmap_del(&map, cutil_hmap_key(&keys[i])));
+  for (size_t i = 0; i < n; i++)
+    EXPECT_EQ(i % 2, cutil_rhmap_probe_key(&map, cutil_hmap_key(&keys[i])));
+
+  // every entry is destroyed exactly once, whether it was removed or still in the map
+  cutil_rhmap_destroy(&map);
+  EXPECT_EQ(destroyed, n);
+}
+
+TEST(rhmap, readers_during_writes)
+{
+  struct cutil_rhmap_t map;
+  ASSERT_EQ(1, cutil_rhmap_init(&map));
+
+  // the stable keys are never removed and must stay visible through every resize
+  const size_t stable = 256;
+  const size_t churn = 4096;
+  std::vector<size_t> keys(stable + churn);
+  for (size_t i = 0; i < keys.size(); i++)
+    keys[i] = i;
+  for (size_t i = 0; i < stable; i++)
+    cutil_rhmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i]));
+
+  std::atomic<bool> done(false);
+  std::atomic<size_t> misses(0);
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < 3; r++)
+  {
+    readers.emplace_back([&]() {
+      while (!done)
+      {
+        for (size_t i = 0; i < stable; i++)
+        {
+          void* v = NULL;
+          if (!cutil_rhmap_get(&map, cutil_hmap_key(&keys[i]), &v) || v != &keys[i])
+            misses++;
+        }
+      }
+    });
+  }
+
+  for (size_t round = 0; round < 4; round++)
+  {
+    for (size_t i = stable; i < keys.size(); i++)
+      cutil_rhmap_insert(&map, cutil_hmap_tuple(&keys[i], &keys[i]));
+    for (size_t i = stable; i < keys.size(); i++)
+      cutil_rhmap_del(&map, cutil_hmap_key(&keys[i]));
+  }
+
+  done = true;
+  for (auto& r : readers)
+    r.join();
+
+  EXPECT_EQ(misses, 0);
+  EXPECT_EQ(stable, cutil_rhmap_size(&map));
+  cutil_rhmap_destroy(&map);
+}
+
+static std::atomic<size_t> equal_calls(0);
+static int counting_equal(void* a, void* b, size_t alen, size_t blen)
+{
+  equal_calls++;
+  return cutil_equal_bytes(a, b, alen, blen);
+}
+
+TEST(rhmap, equalfn)
+{
+  struct cutil_rhmap_t map;
+  ASSERT_EQ(1, cutil_rhmap_init(&map));
+
+  cutil_rhmap_set_equalfn(&map, counting_equal);
+  size_t a = 7, b = 7;
+  EXPECT_EQ(1, cutil_rhmap_insert(&map, cutil_hmap_tuple(&a, &a)));
+  equal_calls = 0;
+  EXPECT_EQ(1, cutil_rhmap_probe_key(&map, cutil_hmap_key(&b)));
+  EXPECT_GE(equal_calls, 1);
+
+  // the functions only change while the map is empty
+  cutil_rhmap_set_comparefn(&map, cutil_compare_lex);
+  EXPECT_TRUE(map.equalFn == counting_equal);
+  EXPECT_EQ(1, cutil_rhmap_del(&map, cutil_hmap_key(&b)));
+
+  // a comparison function takes over from the equality function
+  cutil_rhmap_set_comparefn(&map, cutil_compare_lex);
+  EXPECT_TRUE(map.equalFn == NULL);
+  EXPECT_EQ(1, cutil_rhmap_insert(&map, cutil_hmap_tuple(&a, &a)));
+  equal_calls = 0;
+  EXPECT_EQ(1, cutil_rhmap_probe_key(&map, cutil_hmap_key(&b)));
+  EXPECT_EQ(equal_calls, 0);
+
+  cutil_rhmap_destroy(&map);
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include "cutil.h"
+#include "skiplist.h"
+
+#include <random>
+#include <vector>
+
+// Positional lookups go through the link widths, the iterators only through the level 0 links: both must agree
+// with the model
+static void skiplist_check(struct cutil_skiplist_t* list, const std::vector<size_t>& model)
+{
+  ASSERT_EQ(cutil_skiplist_size(list), model.size());
+  for (size_t i = 0; i < model.size(); i++)
+    ASSERT_EQ(*(size_t*) *cutil_skiplist_get(list, (ptrdiff_t) i), model[i]) << "position " << i;
+
+  struct cutil_skiplist_iterator_t it;
+  cutil_skiplist_iterator_init(&it, list, 0);
+  size_t i = 0;
+  for (void** v = cutil_skiplist_iterator_get(&it); v; v = cutil_skiplist_iterator_next(&it), i++)
+    ASSERT_EQ(*(size_t*) *v, model[i]) << "index " << i;
+  EXPECT_EQ(i, model.size());
+
+  cutil_skiplist_iterator_init(&it, list, -1);
+  for (void** v = cutil_skiplist_iterator_get(&it); v; v = cutil_skiplist_iterator_back(&it))
+    ASSERT_EQ(*(size_t*) *v, model[--i]);
+  EXPECT_EQ(i, 0);
+}
+
+TEST(skiplist, null_oops)
+{
+  cutil_skiplist_init(NULL);
+  cutil_skiplist_destroy(NULL, NULL);
+  EXPECT_EQ(cutil_skiplist_size(NULL), 0);
+  EXPECT_EQ(cutil_skiplist_insert(NULL, NULL, 0), 0);
+  EXPECT_TRUE(cutil_skiplist_get(NULL, 0) == NULL);
+
+  struct cutil_skiplist_t list;
+  cutil_skiplist_init(&list);
+  EXPECT_TRUE(cutil_skiplist_front(&list) == NULL);
+  EXPECT_TRUE(cutil_skiplist_back(&list) == NULL);
+  EXPECT_TRUE(cutil_skiplist_get(&list, CUTIL_END) == NULL);
+  EXPECT_TRUE(cutil_skiplist_remove_front(&list) == NULL);
+  EXPECT_TRUE(cutil_skiplist_remove_back(&list) == NULL);
+  EXPECT_EQ(cutil_skiplist_insert(&list, NULL, 1), 0);
+
+  struct cutil_skiplist_iterator_t it;
+  cutil_skiplist_iterator_init(&it, &list, 0);
+  EXPECT_TRUE(cutil_skiplist_iterator_get(&it) == NULL);
+  cutil_skiplist_destroy(&list, NULL);
+}
+
+TEST(skiplist, positions)
+{
+  struct cutil_skiplist_t list;
+  cutil_skiplist_init(&list);
+
+  size_t values[10];
+  std::vector<size_t> model;
+  for (size_t i = 0; i < 10; i++)
+    values[i] = i;
+
+  EXPECT_EQ(1, cutil_skiplist_insert_back(&list, &values[1]));
+  EXPECT_EQ(1, cutil_skiplist_insert_front(&list, &values[0]));
+  EXPECT_EQ(1, cutil_skiplist_insert(&list, &values[3], CUTIL_END));
+  EXPECT_EQ(1, cutil_skiplist_insert(&list, &values[2], -2));
+  EXPECT_EQ(1, cutil_skiplist_insert(&list, &values[4], -1));
+  model = { 0, 1, 2, 3, 4 };
+  skiplist_check(&list, model);
+
+  EXPECT_EQ(*(size_t*) *cutil_skiplist_get(&list, CUTIL_BEG), 0);
+  EXPECT_EQ(*(size_t*) *cutil_skiplist_get(&list, CUTIL_END), 4);
+  EXPECT_EQ(*(size_t*) *cutil_skiplist_get(&list, -5), 0);
+  EXPECT_TRUE(cutil_skiplist_get(&list, -6) == NULL);
+  EXPECT_TRUE(cutil_skiplist_get(&list, 5) == NULL);
+  EXPECT_EQ(0, cutil_skiplist_insert(&list, NULL, 6));
+  EXPECT_EQ(0, cutil_skiplist_insert(&list, NULL, -7));
+
+  EXPECT_EQ(*(size_t*) cutil_skiplist_remove(&list, -2), 3);
+  EXPECT_EQ(*(size_t*) cutil_skiplist_remove_back(&list), 4);
+  EXPECT_EQ(*(size_t*) cutil_skiplist_remove_front(&list), 0);
+  model = { 1, 2 };
+  skiplist_check(&list, model);
+  EXPECT_EQ(*(size_t*) *cutil_skiplist_front(&list), 1);
+  EXPECT_EQ(*(size_t*) *cutil_skiplist_back(&list), 2);
+
+  cutil_skiplist_destroy(&list, NULL);
+  EXPECT_EQ(cutil_skiplist_size(&list), 0);
+}
+
+TEST(skiplist, random_against_model)
+{
+  struct cutil_skiplist_t list;
+  cutil_skiplist_init(&list);
+
+  const size_t n = 4000;
+  std::vector<size_t> values(n);
+  for (size_t i = 0; i < n; i++)
+    values[i] = i;
+
+  std::mt19937 rng(11);
+  std::vector<size_t> model;
+  size_t next = 0;
+  for (size_t op = 0; op < 10000; op++)
+  {
+    size_t len = model.size();
+    if (next == n && len == 0)
+      break;
+    if (next < n && (rng() % 3 != 0 || len == 0))
+    {
+      ptrdiff_t pos = (ptrdiff_t) (rng() % (len + 1));
+      size_t idx = (size_t) pos;
+      if (rng() % 2)
+        pos = pos - (ptrdiff_t) len - 1;
+      ASSERT_EQ(1, cutil_skiplist_insert(&list, &values[next], pos));
+      model.insert(model.begin() + idx, next++);
+    }
+    else
+    {
+      ptrdiff_t pos = (ptrdiff_t) (rng() % len);
+      size_t idx = (size_t) pos;
+      if (rng() % 2)
+        pos -= (ptrdiff_t) len;
+      void* v = cutil_skiplist_remove(&list, pos);
+      ASSERT_TRUE(v != NULL);
+      ASSERT_EQ(*(size_t*) v, model[idx]);
+      model.erase(model.begin() + idx);
+    }
+
+    if (op % 500 == 0)
+      skiplist_check(&list, model);
+  }
+  skiplist_check(&list, model);
+
+  cutil_skiplist_destroy(&list, NULL);
+}
+
+static size_t skiplist_destroyed = 0;
+static void skiplist_count_destroy(void* data)
+{
+  (void) data;
+  skiplist_destroyed++;
+}
+
+TEST(skiplist, large)
+{
+  struct cutil_skiplist_t list;
+  cutil_skiplist_init(&list);
+
+  // built by inserting into the middle, which is O(n) per insert for a linked list
+  const size_t n = 200000;
+  std::vector<size_t> values(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    values[i] = i;
+    ASSERT_EQ(1, cutil_skiplist_insert(&list, &values[i], (ptrdiff_t) (i / 2)));
+  }
+
+  // inserting i at i / 2 leaves the odd values rising, then the even ones falling
+  std::mt19937 rng(3);
+  for (size_t k = 0; k < 10000; k++)
+  {
+    size_t pos = rng() % n;
+    size_t expected = (pos < n / 2) ? 2 * pos + 1 : 2 * (n - 1 - pos);
+    ASSERT_EQ(*(size_t*) *cutil_skiplist_get(&list, (ptrdiff_t) pos), expected) << "position " << pos;
+  }
+  EXPECT_GT(list.level, 4);
+
+  skiplist_destroyed = 0;
+  cutil_skiplist_destroy(&list, skiplist_count_destroy);
+  EXPECT_EQ(skiplist_destroyed, n);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "tmap.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+
+CUTIL_HMAP_DECLARE(u64map, uint64_t, double, CUTIL_HMAP_HASH_INT, CUTIL_HMAP_EQ_VALUE);
+
+typedef struct point
+{
+  int x;
+  int y;
+} point;
+
+static inline size_t point_hash(point p)
+{
+  return (size_t) p.x * 31 + (size_t) p.y;
+}
+
+static inline int point_eq(point a, point b)
+{
+  return a.x == b.x && a.y == b.y;
+}
+
+CUTIL_HMAP_DECLARE(pointmap, point, const char*, point_hash, point_eq);
+
+TEST(tmap, null_oops)
+{
+  EXPECT_EQ(u64map_init(NULL), 0);
+  EXPECT_EQ(u64map_insert(NULL, 1, 1.0), 0);
+  EXPECT_TRUE(u64map_get(NULL, 1) == NULL);
+  EXPECT_EQ(u64map_del(NULL, 1), 0);
+  EXPECT_EQ(u64map_size(NULL), 0);
+  u64map_destroy(NULL);
+}
+
+TEST(tmap, basic0)
+{
+  u64map_t map;
+  ASSERT_EQ(1, u64map_init(&map));
+
+  for (uint64_t i = 0; i < 100; i++)
+  {
+    EXPECT_EQ(1, u64map_insert(&map, i, i * 0.5));
+    EXPECT_EQ(0, u64map_insert(&map, i, 0.0));
+  }
+  EXPECT_EQ(u64map_size(&map), 100);
+
+  for (uint64_t i = 0; i < 100; i++)
+  {
+    double* v = u64map_get(&map, i);
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*v, i * 0.5);
+    *v = 1.0;
+  }
+  EXPECT_EQ(*u64map_get(&map, 42), 1.0);
+  EXPECT_TRUE(u64map_get(&map, 100) == NULL);
+
+  EXPECT_EQ(1, u64map_del(&map, 42));
+  EXPECT_EQ(0, u64map_del(&map, 42));
+  EXPECT_TRUE(u64map_get(&map, 42) == NULL);
+  EXPECT_EQ(u64map_size(&map), 99);
+
+  u64map_destroy(&map);
+  EXPECT_TRUE(map.slots == NULL);
+}
+
+TEST(tmap, struct_keys)
+{
+  pointmap_t map;
+  ASSERT_EQ(1, pointmap_init(&map));
+
+  point a = { 1, 2 };
+  point b = { 2, 1 };
+  EXPECT_EQ(1, pointmap_insert(&map, a, "a"));
+  EXPECT_EQ(1, pointmap_insert(&map, b, "b"));
+  EXPECT_STREQ(*pointmap_get(&map, a), "a");
+  EXPECT_STREQ(*pointmap_get(&map, b), "b");
+
+  point c = { 3, 3 };
+  EXPECT_TRUE(pointmap_get(&map, c) == NULL);
+
+  pointmap_destroy(&map);
+}
+
+TEST(tmap, churn)
+{
+  u64map_t map;
+  u64map_init(&map);
+  EXPECT_EQ(1, u64map_reserve(&map, 1000));
+  size_t capacity = map.capacity;
+  EXPECT_GE(capacity / 8 * 7, 1000);
+
+  // mixed inserts and deletes stay consistent with a reference map and reuse tombstones
+  std::unordered_map<uint64_t, double> ref;
+  uint64_t state = 12345;
+  for (size_t i = 0; i < 100000; i++)
+  {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint64_t k = (state >> 33) % 900;
+    if (state & 1)
+      EXPECT_EQ(u64map_insert(&map, k, (double) i), ref.emplace(k, (double) i).second ? 1 : 0);
+    else
+      EXPECT_EQ(u64map_del(&map, k), (int) ref.erase(k));
+  }
+
+  EXPECT_EQ(u64map_size(&map), ref.size());
+  EXPECT_EQ(map.capacity, capacity);
+  for (auto& kv : ref)
+  {
+    double* v = u64map_get(&map, kv.first);
+    ASSERT_TRUE(v != NULL);
+    EXPECT_EQ(*v, kv.second);
+  }
+
+  u64map_destroy(&map);
+}
@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+
+#include "cutil.h"
+#include "ulist.h"
+
+#include <random>
+#include <vector>
+
+static void ulist_expect_equal(struct cutil_ulist_t* list, const std::vector<size_t>& model)
+{
+  ASSERT_EQ(cutil_ulist_size(list), model.size());
+
+  struct cutil_ulist_iterator_t it;
+  cutil_ulist_iterator_init(&it, list, 0);
+  size_t i = 0;
+  for (void** v = cutil_ulist_iterator_get(&it); v; v = cutil_ulist_iterator_next(&it), i++)
+    ASSERT_EQ(*(size_t*) *v, model[i]) << "index " << i;
+  EXPECT_EQ(i, model.size());
+
+  cutil_ulist_iterator_init(&it, list, -1);
+  i = model.size();
+  for (void** v = cutil_ulist_iterator_get(&it); v; v = cutil_ulist_iterator_back(&it))
+    ASSERT_EQ(*(size_t*) *v, model[--i]);
+  EXPECT_EQ(i, 0);
+}
+
+TEST(ulist, null_oops)
+{
+  struct cutil_ulist_t list;
+  cutil_ulist_init(NULL);
+  cutil_ulist_destroy(NULL, NULL);
+  EXPECT_EQ(cutil_ulist_size(NULL), 0);
+  EXPECT_EQ(cutil_ulist_insert_back(NULL, NULL), 0);
+  EXPECT_TRUE(cutil_ulist_get(NULL, 0) == NULL);
+
+  cutil_ulist_init(&list);
+  EXPECT_TRUE(cutil_ulist_front(&list) == NULL);
+  EXPECT_TRUE(cutil_ulist_back(&list) == NULL);
+  EXPECT_TRUE(cutil_ulist_get(&list, 0) == NULL);
+  EXPECT_TRUE(cutil_ulist_remove(&list, 0) == NULL);
+  EXPECT_TRUE(cutil_ulist_remove_front(&list) == NULL);
+  EXPECT_TRUE(cutil_ulist_remove_back(&list) == NULL);
+  EXPECT_EQ(cutil_ulist_insert(&list, NULL, 1), 0);
+
+  struct cutil_ulist_iterator_t it;
+  cutil_ulist_iterator_init(&it, &list, 0);
+  EXPECT_TRUE(cutil_ulist_iterator_get(&it) == NULL);
+  EXPECT_TRUE(cutil_ulist_iterator_next(&it) == NULL);
+  cutil_ulist_destroy(&list, NULL);
+}
+
+TEST(ulist, front_back)
+{
+  struct cutil_ulist_t list;
+  cutil_ulist_init(&list);
+
+  const size_t n = 100;
+  std::vector<size_t> values(n);
+  std::vector<size_t> model;
+  for (size_t i = 0; i < n; i++)
+  {
+    values[i] = i;
+    if (i % 2)
+    {
+      ASSERT_EQ(1, cutil_ulist_insert_back(&list, &values[i]));
+      model.push_back(i);
+    }
+    else
+    {
+      ASSERT_EQ(1, cutil_ulist_insert_front(&list, &values[i]));
+      model.insert(model.begin(), i);
+    }
+  }
+  ulist_expect_equal(&list, model);
+
+  EXPECT_EQ(*(size_t*) *cutil_ulist_front(&list), model.front());
+  EXPECT_EQ(*(size_t*) *cutil_ulist_back(&list), model.back());
+  EXPECT_EQ(*(size_t*) *cutil_ulist_get(&list, CUTIL_BEG), model.front());
+  EXPECT_EQ(*(size_t*) *cutil_ulist_get(&list, CUTIL_END), model.back());
+  EXPECT_EQ(*(size_t*) *cutil_ulist_get(&list, -2), model[n - 2]);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_get(&list, -(ptrdiff_t) n), model[0]);
+  EXPECT_TRUE(cutil_ulist_get(&list, n) == NULL);
+  EXPECT_TRUE(cutil_ulist_get(&list, -(ptrdiff_t) n - 1) == NULL);
+
+  // built from both ends, every node but the outer two is full
+  EXPECT_LE(list.nodes, n / CUTIL_ULIST_NODE_CAP + 2);
+
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    EXPECT_EQ(*(size_t*) cutil_ulist_remove_front(&list), model.front());
+    model.erase(model.begin());
+    EXPECT_EQ(*(size_t*) cutil_ulist_remove_back(&list), model.back());
+    model.pop_back();
+  }
+  EXPECT_EQ(cutil_ulist_size(&list), 0);
+  EXPECT_EQ(list.nodes, 0);
+  EXPECT_TRUE(list.root == NULL && list.end == NULL);
+
+  cutil_ulist_destroy(&list, NULL);
+}
+
+TEST(ulist, positional_against_model)
+{
+  struct cutil_ulist_t list;
+  cutil_ulist_init(&list);
+
+  const size_t n = 5000;
+  std::vector<size_t> values(n);
+  for (size_t i = 0; i < n; i++)
+    values[i] = i;
+
+  std::mt19937 rng(7);
+  std::vector<size_t> model;
+  size_t next = 0;
+  for (size_t op = 0; op < 12000; op++)
+  {
+    size_t len = model.size();
+    if (next == n && len == 0)
+      break;
+    if (next < n && (rng() % 3 != 0 || len == 0))
+    {
+      // positions from both ends, including the appending ones
+      ptrdiff_t pos = (ptrdiff_t) (rng() % (len + 1));
+      size_t idx = (size_t) pos;
+      if (rng() % 2)
+        pos = pos - (ptrdiff_t) len - 1;
+      ASSERT_EQ(1, cutil_ulist_insert(&list, &values[next], pos));
+      model.insert(model.begin() + idx, next++);
+    }
+    else
+    {
+      ptrdiff_t pos = (ptrdiff_t) (rng() % len);
+      size_t idx = (size_t) pos;
+      if (rng() % 2)
+        pos -= (ptrdiff_t) len;
+      void* v = cutil_ulist_remove(&list, pos);
+      ASSERT_TRUE(v != NULL);
+      ASSERT_EQ(*(size_t*) v, model[idx]);
+      model.erase(model.begin() + idx);
+    }
+
+    if (op % 1000 == 0)
+      ulist_expect_equal(&list, model);
+  }
+  ulist_expect_equal(&list, model);
+
+  for (size_t i = 0; i < model.size(); i += 37)
+    EXPECT_EQ(*(size_t*) *cutil_ulist_get(&list, i), model[i]);
+
+  // every node but the ends stays at least half full, even after random removes
+  EXPECT_LE(list.nodes, model.size() / (CUTIL_ULIST_NODE_CAP / 2) + 2);
+
+  EXPECT_EQ(0, cutil_ulist_insert(&list, NULL, model.size() + 1));
+  EXPECT_EQ(0, cutil_ulist_insert(&list, NULL, -(ptrdiff_t) model.size() - 2));
+  EXPECT_TRUE(cutil_ulist_remove(&list, model.size()) == NULL);
+
+  cutil_ulist_destroy(&list, NULL);
+  EXPECT_EQ(cutil_ulist_size(&list), 0);
+}
+
+TEST(ulist, middle_churn_stays_dense)
+{
+  struct cutil_ulist_t list;
+  cutil_ulist_init(&list);
+
+  const size_t n = 2000;
+  std::vector<size_t> values(n);
+  std::vector<size_t> model;
+  for (size_t i = 0; i < n; i++)
+  {
+    values[i] = i;
+    ASSERT_EQ(1, cutil_ulist_insert_back(&list, &values[i]));
+    model.push_back(i);
+  }
+
+  // splits and removes inside the list, which used to strand nearly empty nodes between full ones
+  std::mt19937 rng(11);
+  for (size_t round = 0; round < 20000; round++)
+  {
+    size_t len = model.size();
+    size_t idx = 1 + rng() % (len - 2);
+    if (round % 2)
+    {
+      ASSERT_EQ(1, cutil_ulist_insert(&list, &values[idx], (ptrdiff_t) idx));
+      model.insert(model.begin() + idx, idx);
+    }
+    else
+    {
+      void* v = cutil_ulist_remove(&list, (ptrdiff_t) idx);
+      ASSERT_TRUE(v != NULL);
+      ASSERT_EQ(*(size_t*) v, model[idx]);
+      model.erase(model.begin() + idx);
+    }
+    ASSERT_LE(list.nodes, model.size() / (CUTIL_ULIST_NODE_CAP / 2) + 2) << "round " << round;
+  }
+  ulist_expect_equal(&list, model);
+
+  // a shrinking list also gives its nodes back
+  while (model.size() > 100)
+  {
+    size_t idx = 1 + rng() % (model.size() - 2);
+    ASSERT_TRUE(cutil_ulist_remove(&list, (ptrdiff_t) idx) != NULL);
+    model.erase(model.begin() + idx);
+  }
+  EXPECT_LE(list.nodes, model.size() / (CUTIL_ULIST_NODE_CAP / 2) + 2);
+  ulist_expect_equal(&list, model);
+
+  cutil_ulist_destroy(&list, NULL);
+}
+
+TEST(ulist, iterator_peek)
+{
+  struct cutil_ulist_t list;
+  cutil_ulist_init(&list);
+
+  size_t values[40];
+  for (size_t i = 0; i < 40; i++)
+  {
+    values[i] = i;
+    cutil_ulist_insert_back(&list, &values[i]);
+  }
+
+  struct cutil_ulist_iterator_t it;
+  cutil_ulist_iterator_init(&it, &list, 12);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_iterator_get(&it), 12);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_iterator_peek(&it), 13);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_iterator_peek_back(&it), 11);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_iterator_next(&it), 13);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_iterator_peek_back(&it), 12);
+  EXPECT_EQ(*(size_t*) *cutil_ulist_iterator_back(&it), 12);
+
+  cutil_ulist_iterator_init(&it, &list, 0);
+  EXPECT_TRUE(cutil_ulist_iterator_peek_back(&it) == NULL);
+  EXPECT_TRUE(cutil_ulist_iterator_back(&it) == NULL);
+  cutil_ulist_iterator_init(&it, &list, -1);
+  EXPECT_TRUE(cutil_ulist_iterator_peek(&it) == NULL);
+
+  cutil_ulist_iterator_destroy(&it);
+  EXPECT_TRUE(cutil_ulist_iterator_get(&it) == NULL);
+  cutil_ulist_destroy(&list, NULL);
+}
+
+static size_t ulist_destroyed = 0;
+static void ulist_count_destroy(void* data)
+{
+  (void) data;
+  ulist_destroyed++;
+}
+
+TEST(ulist, destroy)
+{
+  struct cutil_ulist_t list;
+  cutil_ulist_init(&list);
+  size_t v = 0;
+  for (size_t i = 0; i < 100; i++)
+    cutil_ulist_insert(&list, &v, (ptrdiff_t) (i / 2));
+
+  ulist_destroyed = 0;
+  cutil_ulist_destroy(&list, ulist_count_destroy);
+  EXPECT_EQ(ulist_destroyed, 100);
+  EXPECT_EQ(list.nodes, 0);
+}